@@ -0,0 +1,473 @@
+//===-- stevemac::algorithm.h -------------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#pragma once
+#include "aligned_allocator.h"
+#include "simd.h"
+#include "vector.h"
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace stevemac
+{
+///===----------------------------------------------------------------------===//
+///
+/// stevemac search kernels: find, count, contains, minmax
+/// These work on the contiguous buffer behind a stevemac::vector instead of
+/// walking vector_iterator.  For 8 and 32 bit integers and float the scan is
+/// done 16 or 32 bytes at a time (SSE4.1 / AVX2, chosen at runtime), find
+/// and contains exit on the first matching block.  Every other T goes
+/// through the scalar fallback, which is also the reference for the SIMD
+/// paths.
+/// NOTE: float compares use ==, so NaN never matches.  minmax over a vector
+/// holding NaN returns an unspecified pair, as does std::minmax_element.
+//===----------------------------------------------------------------------===//
+namespace detail
+{
+template <typename T>
+constexpr bool simd_searchable_v =
+	std::is_same_v<T, std::int8_t> || std::is_same_v<T, std::uint8_t>
+	|| std::is_same_v<T, std::int32_t> || std::is_same_v<T, std::uint32_t>
+	|| std::is_same_v<T, float>;
+
+//===----------------------------------------------------------------------===//
+/// scalar fallback
+//===----------------------------------------------------------------------===//
+template <typename T>
+std::size_t find_scalar(const T *p, std::size_t n, const T &value)
+{
+	std::size_t i = 0;
+	while (i < n && !(p[i] == value))
+		++i;
+	return i;
+}
+
+template <typename T>
+std::size_t count_scalar(const T *p, std::size_t n, const T &value)
+{
+	std::size_t c = 0;
+	for (std::size_t i = 0; i < n; ++i)
+		c += (p[i] == value);
+	return c;
+}
+
+/// Requires n > 0.
+template <typename T>
+std::pair<T, T> minmax_scalar(const T *p, std::size_t n)
+{
+	T lo = p[0], hi = p[0];
+	for (std::size_t i = 1; i < n; ++i) {
+		if (p[i] < lo)
+			lo = p[i];
+		if (hi < p[i])
+			hi = p[i];
+	}
+	return {lo, hi};
+}
+
+#if STEVEMAC_SIMD_X86
+//===----------------------------------------------------------------------===//
+/// AVX2 kernels, 32 bytes per step.
+/// Compare results are collapsed with movemask_epi8 for every lane width, so
+/// a match at lane k sets bits [k * sizeof(T), (k + 1) * sizeof(T)).
+/// Aligned selects aligned loads; it is only set when the vector's
+/// allocator guarantees 32 byte aligned data(), see is_aligned_v.
+//===----------------------------------------------------------------------===//
+template <bool Aligned>
+STEVEMAC_TARGET("avx2") inline __m256i avx2_load(const void *p)
+{
+	if constexpr (Aligned)
+		return _mm256_load_si256(static_cast<const __m256i *>(p));
+	else
+		return _mm256_loadu_si256(static_cast<const __m256i *>(p));
+}
+
+template <bool Aligned>
+STEVEMAC_TARGET("avx2") inline __m256 avx2_load_ps(const float *p)
+{
+	if constexpr (Aligned)
+		return _mm256_load_ps(p);
+	else
+		return _mm256_loadu_ps(p);
+}
+
+template <typename T>
+STEVEMAC_TARGET("avx2") inline __m256i avx2_splat(T value)
+{
+	if constexpr (sizeof(T) == 1)
+		return _mm256_set1_epi8(static_cast<char>(value));
+	else if constexpr (std::is_same_v<T, float>)
+		return _mm256_castps_si256(_mm256_set1_ps(value));
+	else
+		return _mm256_set1_epi32(static_cast<int>(value));
+}
+
+template <bool Aligned, typename T>
+STEVEMAC_TARGET("avx2") inline unsigned avx2_eq_mask(const T *p, __m256i needle)
+{
+	if constexpr (std::is_same_v<T, float>) {
+		const __m256 x = avx2_load_ps<Aligned>(p);
+		return _mm256_movemask_epi8(_mm256_castps_si256(_mm256_cmp_ps(
+			x, _mm256_castsi256_ps(needle), _CMP_EQ_OQ)));
+	} else {
+		const __m256i x = avx2_load<Aligned>(p);
+		if constexpr (sizeof(T) == 1)
+			return _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, needle));
+		else
+			return _mm256_movemask_epi8(
+				_mm256_cmpeq_epi32(x, needle));
+	}
+}
+
+template <bool Aligned, typename T>
+STEVEMAC_TARGET("avx2")
+std::size_t find_avx2(const T *p, std::size_t n, T value)
+{
+	constexpr std::size_t lanes = 32 / sizeof(T);
+	const __m256i needle = avx2_splat(value);
+	std::size_t i = 0;
+
+	for (; i + lanes <= n; i += lanes) {
+		const unsigned mask = avx2_eq_mask<Aligned>(p + i, needle);
+		if (mask != 0)
+			return i + __builtin_ctz(mask) / sizeof(T);
+	}
+	return i + find_scalar(p + i, n - i, value);
+}
+
+template <bool Aligned, typename T>
+STEVEMAC_TARGET("avx2")
+std::size_t count_avx2(const T *p, std::size_t n, T value)
+{
+	constexpr std::size_t lanes = 32 / sizeof(T);
+	const __m256i needle = avx2_splat(value);
+	std::size_t i = 0, c = 0;
+
+	for (; i + lanes <= n; i += lanes)
+		c += __builtin_popcount(avx2_eq_mask<Aligned>(p + i, needle));
+	return c / sizeof(T) + count_scalar(p + i, n - i, value);
+}
+
+template <bool Aligned, typename T>
+STEVEMAC_TARGET("avx2")
+std::pair<T, T> minmax_avx2(const T *p, std::size_t n)
+{
+	constexpr std::size_t lanes = 32 / sizeof(T);
+	if (n < lanes)
+		return minmax_scalar(p, n);
+
+	alignas(32) T lo[lanes], hi[lanes];
+	if constexpr (std::is_same_v<T, float>) {
+		__m256 vlo = avx2_load_ps<Aligned>(p), vhi = vlo;
+		for (std::size_t i = lanes; i + lanes <= n; i += lanes) {
+			const __m256 x = avx2_load_ps<Aligned>(p + i);
+			vlo = _mm256_min_ps(vlo, x);
+			vhi = _mm256_max_ps(vhi, x);
+		}
+		_mm256_store_ps(lo, vlo);
+		_mm256_store_ps(hi, vhi);
+	} else {
+		const __m256i *q = reinterpret_cast<const __m256i *>(p);
+		__m256i vlo = avx2_load<Aligned>(q), vhi = vlo;
+		for (std::size_t i = 1; i < n / lanes; ++i) {
+			const __m256i x = avx2_load<Aligned>(q + i);
+			if constexpr (std::is_same_v<T, std::int8_t>) {
+				vlo = _mm256_min_epi8(vlo, x);
+				vhi = _mm256_max_epi8(vhi, x);
+			} else if constexpr (std::is_same_v<T, std::uint8_t>) {
+				vlo = _mm256_min_epu8(vlo, x);
+				vhi = _mm256_max_epu8(vhi, x);
+			} else if constexpr (std::is_same_v<T, std::int32_t>) {
+				vlo = _mm256_min_epi32(vlo, x);
+				vhi = _mm256_max_epi32(vhi, x);
+			} else {
+				vlo = _mm256_min_epu32(vlo, x);
+				vhi = _mm256_max_epu32(vhi, x);
+			}
+		}
+		_mm256_store_si256(reinterpret_cast<__m256i *>(lo), vlo);
+		_mm256_store_si256(reinterpret_cast<__m256i *>(hi), vhi);
+	}
+
+	// fold the lanes and whatever did not fill a full block
+	std::pair<T, T> r = {minmax_scalar(lo, lanes).first,
+			     minmax_scalar(hi, lanes).second};
+	const std::size_t tail = n - n % lanes;
+	if (tail < n) {
+		const auto t = minmax_scalar(p + tail, n - tail);
+		if (t.first < r.first)
+			r.first = t.first;
+		if (r.second < t.second)
+			r.second = t.second;
+	}
+	return r;
+}
+
+//===----------------------------------------------------------------------===//
+/// SSE4.1 kernels, 16 bytes per step; same shape as the AVX2 ones.
+//===----------------------------------------------------------------------===//
+template <bool Aligned>
+STEVEMAC_TARGET("sse4.1") inline __m128i sse41_load(const void *p)
+{
+	if constexpr (Aligned)
+		return _mm_load_si128(static_cast<const __m128i *>(p));
+	else
+		return _mm_loadu_si128(static_cast<const __m128i *>(p));
+}
+
+template <bool Aligned>
+STEVEMAC_TARGET("sse4.1") inline __m128 sse41_load_ps(const float *p)
+{
+	if constexpr (Aligned)
+		return _mm_load_ps(p);
+	else
+		return _mm_loadu_ps(p);
+}
+
+template <typename T>
+STEVEMAC_TARGET("sse4.1") inline __m128i sse41_splat(T value)
+{
+	if constexpr (sizeof(T) == 1)
+		return _mm_set1_epi8(static_cast<char>(value));
+	else if constexpr (std::is_same_v<T, float>)
+		return _mm_castps_si128(_mm_set1_ps(value));
+	else
+		return _mm_set1_epi32(static_cast<int>(value));
+}
+
+/// All ones in every byte of a matching lane.
+template <bool Aligned, typename T>
+STEVEMAC_TARGET("sse4.1") inline __m128i sse41_eq(const T *p, __m128i needle)
+{
+	if constexpr (std::is_same_v<T, float>) {
+		const __m128 x = sse41_load_ps<Aligned>(p);
+		return _mm_castps_si128(
+			_mm_cmpeq_ps(x, _mm_castsi128_ps(needle)));
+	} else {
+		const __m128i x = sse41_load<Aligned>(p);
+		if constexpr (sizeof(T) == 1)
+			return _mm_cmpeq_epi8(x, needle);
+		else
+			return _mm_cmpeq_epi32(x, needle);
+	}
+}
+
+template <bool Aligned, typename T>
+STEVEMAC_TARGET("sse4.1") inline unsigned sse41_eq_mask(const T *p, __m128i needle)
+{
+	return _mm_movemask_epi8(sse41_eq<Aligned>(p, needle));
+}
+
+template <bool Aligned, typename T>
+STEVEMAC_TARGET("sse4.1")
+std::size_t find_sse41(const T *p, std::size_t n, T value)
+{
+	constexpr std::size_t lanes = 16 / sizeof(T);
+	const __m128i needle = sse41_splat(value);
+	std::size_t i = 0;
+
+	for (; i + lanes <= n; i += lanes) {
+		const unsigned mask = sse41_eq_mask<Aligned>(p + i, needle);
+		if (mask != 0)
+			return i + __builtin_ctz(mask) / sizeof(T);
+	}
+	return i + find_scalar(p + i, n - i, value);
+}
+
+/// SSE4.1 does not imply popcnt, and __builtin_popcount without it is a
+/// libgcc call per step.  Matches are counted in byte lanes instead: each
+/// compare subtracts -1 from every byte of a matching lane, and psadbw sums
+/// the bytes every 255 steps, before any of them can wrap.
+template <bool Aligned, typename T>
+STEVEMAC_TARGET("sse4.1")
+std::size_t count_sse41(const T *p, std::size_t n, T value)
+{
+	constexpr std::size_t lanes = 16 / sizeof(T);
+	const __m128i needle = sse41_splat(value);
+	const __m128i zero = _mm_setzero_si128();
+	std::size_t i = 0, c = 0;
+
+	while (i + lanes <= n) {
+		__m128i bytes = zero;
+		for (unsigned k = 0; k < 255 && i + lanes <= n; ++k, i += lanes)
+			bytes = _mm_sub_epi8(bytes,
+					     sse41_eq<Aligned>(p + i, needle));
+		const __m128i sums = _mm_sad_epu8(bytes, zero);
+		c += unsigned(_mm_cvtsi128_si32(sums))
+		     + unsigned(_mm_extract_epi16(sums, 4));
+	}
+	return c / sizeof(T) + count_scalar(p + i, n - i, value);
+}
+
+template <bool Aligned, typename T>
+STEVEMAC_TARGET("sse4.1")
+std::pair<T, T> minmax_sse41(const T *p, std::size_t n)
+{
+	constexpr std::size_t lanes = 16 / sizeof(T);
+	if (n < lanes)
+		return minmax_scalar(p, n);
+
+	alignas(16) T lo[lanes], hi[lanes];
+	if constexpr (std::is_same_v<T, float>) {
+		__m128 vlo = sse41_load_ps<Aligned>(p), vhi = vlo;
+		for (std::size_t i = lanes; i + lanes <= n; i += lanes) {
+			const __m128 x = sse41_load_ps<Aligned>(p + i);
+			vlo = _mm_min_ps(vlo, x);
+			vhi = _mm_max_ps(vhi, x);
+		}
+		_mm_store_ps(lo, vlo);
+		_mm_store_ps(hi, vhi);
+	} else {
+		const __m128i *q = reinterpret_cast<const __m128i *>(p);
+		__m128i vlo = sse41_load<Aligned>(q), vhi = vlo;
+		for (std::size_t i = 1; i < n / lanes; ++i) {
+			const __m128i x = sse41_load<Aligned>(q + i);
+			if constexpr (std::is_same_v<T, std::int8_t>) {
+				vlo = _mm_min_epi8(vlo, x);
+				vhi = _mm_max_epi8(vhi, x);
+			} else if constexpr (std::is_same_v<T, std::uint8_t>) {
+				vlo = _mm_min_epu8(vlo, x);
+				vhi = _mm_max_epu8(vhi, x);
+			} else if constexpr (std::is_same_v<T, std::int32_t>) {
+				vlo = _mm_min_epi32(vlo, x);
+				vhi = _mm_max_epi32(vhi, x);
+			} else {
+				vlo = _mm_min_epu32(vlo, x);
+				vhi = _mm_max_epu32(vhi, x);
+			}
+		}
+		_mm_store_si128(reinterpret_cast<__m128i *>(lo), vlo);
+		_mm_store_si128(reinterpret_cast<__m128i *>(hi), vhi);
+	}
+
+	std::pair<T, T> r = {minmax_scalar(lo, lanes).first,
+			     minmax_scalar(hi, lanes).second};
+	const std::size_t tail = n - n % lanes;
+	if (tail < n) {
+		const auto t = minmax_scalar(p + tail, n - tail);
+		if (t.first < r.first)
+			r.first = t.first;
+		if (r.second < t.second)
+			r.second = t.second;
+	}
+	return r;
+}
+#endif // STEVEMAC_SIMD_X86
+
+//===----------------------------------------------------------------------===//
+/// dispatch, picks the widest kernel the CPU supports for T
+//===----------------------------------------------------------------------===//
+template <bool Aligned, typename T>
+std::size_t find_index(const T *p, std::size_t n, const T &value)
+{
+#if STEVEMAC_SIMD_X86
+	if constexpr (simd_searchable_v<T>) {
+		switch (simd_dispatch_level()) {
+		case simd_level::avx2:
+			return find_avx2<Aligned>(p, n, value);
+		case simd_level::sse41:
+			return find_sse41<Aligned>(p, n, value);
+		default:
+			break;
+		}
+	}
+#endif
+	return find_scalar(p, n, value);
+}
+
+template <bool Aligned, typename T>
+std::size_t count_equal(const T *p, std::size_t n, const T &value)
+{
+#if STEVEMAC_SIMD_X86
+	if constexpr (simd_searchable_v<T>) {
+		switch (simd_dispatch_level()) {
+		case simd_level::avx2:
+			return count_avx2<Aligned>(p, n, value);
+		case simd_level::sse41:
+			return count_sse41<Aligned>(p, n, value);
+		default:
+			break;
+		}
+	}
+#endif
+	return count_scalar(p, n, value);
+}
+
+template <bool Aligned, typename T>
+std::pair<T, T> minmax_range(const T *p, std::size_t n)
+{
+#if STEVEMAC_SIMD_X86
+	if constexpr (simd_searchable_v<T>) {
+		switch (simd_dispatch_level()) {
+		case simd_level::avx2:
+			return minmax_avx2<Aligned>(p, n);
+		case simd_level::sse41:
+			return minmax_sse41<Aligned>(p, n);
+		default:
+			break;
+		}
+	}
+#endif
+	return minmax_scalar(p, n);
+}
+} // namespace detail
+
+//===----------------------------------------------------------------------===//
+/// public interface
+//===----------------------------------------------------------------------===//
+/// true when data() is known at compile time to be 32 byte aligned, which
+/// lets the kernels use aligned loads.
+template <typename T, class Allocator>
+constexpr bool aligned_scan_v = is_aligned_v<vector<T, Allocator>, 32>;
+
+/// Returns an iterator to the first element equal to value, or end().
+template <typename T, class Allocator>
+typename vector<T, Allocator>::iterator find(vector<T, Allocator> &v,
+					     const T &value)
+{
+	const std::size_t i = detail::find_index<aligned_scan_v<T, Allocator>>(
+		v.data(), v.size(), value);
+	return typename vector<T, Allocator>::iterator(v.data() + i);
+}
+
+template <typename T, class Allocator>
+typename vector<T, Allocator>::const_iterator
+find(const vector<T, Allocator> &v, const T &value)
+{
+	const std::size_t i = detail::find_index<aligned_scan_v<T, Allocator>>(
+		v.data(), v.size(), value);
+	return typename vector<T, Allocator>::const_iterator(
+		const_cast<T *>(v.data()) + i);
+}
+
+template <typename T, class Allocator>
+typename vector<T, Allocator>::size_type count(const vector<T, Allocator> &v,
+					       const T &value)
+{
+	return detail::count_equal<aligned_scan_v<T, Allocator>>(
+		v.data(), v.size(), value);
+}
+
+template <typename T, class Allocator>
+bool contains(const vector<T, Allocator> &v, const T &value)
+{
+	return detail::find_index<aligned_scan_v<T, Allocator>>(
+		       v.data(), v.size(), value)
+	       < v.size();
+}
+
+/// Returns {smallest, largest}.
+/// Requires: !v.empty().
+template <typename T, class Allocator>
+std::pair<T, T> minmax(const vector<T, Allocator> &v)
+{
+	assert(!v.empty());
+	return detail::minmax_range<aligned_scan_v<T, Allocator>>(v.data(),
+								  v.size());
+}
+} // namespace stevemac
@@ -0,0 +1,128 @@
+//===-- stevemac::aligned_allocator.h -----------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#pragma once
+#include "vector.h"
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+namespace stevemac
+{
+///===----------------------------------------------------------------------===//
+///
+/// \class stevemac::aligned_allocator
+/// \brief Allocator whose buffers start on an Alignment byte boundary (32
+/// for AVX, 64 for a cache line).  With PadCapacity, stevemac::vector rounds
+/// every capacity up to whole Alignment byte blocks, so a SIMD loop over
+/// [data(), data() + capacity()) never needs a scalar tail and two vectors
+/// never share a cache line.
+/// It has no construct/destroy of its own, so vector still copies and
+/// fills trivially copyable T as bytes (and streams large ones).
+///
+//===----------------------------------------------------------------------===//
+template <typename T, std::size_t Alignment = 64, bool PadCapacity = false>
+class aligned_allocator
+{
+	static_assert((Alignment & (Alignment - 1)) == 0,
+		      "Alignment must be a power of two");
+	static_assert(Alignment >= alignof(T),
+		      "Alignment must be at least alignof(T)");
+
+      public:
+	using value_type = T;
+	using pointer = T *;
+	using const_pointer = const T *;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+	using propagate_on_container_move_assignment = std::true_type;
+	using is_always_equal = std::true_type;
+
+	static constexpr std::size_t alignment = Alignment;
+
+	template <class U> struct rebind {
+		using other = aligned_allocator<U, Alignment, PadCapacity>;
+	};
+
+	aligned_allocator() noexcept = default;
+	template <class U>
+	aligned_allocator(
+		const aligned_allocator<U, Alignment, PadCapacity> &) noexcept
+	{
+	}
+
+	T *allocate(size_type n)
+	{
+		if (n > std::numeric_limits<size_type>::max() / sizeof(T))
+			throw std::bad_array_new_length();
+		return static_cast<T *>(::operator new(
+			n * sizeof(T), std::align_val_t(Alignment)));
+	}
+
+	void deallocate(T *p, size_type) noexcept
+	{
+		::operator delete(p, std::align_val_t(Alignment));
+	}
+
+	/// Capacity hook picked up by vector::reallocate: rounds n up to the
+	/// next multiple of Alignment / sizeof(T) elements.
+	static constexpr size_type pad_capacity(size_type n) noexcept
+	{
+		if constexpr (PadCapacity && Alignment % sizeof(T) == 0) {
+			constexpr size_type per = Alignment / sizeof(T);
+			return (n + per - 1) / per * per;
+		} else {
+			return n;
+		}
+	}
+};
+
+template <class T, class U, std::size_t A, bool P>
+bool operator==(const aligned_allocator<T, A, P> &,
+		const aligned_allocator<U, A, P> &) noexcept
+{
+	return true;
+}
+
+template <class T, class U, std::size_t A, bool P>
+bool operator!=(const aligned_allocator<T, A, P> &,
+		const aligned_allocator<U, A, P> &) noexcept
+{
+	return false;
+}
+
+//===----------------------------------------------------------------------===//
+/// compile time alignment queries
+/// allocator_alignment_v is the alignment an allocator promises for its
+/// buffers; anything we do not know about only promises alignof(T).
+/// is_aligned_v<Container, N> lets a kernel pick aligned loads statically.
+//===----------------------------------------------------------------------===//
+template <class Allocator>
+struct allocator_alignment
+    : std::integral_constant<
+	      std::size_t,
+	      alignof(typename std::allocator_traits<Allocator>::value_type)> {
+};
+
+template <class T, std::size_t Alignment, bool PadCapacity>
+struct allocator_alignment<aligned_allocator<T, Alignment, PadCapacity>>
+    : std::integral_constant<std::size_t, Alignment> {
+};
+
+template <class Allocator>
+constexpr std::size_t allocator_alignment_v =
+	allocator_alignment<Allocator>::value;
+
+template <class Container, std::size_t N = 32>
+constexpr bool is_aligned_v =
+	allocator_alignment_v<typename Container::allocator_type> >= N;
+
+/// The common case: cache line aligned, capacity padded to whole lines.
+template <class T, std::size_t Alignment = 64>
+using aligned_vector = vector<T, aligned_allocator<T, Alignment, true>>;
+} // namespace stevemac
@@ -0,0 +1,79 @@
+//===-- stevemac::bench.h -----------------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+namespace stevemac
+{
+namespace bench
+{
+///===----------------------------------------------------------------------===//
+///
+/// Shared bits of the bench_*.cpp programs.
+/// Each program prints one table to stdout and takes an optional scale
+/// factor as argv[1] (default 1) that multiplies its problem sizes, so a
+/// quick run and a long one use the same code.  Times are the best of a
+/// few runs, which is what repeatable numbers on a shared box need.
+//===----------------------------------------------------------------------===//
+using clock = std::chrono::steady_clock;
+
+/// Best of reps runs of f, in seconds.
+template <class F> double best_of(int reps, F &&f)
+{
+	double best = 0;
+	for (int r = 0; r < reps; ++r) {
+		const clock::time_point t = clock::now();
+		f();
+		const double s =
+			std::chrono::duration<double>(clock::now() - t).count();
+		if (r == 0 || s < best)
+			best = s;
+	}
+	return best;
+}
+
+/// Keeps the compiler from dropping a result nobody reads.
+template <class T> void keep(const T &value)
+{
+	asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/// xorshift64*, reproducible input without <random>'s overhead.
+class rng
+{
+      public:
+	explicit rng(std::uint64_t seed = 0x9e3779b97f4a7c15) : _s(seed | 1) {}
+
+	std::uint64_t operator()() noexcept
+	{
+		_s ^= _s >> 12;
+		_s ^= _s << 25;
+		_s ^= _s >> 27;
+		return _s * 0x2545f4914f6cdd1d;
+	}
+
+      private:
+	std::uint64_t _s;
+};
+
+/// argv[1] as a floating point scale, 1 without it.
+inline double scale(int argc, char **argv)
+{
+	const double s = argc > 1 ? std::atof(argv[1]) : 1.0;
+	return s > 0 ? s : 1.0;
+}
+
+inline std::size_t scaled(std::size_t n, double s)
+{
+	const std::size_t m = std::size_t(double(n) * s);
+	return m == 0 ? 1 : m;
+}
+} // namespace bench
+} // namespace stevemac
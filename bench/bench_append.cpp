@@ -0,0 +1,92 @@
+//===-- stevemac::bench_append.cpp --------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#include "bench.h"
+#include "vector.h"
+#include <algorithm>
+#include <cstdio>
+
+///===----------------------------------------------------------------------===//
+///
+/// Appending n ints to a vector<int> in batches of k, ns per element.
+/// Copies of a k element batch:
+///   push_back     one push_back per element
+///   insert(end)   insert(end(), first, last)
+///   append_range  append_range(batch)
+/// k copies of one value:
+///   push_back     one push_back(value) per element
+///   append_n      append_n(k, value)
+///   generate      generate_back_n(k, counter)
+/// The vector is cleared, keeping its capacity, whenever it passes 1M
+/// elements, so growth is paid once and the batch path is what is timed.
+//===----------------------------------------------------------------------===//
+using namespace stevemac;
+
+namespace
+{
+constexpr int reps = 5;
+constexpr std::size_t limit = std::size_t(1) << 20;
+} // namespace
+
+int main(int argc, char **argv)
+{
+	const std::size_t n = bench::scaled(std::size_t(20000000),
+					    bench::scale(argc, argv));
+
+	std::printf("%zu ints, ns per element\n", n);
+	std::printf("%7s  %9s %11s %12s  %9s %9s %9s\n", "k", "push_back",
+		    "insert(end)", "append_range", "push_back", "append_n",
+		    "generate");
+	for (const std::size_t k : {std::size_t(16), std::size_t(1000),
+				    std::size_t(100000)}) {
+		vector<int> batch;
+		for (std::size_t i = 0; i < k; ++i)
+			batch.push_back(int(i));
+		const std::size_t rounds = std::max<std::size_t>(1, n / k);
+
+		auto ns = [&](auto append) {
+			return bench::best_of(reps,
+					      [&] {
+						      vector<int> v;
+						      for (std::size_t r = 0;
+							   r < rounds; ++r) {
+							      append(v);
+							      if (v.size() > limit)
+								      v.clear();
+						      }
+						      bench::keep(v.data());
+					      })
+			       * 1e9 / double(rounds * k);
+		};
+
+		const double push_copy = ns([&](vector<int> &v) {
+			for (int x : batch)
+				v.push_back(x);
+		});
+		const double insert_end = ns([&](vector<int> &v) {
+			v.insert(v.end(), batch.begin(), batch.end());
+		});
+		const double append_range = ns([&](vector<int> &v) {
+			v.append_range(batch);
+		});
+		const double push_value = ns([&](vector<int> &v) {
+			for (std::size_t i = 0; i < k; ++i)
+				v.push_back(7);
+		});
+		const double append_n = ns([&](vector<int> &v) {
+			v.append_n(k, 7);
+		});
+		int counter = 0;
+		const double generate = ns([&](vector<int> &v) {
+			v.generate_back_n(k, [&] { return counter++; });
+		});
+
+		std::printf("%7zu  %9.2f %11.2f %12.2f  %9.2f %9.2f %9.2f\n", k,
+			    push_copy, insert_end, append_range, push_value,
+			    append_n, generate);
+	}
+	return 0;
+}
@@ -0,0 +1,92 @@
+//===-- stevemac::bench_compressed_vector.cpp ---------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#include "bench.h"
+#include "compressed_vector.h"
+#include <cstdint>
+#include <cstdio>
+
+///===----------------------------------------------------------------------===//
+///
+/// compressed_vector<uint32_t> against the plain vector it was built from,
+/// for three kinds of data: slowly rising values (timestamps, ids), random
+/// 12 bit values and random full width ones.  Decode is block by block
+/// into a scratch buffer, in GB/s of uncompressed output; the scan sums
+/// through the iterator; random access is 1M operator[] calls, in ms.
+//===----------------------------------------------------------------------===//
+using namespace stevemac;
+
+namespace
+{
+constexpr int reps = 5;
+
+template <class Gen> void row(const char *name, std::size_t n, Gen gen)
+{
+	vector<std::uint32_t> v;
+	v.reserve(n);
+	for (std::size_t i = 0; i < n; ++i)
+		v.push_back(gen(i));
+	const compressed_vector<std::uint32_t> c(v);
+	const double gb = double(n * sizeof(std::uint32_t)) / 1e9;
+
+	std::uint32_t buf[compressed_vector<std::uint32_t>::block_size];
+	const double decode = bench::best_of(reps, [&] {
+		for (std::size_t b = 0; b < c.block_count(); ++b) {
+			c.decode_block(b, buf);
+			bench::keep(buf[0]);
+		}
+	});
+	const double scan = bench::best_of(reps, [&] {
+		std::uint64_t sum = 0;
+		for (std::uint32_t x : c)
+			sum += x;
+		bench::keep(sum);
+	});
+	const double plain_scan = bench::best_of(reps, [&] {
+		std::uint64_t sum = 0;
+		for (std::size_t i = 0; i < n; ++i)
+			sum += v.data()[i];
+		bench::keep(sum);
+	});
+	bench::rng r;
+	vector<std::size_t> idx;
+	for (int i = 0; i < 1000000; ++i)
+		idx.push_back(r() % n);
+	const double random = bench::best_of(reps, [&] {
+		std::uint64_t sum = 0;
+		for (std::size_t i : idx)
+			sum += c[i];
+		bench::keep(sum);
+	});
+	const double plain_random = bench::best_of(reps, [&] {
+		std::uint64_t sum = 0;
+		for (std::size_t i : idx)
+			sum += v[i];
+		bench::keep(sum);
+	});
+
+	std::printf("%-10s %10zu  %6.2f  %8.2f  %8.2f %8.2f  %8.2f %8.2f\n",
+		    name, n, c.compression_ratio(), gb / decode, gb / scan,
+		    gb / plain_scan, random * 1e3, plain_random * 1e3);
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+	const double sc = bench::scale(argc, argv);
+	const std::size_t n = bench::scaled(std::size_t(1) << 24, sc);
+	bench::rng r;
+
+	std::printf("%-10s %10s  %6s  %8s  %8s %8s  %8s %8s\n", "data", "n",
+		    "ratio", "decode", "scan", "plain", "random", "plain");
+	std::printf("%-10s %10s  %6s  %8s  %8s %8s  %8s %8s\n", "", "", "",
+		    "GB/s", "GB/s", "GB/s", "ms", "ms");
+	std::uint32_t t = 1000000;
+	row("rising", n, [&](std::size_t) { return t += std::uint32_t(r() % 16); });
+	row("12 bit", n, [&](std::size_t) { return std::uint32_t(r() % 4096); });
+	row("random", n, [&](std::size_t) { return std::uint32_t(r()); });
+	return 0;
+}
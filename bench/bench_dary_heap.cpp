@@ -0,0 +1,69 @@
+//===-- stevemac::bench_dary_heap.cpp -----------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#include "bench.h"
+#include "dary_heap.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <queue>
+
+///===----------------------------------------------------------------------===//
+///
+/// Push n random uint64_t, then pop them all: ns per push+pop pair for
+/// std::priority_queue (a binary heap over std::vector) and dary_heap
+/// with D = 2, 4 and 8, from heaps that fit in L1 to ones that do not fit
+/// in any cache.  Small heaps are rebuilt many times and the total is
+/// averaged.
+//===----------------------------------------------------------------------===//
+using namespace stevemac;
+
+namespace
+{
+constexpr int reps = 3;
+
+template <class Heap> double ns_per_op(std::size_t n, std::size_t rounds)
+{
+	return bench::best_of(reps,
+			      [&] {
+				      for (std::size_t r = 0; r < rounds; ++r) {
+					      Heap h;
+					      bench::rng g(r + 1);
+					      for (std::size_t i = 0; i < n; ++i)
+						      h.push(g());
+					      std::uint64_t sum = 0;
+					      while (!h.empty()) {
+						      sum += h.top();
+						      h.pop();
+					      }
+					      bench::keep(sum);
+				      }
+			      })
+	       * 1e9 / double(n * rounds);
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+	const double sc = bench::scale(argc, argv);
+
+	std::printf("ns per push+pop\n");
+	std::printf("%10s %8s %8s %8s %8s\n", "n", "std::pq", "D=2", "D=4",
+		    "D=8");
+	for (const std::size_t base : {std::size_t(1000), std::size_t(100000),
+				       std::size_t(10000000),
+				       std::size_t(100000000)}) {
+		const std::size_t n = bench::scaled(base, sc);
+		const std::size_t rounds = std::max<std::size_t>(1, 4000000 / n);
+		std::printf("%10zu %8.1f %8.1f %8.1f %8.1f\n", n,
+			    ns_per_op<std::priority_queue<std::uint64_t>>(n,
+									   rounds),
+			    ns_per_op<dary_heap<std::uint64_t, 2>>(n, rounds),
+			    ns_per_op<dary_heap<std::uint64_t, 4>>(n, rounds),
+			    ns_per_op<dary_heap<std::uint64_t, 8>>(n, rounds));
+	}
+	return 0;
+}
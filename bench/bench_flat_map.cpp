@@ -0,0 +1,105 @@
+//===-- stevemac::bench_flat_map.cpp ------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#include "bench.h"
+#include "flat_map.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <unordered_map>
+
+///===----------------------------------------------------------------------===//
+///
+/// Random lookups of uint32_t keys mapping to uint32_t, half of them hits:
+/// flat_map with its branchless search and with build_index(), against
+/// std::binary_search over the same sorted keys, std::map and
+/// std::unordered_map.  Also the cost of building each from unsorted
+/// input.  Seconds for the whole query batch.
+//===----------------------------------------------------------------------===//
+using namespace stevemac;
+
+namespace
+{
+constexpr int reps = 3;
+
+template <class Probe>
+double lookups(const vector<std::uint32_t> &queries, Probe probe)
+{
+	return bench::best_of(reps, [&] {
+		std::size_t hits = 0;
+		for (std::uint32_t q : queries)
+			hits += probe(q);
+		bench::keep(hits);
+	});
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+	const double sc = bench::scale(argc, argv);
+	const std::size_t nq = bench::scaled(std::size_t(2) << 20, sc);
+
+	std::printf("%u queries, seconds\n", unsigned(nq));
+	std::printf("%10s  %8s %8s %8s %8s %8s  %8s %8s %8s\n", "keys",
+		    "branchls", "eytzing", "std::bs", "map", "unord",
+		    "build fm", "map", "unord");
+	for (const std::size_t base : {std::size_t(1) << 10, std::size_t(1) << 16,
+				       std::size_t(1) << 20, std::size_t(1) << 23}) {
+		const std::size_t n = bench::scaled(base, sc);
+		bench::rng r(n);
+		vector<std::uint32_t> keys, values;
+		keys.reserve(n);
+		values.reserve(n);
+		for (std::size_t i = 0; i < n; ++i) {
+			keys.push_back(std::uint32_t(r()) | 1); // odd keys
+			values.push_back(std::uint32_t(i));
+		}
+		vector<std::uint32_t> queries;
+		queries.reserve(nq);
+		for (std::size_t i = 0; i < nq; ++i) {
+			const std::uint32_t k = keys[r() % n];
+			queries.push_back(i % 2 ? k : k - 1); // misses are even
+		}
+
+		flat_map<std::uint32_t, std::uint32_t> fm;
+		const double build_fm = bench::best_of(reps, [&] {
+			fm = flat_map<std::uint32_t, std::uint32_t>(keys, values);
+		});
+		std::map<std::uint32_t, std::uint32_t> m;
+		const double build_m = bench::best_of(reps, [&] {
+			m.clear();
+			for (std::size_t i = 0; i < n; ++i)
+				m.emplace(keys[i], values[i]);
+		});
+		std::unordered_map<std::uint32_t, std::uint32_t> um;
+		const double build_um = bench::best_of(reps, [&] {
+			um.clear();
+			for (std::size_t i = 0; i < n; ++i)
+				um.emplace(keys[i], values[i]);
+		});
+
+		const double branchless = lookups(
+			queries, [&](std::uint32_t q) { return fm.contains(q); });
+		fm.build_index();
+		const double eytzinger = lookups(
+			queries, [&](std::uint32_t q) { return fm.contains(q); });
+		const vector<std::uint32_t> &sorted = fm.keys();
+		const double bs = lookups(queries, [&](std::uint32_t q) {
+			return std::binary_search(sorted.data(),
+						  sorted.data() + sorted.size(), q);
+		});
+		const double map = lookups(
+			queries, [&](std::uint32_t q) { return m.count(q) != 0; });
+		const double unord = lookups(
+			queries, [&](std::uint32_t q) { return um.count(q) != 0; });
+
+		std::printf("%10zu  %8.3f %8.3f %8.3f %8.3f %8.3f  %8.3f %8.3f %8.3f\n",
+			    fm.size(), branchless, eytzinger, bs, map, unord,
+			    build_fm, build_m, build_um);
+	}
+	return 0;
+}
@@ -0,0 +1,84 @@
+//===-- stevemac::bench_gather.cpp --------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#include "bench.h"
+#include "gather.h"
+#include <cstdint>
+#include <cstdio>
+
+///===----------------------------------------------------------------------===//
+///
+/// Random gathers and scatters of uint32_t through uint32_t indices, ns
+/// per element, from a table that fits in cache and from one that does
+/// not.  "naive" is the operator[] loop; gather and scatter run with
+/// prefetching off and at two distances, gather also through the scalar
+/// kernel and with sorted batches (which only pays when indices cluster;
+/// these are uniform).
+//===----------------------------------------------------------------------===//
+using namespace stevemac;
+
+int main(int argc, char **argv)
+{
+	const double sc = bench::scale(argc, argv);
+	const std::size_t n = bench::scaled(std::size_t(1) << 24, sc);
+	constexpr int reps = 3;
+
+	std::printf("%zu indices, ns per element\n", n);
+	std::printf("%10s  %6s %6s %6s %6s %6s %6s  %6s %6s %6s\n", "table MiB",
+		    "naive", "d=0", "d=16", "d=64", "scalar", "sorted", "naive",
+		    "d=0", "d=16");
+	std::printf("%10s  %6s %6s %6s %6s %6s %6s  %6s %6s %6s\n", "", "gather",
+		    "", "", "", "", "", "scattr", "", "");
+	for (const std::size_t base : {std::size_t(1) << 18, std::size_t(1) << 27}) {
+		const std::size_t size = bench::scaled(base, sc);
+		vector<std::uint32_t> table(size, std::uint32_t(1));
+		vector<std::uint32_t> idx;
+		idx.reserve(n);
+		bench::rng r(size);
+		for (std::size_t i = 0; i < n; ++i)
+			idx.push_back(std::uint32_t(r() % size));
+		vector<std::uint32_t> out(n, std::uint32_t(0));
+
+		auto ns = [&](auto op) {
+			return bench::best_of(reps, op) * 1e9 / double(n);
+		};
+		auto with = [](std::size_t d, bool sorted) {
+			gather_options o;
+			o.prefetch_distance = d;
+			o.sort_batches = sorted;
+			return o;
+		};
+
+		const double naive = ns([&] {
+			for (std::size_t i = 0; i < n; ++i)
+				out[i] = table[idx[i]];
+			bench::keep(out.data());
+		});
+		const double d0 = ns([&] { gather(table, idx, out, with(0, false)); });
+		const double d16 = ns([&] { gather(table, idx, out, with(16, false)); });
+		const double d64 = ns([&] { gather(table, idx, out, with(64, false)); });
+		const double scalar = ns([&] {
+			detail::gather_scalar(table.data(), idx.data(), n, out.data(),
+					      16);
+			bench::keep(out.data());
+		});
+		const double sorted = ns([&] { gather(table, idx, out, with(16, true)); });
+
+		const double s_naive = ns([&] {
+			for (std::size_t i = 0; i < n; ++i)
+				table[idx[i]] = out[i];
+			bench::keep(table.data());
+		});
+		const double s0 = ns([&] { scatter(table, idx, out, with(0, false)); });
+		const double s16 = ns([&] { scatter(table, idx, out, with(16, false)); });
+
+		std::printf("%10.1f  %6.2f %6.2f %6.2f %6.2f %6.2f %6.2f  %6.2f %6.2f "
+			    "%6.2f\n",
+			    double(size * sizeof(std::uint32_t)) / (1 << 20), naive,
+			    d0, d16, d64, scalar, sorted, s_naive, s0, s16);
+	}
+	return 0;
+}
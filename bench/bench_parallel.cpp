@@ -0,0 +1,61 @@
+//===-- stevemac::bench_parallel.cpp ------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#include "bench.h"
+#include "execution.h"
+#include "vector.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+
+///===----------------------------------------------------------------------===//
+///
+/// Parallel first-touch construction, vector(par, n, value), against the
+/// serial constructor, then a scan of the result split with
+/// for_each_chunk over data(), so each thread reads the pages it touched.
+/// GB/s for 1, 2, 4 ... hardware_concurrency() threads.  On one socket
+/// this shows the fill bandwidth threads add; the page placement only pays
+/// on a NUMA box.
+//===----------------------------------------------------------------------===//
+using namespace stevemac;
+
+int main(int argc, char **argv)
+{
+	const double sc = bench::scale(argc, argv);
+	const std::size_t n = bench::scaled(std::size_t(64) << 20, sc);
+	const double gb = double(n * sizeof(std::uint64_t)) / 1e9;
+	constexpr int reps = 3;
+	const unsigned hw = std::thread::hardware_concurrency();
+
+	const double serial = bench::best_of(reps, [&] {
+		vector<std::uint64_t> v(n, std::uint64_t(1));
+		bench::keep(v.data());
+	});
+	std::printf("%zu uint64, GB/s; serial construct %.2f\n", n, gb / serial);
+	std::printf("%8s %10s %10s\n", "threads", "construct", "scan");
+	for (unsigned t = 1; t <= (hw > 1 ? hw : 2); t *= 2) {
+		const parallel_policy policy{t, 0};
+		const double fill = bench::best_of(reps, [&] {
+			vector<std::uint64_t> v(policy, n, std::uint64_t(1));
+			bench::keep(v.data());
+		});
+		const vector<std::uint64_t> v(policy, n, std::uint64_t(1));
+		const double scan = bench::best_of(reps, [&] {
+			std::atomic<std::uint64_t> total{0};
+			for_each_chunk(policy, v.data(), v.size(),
+				       [&](std::size_t b, std::size_t e) {
+					       std::uint64_t sum = 0;
+					       for (std::size_t i = b; i < e; ++i)
+						       sum += v.data()[i];
+					       total += sum;
+				       });
+			bench::keep(total.load());
+		});
+		std::printf("%8u %10.2f %10.2f\n", t, gb / fill, gb / scan);
+	}
+	return 0;
+}
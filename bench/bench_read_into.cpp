@@ -0,0 +1,103 @@
+//===-- stevemac::bench_read_into.cpp -----------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#include "bench.h"
+#include "io.h"
+#include "vector.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <vector>
+
+///===----------------------------------------------------------------------===//
+///
+/// Ingesting a file that is in the page cache into a growing byte vector,
+/// in GB/s.  std::vector has two ways to do it: resize() then read into
+/// the zero filled tail, or read into a buffer and insert() it, an extra
+/// copy.  read_into reads straight into spare capacity, with or without a
+/// reserve() up front.  Read from a temporary file under TMPDIR.
+//===----------------------------------------------------------------------===//
+using namespace stevemac;
+
+namespace
+{
+constexpr int reps = 5;
+constexpr std::size_t step = 64 * 1024;
+} // namespace
+
+int main(int argc, char **argv)
+{
+	const double sc = bench::scale(argc, argv);
+	const std::size_t n = bench::scaled(std::size_t(256) << 20, sc);
+
+	const char *dir = std::getenv("TMPDIR");
+	std::string path = std::string(dir ? dir : "/tmp") + "/bench_read_XXXXXX";
+	const int fd = ::mkstemp(path.data());
+	if (fd < 0) {
+		std::perror("mkstemp");
+		return 1;
+	}
+	::unlink(path.c_str());
+	{
+		vector<char> block(step, 'x');
+		for (std::size_t done = 0; done < n; done += step)
+			if (::write(fd, block.data(), step) != ::ssize_t(step)) {
+				std::perror("write");
+				return 1;
+			}
+	}
+
+	auto gbs = [&](auto ingest) {
+		const double s = bench::best_of(reps, [&] {
+			::lseek(fd, 0, SEEK_SET);
+			ingest();
+		});
+		return double(n) / s / 1e9;
+	};
+
+	const double resize = gbs([&] {
+		std::vector<char> v;
+		for (;;) {
+			const std::size_t old = v.size();
+			v.resize(old + step);
+			const ::ssize_t got = ::read(fd, v.data() + old, step);
+			v.resize(old + std::size_t(got > 0 ? got : 0));
+			if (got <= 0)
+				break;
+		}
+		bench::keep(v.data());
+	});
+	const double insert = gbs([&] {
+		std::vector<char> v;
+		static char buf[step];
+		::ssize_t got;
+		while ((got = ::read(fd, buf, step)) > 0)
+			v.insert(v.end(), buf, buf + got);
+		bench::keep(v.data());
+	});
+	const double into = gbs([&] {
+		vector<char> v;
+		while (read_into(fd, v, step * 16) > 0) {
+		}
+		bench::keep(v.data());
+	});
+	const double into_reserved = gbs([&] {
+		vector<char> v;
+		v.reserve(n);
+		while (read_into(fd, v, step * 16) > 0) {
+		}
+		bench::keep(v.data());
+	});
+	::close(fd);
+
+	std::printf("%zu MiB, GB/s\n%10s %10s %10s %10s\n", n >> 20,
+		    "resize", "insert", "read_into", "reserved");
+	std::printf("%10.2f %10.2f %10.2f %10.2f\n", resize, insert, into,
+		    into_reserved);
+	return 0;
+}
@@ -0,0 +1,92 @@
+//===-- stevemac::bench_simd.cpp ----------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#include "algorithm.h"
+#include "bench.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+
+///===----------------------------------------------------------------------===//
+///
+/// find (value absent, so a full scan), count and minmax from algorithm.h
+/// against the std algorithms and the scalar reference, for the SIMD
+/// searchable element types, from an L1 sized vector to a DRAM sized one.
+/// "sse4.1" and "avx2" call those kernels directly so both show up on an
+/// AVX2 box; "stevemac" is the dispatched public call.  GB/s scanned.
+//===----------------------------------------------------------------------===//
+using namespace stevemac;
+
+namespace
+{
+constexpr int reps = 5;
+
+template <typename T> void row(const char *name, std::size_t bytes)
+{
+	const std::size_t n = bytes / sizeof(T);
+	vector<T> v;
+	v.reserve(n);
+	bench::rng r;
+	for (std::size_t i = 0; i < n; ++i)
+		v.push_back(T(r() % 100)); // 200 never occurs, 7 often does
+	const T *p = v.data();
+	const T absent = T(200), common = T(7);
+	const std::size_t inner = std::max<std::size_t>(1, (64 << 20) / bytes);
+
+	auto gbs = [&](auto op) {
+		const double s = bench::best_of(reps, [&] {
+			for (std::size_t k = 0; k < inner; ++k)
+				bench::keep(op());
+		});
+		return double(bytes) * double(inner) / s / 1e9;
+	};
+
+	const double std_find =
+		gbs([&] { return std::find(p, p + n, absent) - p; });
+	const double scalar_find =
+		gbs([&] { return detail::find_scalar(p, n, absent); });
+	double sse_find = 0, avx_find = 0, sse_count = 0, avx_count = 0;
+#if STEVEMAC_SIMD_X86
+	if (simd_dispatch_level() != simd_level::scalar) {
+		sse_find = gbs([&] { return detail::find_sse41<false>(p, n, absent); });
+		sse_count = gbs([&] { return detail::count_sse41<false>(p, n, common); });
+	}
+	if (simd_dispatch_level() == simd_level::avx2) {
+		avx_find = gbs([&] { return detail::find_avx2<false>(p, n, absent); });
+		avx_count = gbs([&] { return detail::count_avx2<false>(p, n, common); });
+	}
+#endif
+	const double sm_find = gbs([&] { return find(v, absent) - v.begin(); });
+	const double std_count = gbs([&] { return std::count(p, p + n, common); });
+	const double sm_count = gbs([&] { return count(v, common); });
+	const double std_minmax =
+		gbs([&] { return *std::minmax_element(p, p + n).first; });
+	const double sm_minmax = gbs([&] { return minmax(v).first; });
+
+	std::printf("%-7s %9zu  %6.1f %6.1f %6.1f %6.1f %6.1f  %6.1f %6.1f %6.1f "
+		    "%6.1f  %6.1f %6.1f\n",
+		    name, bytes >> 10, std_find, scalar_find, sse_find, avx_find,
+		    sm_find, std_count, sse_count, avx_count, sm_count,
+		    std_minmax, sm_minmax);
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+	const double sc = bench::scale(argc, argv);
+	std::printf("GB/s; 0 = kernel not available on this CPU\n");
+	std::printf("%-7s %9s  %6s %6s %6s %6s %6s  %6s %6s %6s %6s  %6s %6s\n",
+		    "type", "KiB", "find", "scalar", "sse4.1", "avx2", "stvmac",
+		    "count", "sse4.1", "avx2", "stvmac", "minmax", "stvmac");
+	for (const std::size_t base : {std::size_t(16) << 10, std::size_t(1) << 20,
+				       std::size_t(64) << 20}) {
+		const std::size_t bytes = bench::scaled(base, sc) & ~std::size_t(63);
+		row<std::uint8_t>("uint8", bytes);
+		row<std::int32_t>("int32", bytes);
+		row<float>("float", bytes);
+	}
+	return 0;
+}
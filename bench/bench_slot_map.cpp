@@ -0,0 +1,88 @@
+//===-- stevemac::bench_slot_map.cpp ------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#include "bench.h"
+#include "slot_map.h"
+#include <cstdint>
+#include <cstdio>
+#include <unordered_map>
+
+///===----------------------------------------------------------------------===//
+///
+/// slot_map<double> against std::unordered_map<uint32_t, double> holding
+/// the same values, after inserting n and erasing every third one so the
+/// map has holes and the slot_map has swapped values around: ns per
+/// element for a full iteration, and per lookup for random lookups by key.
+//===----------------------------------------------------------------------===//
+using namespace stevemac;
+
+namespace
+{
+constexpr int reps = 5;
+}
+
+int main(int argc, char **argv)
+{
+	const std::size_t n = bench::scaled(std::size_t(1) << 20,
+					     bench::scale(argc, argv));
+
+	slot_map<double> slots;
+	std::unordered_map<std::uint32_t, double> map;
+	vector<slot_map_key> keys;
+	keys.reserve(n);
+	for (std::size_t i = 0; i < n; ++i) {
+		keys.push_back(slots.insert(double(i)));
+		map.emplace(std::uint32_t(i), double(i));
+	}
+	for (std::size_t i = 0; i < n; i += 3) {
+		slots.erase(keys[i]);
+		map.erase(std::uint32_t(i));
+	}
+
+	vector<std::uint32_t> queries;
+	queries.reserve(n);
+	bench::rng r;
+	for (std::size_t i = 0; i < n; ++i)
+		queries.push_back(std::uint32_t(r() % n));
+
+	const double live = double(slots.size());
+	const double iter_slots = bench::best_of(reps, [&] {
+		double sum = 0;
+		for (double v : slots)
+			sum += v;
+		bench::keep(sum);
+	});
+	const double iter_map = bench::best_of(reps, [&] {
+		double sum = 0;
+		for (auto &p : map)
+			sum += p.second;
+		bench::keep(sum);
+	});
+	const double find_slots = bench::best_of(reps, [&] {
+		double sum = 0;
+		for (std::uint32_t q : queries)
+			if (const double *p = slots.find(keys[q]))
+				sum += *p;
+		bench::keep(sum);
+	});
+	const double find_map = bench::best_of(reps, [&] {
+		double sum = 0;
+		for (std::uint32_t q : queries) {
+			auto it = map.find(q);
+			if (it != map.end())
+				sum += it->second;
+		}
+		bench::keep(sum);
+	});
+
+	std::printf("%zu inserted, %.0f live\n", n, live);
+	std::printf("%-14s %10s %10s\n", "ns", "slot_map", "unord_map");
+	std::printf("%-14s %10.2f %10.2f\n", "iterate/elem",
+		    iter_slots * 1e9 / live, iter_map * 1e9 / live);
+	std::printf("%-14s %10.2f %10.2f\n", "find/lookup",
+		    find_slots * 1e9 / double(n), find_map * 1e9 / double(n));
+	return 0;
+}
@@ -0,0 +1,112 @@
+//===-- stevemac::bench_snapshot_vector.cpp -----------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#include "bench.h"
+#include "snapshot_vector.h"
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+///===----------------------------------------------------------------------===//
+///
+/// Reads of a shared table while one writer publishes a new version every
+/// millisecond: ns per read, averaged over all reader threads.
+///   reader  snapshot_vector::reader::get(), the cached steady state path
+///   load    snapshot_vector::load(), a std::atomic<shared_ptr> load
+///   mutex   a shared_ptr copied under a std::mutex, the usual baseline
+/// Each read looks at one element so the snapshot is really used.
+//===----------------------------------------------------------------------===//
+using namespace stevemac;
+
+namespace
+{
+using table = vector<int>;
+
+template <class Read>
+double ns_per_read(unsigned threads, std::size_t reads, Read read,
+		   std::atomic<bool> &writing)
+{
+	writing = true;
+	std::vector<std::thread> pool;
+	const double s = bench::best_of(1, [&] {
+		for (unsigned t = 0; t < threads; ++t)
+			pool.emplace_back([&, t] {
+				std::size_t sum = 0;
+				for (std::size_t i = 0; i < reads; ++i)
+					sum += std::size_t(read(t, i));
+				bench::keep(sum);
+			});
+		for (auto &t : pool)
+			t.join();
+	});
+	writing = false;
+	return s * 1e9 / double(reads);
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+	const double sc = bench::scale(argc, argv);
+	const std::size_t reads = bench::scaled(std::size_t(4) << 20, sc);
+	const table initial(std::size_t(1024), 1);
+
+	snapshot_vector<int> sv(initial);
+	std::mutex lock;
+	std::shared_ptr<const table> locked = std::make_shared<const table>(initial);
+
+	std::atomic<bool> writing{false}, done{false};
+	std::thread writer([&] {
+		int v = 0;
+		while (!done) {
+			if (writing) {
+				table next(std::size_t(1024), ++v);
+				sv.publish(next);
+				auto p = std::make_shared<const table>(std::move(next));
+				std::lock_guard<std::mutex> g(lock);
+				locked.swap(p);
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	});
+
+	std::printf("ns per read\n%8s %8s %8s %8s\n", "threads", "reader",
+		    "load", "mutex");
+	const unsigned hw = std::thread::hardware_concurrency();
+	for (unsigned t = 1; t <= (hw > 4 ? hw : 4); t *= 2) {
+		std::vector<snapshot_vector<int>::reader> rd;
+		for (unsigned i = 0; i < t; ++i)
+			rd.push_back(sv.read());
+		const double reader = ns_per_read(
+			t, reads,
+			[&](unsigned k, std::size_t i) {
+				return rd[k].get()[i % 1024];
+			},
+			writing);
+		const double load = ns_per_read(
+			t, reads,
+			[&](unsigned, std::size_t i) { return (*sv.load())[i % 1024]; },
+			writing);
+		const double mutex = ns_per_read(
+			t, reads,
+			[&](unsigned, std::size_t i) {
+				std::shared_ptr<const table> p;
+				{
+					std::lock_guard<std::mutex> g(lock);
+					p = locked;
+				}
+				return (*p)[i % 1024];
+			},
+			writing);
+		std::printf("%8u %8.2f %8.2f %8.2f\n", t, reader / t, load / t,
+			    mutex / t);
+	}
+	done = true;
+	writer.join();
+	return 0;
+}
@@ -0,0 +1,97 @@
+//===-- stevemac::bench_stream.cpp --------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#include "bench.h"
+#include "stream.h"
+#include "vector.h"
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+///===----------------------------------------------------------------------===//
+///
+/// stream_copy / stream_fill against memcpy / memset, at sizes from a
+/// quarter of stream_threshold() to four times it, and vector<int> copy
+/// construction with streaming forced off and on.  "probe" is the time for
+/// 2M random reads of a 16 MiB table that was warm before the copy: how
+/// much of it the copy evicted.
+//===----------------------------------------------------------------------===//
+using namespace stevemac;
+
+namespace
+{
+constexpr int reps = 3;
+
+struct probe_table {
+	vector<unsigned> t = vector<unsigned>(std::size_t(4) << 20, 1u);
+
+	double run()
+	{
+		unsigned x = 1, acc = 0;
+		const double s = bench::best_of(1, [&] {
+			for (int i = 0; i < 2000000; ++i) {
+				x = x * 1664525 + 1013904223;
+				acc += t[x % t.size()];
+			}
+		});
+		bench::keep(acc);
+		return s;
+	}
+};
+
+/// Seconds for op, and the probe time right after it, best of reps.
+template <class Op> void measure(probe_table &p, Op op, double &secs,
+				 double &probe)
+{
+	secs = probe = 0;
+	for (int r = 0; r < reps; ++r) {
+		p.run();
+		const double s = bench::best_of(1, op);
+		const double q = p.run();
+		if (r == 0 || s < secs)
+			secs = s;
+		if (r == 0 || q < probe)
+			probe = q;
+	}
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+	const double sc = bench::scale(argc, argv);
+	const std::size_t threshold = stream_threshold().load();
+	probe_table p;
+
+	std::printf("stream_threshold %zu bytes; GB/s, probe in ms\n",
+		    threshold);
+	std::printf("%10s  %8s %8s %8s %8s  %8s %8s  %9s %9s\n", "MiB",
+		    "memcpy", "stream", "memset", "sfill", "vec off", "vec on",
+		    "probe mc", "probe st");
+	for (const double f : {0.25, 0.5, 1.0, 2.0, 4.0}) {
+		const std::size_t n = bench::scaled(std::size_t(threshold * f), sc);
+		vector<char> src(n, char(1)), dst(n, char(2));
+		double mc, st, ms, sf, pmc, pst, ign;
+		measure(p, [&] { std::memcpy(dst.data(), src.data(), n); }, mc, pmc);
+		measure(p, [&] { stream_copy(src.data(), n, dst.data()); }, st, pst);
+		measure(p, [&] { std::memset(dst.data(), 3, n); }, ms, ign);
+		measure(p, [&] { stream_fill(dst.data(), n, char(4)); }, sf, ign);
+
+		// the vector path: copy construction of n bytes worth of int
+		const vector<int> ints(n / sizeof(int), 5);
+		double off, on;
+		stream_threshold() = std::numeric_limits<std::size_t>::max();
+		measure(p, [&] { bench::keep(vector<int>(ints).data()); }, off, ign);
+		stream_threshold() = 0;
+		measure(p, [&] { bench::keep(vector<int>(ints).data()); }, on, ign);
+		stream_threshold() = threshold;
+
+		const double gb = double(n) / 1e9;
+		std::printf("%10.1f  %8.2f %8.2f %8.2f %8.2f  %8.2f %8.2f  %9.2f %9.2f\n",
+			    double(n) / (1 << 20), gb / mc, gb / st, gb / ms, gb / sf,
+			    gb / off, gb / on, pmc * 1e3, pst * 1e3);
+	}
+	return 0;
+}
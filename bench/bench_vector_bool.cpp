@@ -0,0 +1,77 @@
+//===-- stevemac::bench_vector_bool.cpp ---------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#include "bench.h"
+#include "vector_bool.h"
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+///===----------------------------------------------------------------------===//
+///
+/// The packed vector<bool> word operations against std::vector<bool> doing
+/// the same with the std algorithms: count, walking every set bit with
+/// find_first/find_next, and and-ing two bit sets.  Milliseconds, best of
+/// five, for bit sets with one bit in 16 set.
+//===----------------------------------------------------------------------===//
+using namespace stevemac;
+
+int main(int argc, char **argv)
+{
+	const double sc = bench::scale(argc, argv);
+	constexpr int reps = 5;
+
+	std::printf("ms\n%12s  %8s %8s  %8s %8s  %8s %8s\n", "bits", "count",
+		    "std", "walk", "std", "and", "std");
+	for (const std::size_t base : {std::size_t(1) << 16, std::size_t(1) << 23,
+				       std::size_t(1) << 28}) {
+		const std::size_t n = bench::scaled(base, sc);
+		bench::rng r(n);
+		vector<bool> a, b;
+		std::vector<bool> sa, sb;
+		for (std::size_t i = 0; i < n; ++i) {
+			const bool x = r() % 16 == 0, y = r() % 2 == 0;
+			a.push_back(x);
+			b.push_back(y);
+			sa.push_back(x);
+			sb.push_back(y);
+		}
+
+		const double count = bench::best_of(reps, [&] { bench::keep(a.count()); });
+		const double std_count = bench::best_of(reps, [&] {
+			bench::keep(std::count(sa.begin(), sa.end(), true));
+		});
+		const double walk = bench::best_of(reps, [&] {
+			std::size_t sum = 0;
+			for (std::size_t i = a.find_first(); i < n; i = a.find_next(i))
+				sum += i;
+			bench::keep(sum);
+		});
+		const double std_walk = bench::best_of(reps, [&] {
+			std::size_t sum = 0;
+			for (auto it = std::find(sa.begin(), sa.end(), true);
+			     it != sa.end(); it = std::find(it + 1, sa.end(), true))
+				sum += std::size_t(it - sa.begin());
+			bench::keep(sum);
+		});
+		vector<bool> c(a);
+		const double band = bench::best_of(reps, [&] {
+			c &= b;
+			bench::keep(c.data());
+		});
+		std::vector<bool> sand(sa);
+		const double std_and = bench::best_of(reps, [&] {
+			std::transform(sand.begin(), sand.end(), sb.begin(),
+				       sand.begin(), [](bool x, bool y) { return x && y; });
+			bench::keep(sand.size());
+		});
+
+		std::printf("%12zu  %8.3f %8.3f  %8.3f %8.3f  %8.3f %8.3f\n", n,
+			    count * 1e3, std_count * 1e3, walk * 1e3,
+			    std_walk * 1e3, band * 1e3, std_and * 1e3);
+	}
+	return 0;
+}
@@ -0,0 +1,86 @@
+//===-- stevemac::bench_vector_builder.cpp ------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#include "bench.h"
+#include "vector_builder.h"
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+///===----------------------------------------------------------------------===//
+///
+/// n uint64_t appended by a growing number of threads into one vector,
+/// ns per element including the final result:
+///   mutex      push_back on a shared vector under a std::mutex
+///   local      vector_builder, each thread pushing through local()
+///   push_back  vector_builder::push_back, a thread_local lookup per call
+/// The builder columns include finish().  On a machine with fewer cores
+/// than threads this measures contention, not parallel speedup.
+//===----------------------------------------------------------------------===//
+using namespace stevemac;
+
+namespace
+{
+constexpr int reps = 3;
+
+/// Runs work(t) on threads threads and waits for all of them.
+template <class Work> void on_threads(unsigned threads, Work work)
+{
+	std::vector<std::thread> pool;
+	for (unsigned t = 0; t < threads; ++t)
+		pool.emplace_back(work, t);
+	for (auto &th : pool)
+		th.join();
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+	const std::size_t n = bench::scaled(std::size_t(1) << 24,
+					    bench::scale(argc, argv));
+	auto ns = [n](auto op) {
+		return bench::best_of(reps, op) * 1e9 / double(n);
+	};
+
+	std::printf("%zu elements, ns per element\n", n);
+	std::printf("%8s %9s %9s %9s\n", "threads", "mutex", "local",
+		    "push_back");
+	for (const unsigned threads : {1u, 2u, 4u, 8u, 16u, 32u, 64u}) {
+		const double mutex = ns([&] {
+			vector<std::uint64_t> out;
+			std::mutex lock;
+			on_threads(threads, [&](unsigned t) {
+				for (std::size_t i = t; i < n; i += threads) {
+					std::lock_guard<std::mutex> g(lock);
+					out.push_back(i);
+				}
+			});
+			bench::keep(out.data());
+		});
+		const double local = ns([&] {
+			vector_builder<std::uint64_t> b;
+			on_threads(threads, [&](unsigned t) {
+				auto &part = b.local();
+				for (std::size_t i = t; i < n; i += threads)
+					part.push_back(i);
+			});
+			bench::keep(b.finish().data());
+		});
+		const double push_back = ns([&] {
+			vector_builder<std::uint64_t> b;
+			on_threads(threads, [&](unsigned t) {
+				for (std::size_t i = t; i < n; i += threads)
+					b.push_back(i);
+			});
+			bench::keep(b.finish().data());
+		});
+		std::printf("%8u %9.2f %9.2f %9.2f\n", threads, mutex, local,
+			    push_back);
+	}
+	return 0;
+}
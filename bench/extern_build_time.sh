@@ -0,0 +1,93 @@
+#!/bin/sh
+#===-- stevemac::extern_build_time.sh -------------------------*- sh -*-===#
+#
+# This file is distributed under the GNU General Public License, version 2
+# (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+# Author: Stephen E. MacKenzie
+#===----------------------------------------------------------------------===#
+# Build time of a project of N files that each include vector.h, built
+# header-only and with the extern template declarations of vector_extern.h
+# (what linking the stevemac_vector CMake target turns on).  Each file is
+# bench/extern_tu.cpp with its own entry point; the total covers compiling
+# all N and linking them.  The extern column adds vector_instances.cpp,
+# which such a project compiles once, separately.  One compiler at a time,
+# best of RUNS, at -O0 and -O2.  Also prints the preprocessed size of a
+# file that includes nothing but vector.h.
+#
+#   CXX=g++ bench/extern_build_time.sh [files] [runs]
+set -e
+cxx=${CXX:-c++}
+files=${1:-16}
+runs=${2:-3}
+here=$(cd "$(dirname "$0")" && pwd)
+root="$here/.."
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+
+# main() calling each file's entry point
+{
+	i=1
+	while [ "$i" -le "$files" ]; do
+		echo "int tu_$i();"
+		i=$((i + 1))
+	done
+	echo "int main() { int n = 0;"
+	i=1
+	while [ "$i" -le "$files" ]; do
+		echo "n += tu_$i();"
+		i=$((i + 1))
+	done
+	echo "return n == 0; }"
+} >"$tmp/main.cpp"
+
+# warnings off: only the time matters here
+cc() {
+	"$cxx" -std=c++20 -w -I"$root" "$@"
+}
+
+# compiles the N files and links them; $1 is "extern" or "header"
+project() {
+	kind=$1
+	shift
+	objs=
+	i=1
+	while [ "$i" -le "$files" ]; do
+		cc "$@" -DEXTERN_TU_ENTRY=tu_$i -c "$here/extern_tu.cpp" \
+			-o "$tmp/tu_$i.o"
+		objs="$objs $tmp/tu_$i.o"
+		i=$((i + 1))
+	done
+	cc "$@" -c "$tmp/main.cpp" -o "$tmp/main.o"
+	if [ "$kind" = extern ]; then
+		cc "$@" $objs "$tmp/main.o" "$tmp/instances.o" -o "$tmp/a.out"
+	else
+		cc "$@" $objs "$tmp/main.o" -o "$tmp/a.out"
+	fi
+}
+
+best() {
+	b=
+	r=0
+	while [ "$r" -lt "$runs" ]; do
+		s=$(date +%s.%N)
+		"$@"
+		e=$(date +%s.%N)
+		b=$(echo "$s $e ${b:-1e9}" | awk '{ t = $2 - $1; print (t < $3 ? t : $3) }')
+		r=$((r + 1))
+	done
+	echo "$b"
+}
+
+echo '#include "vector.h"' >"$tmp/only.cpp"
+printf 'vector.h alone: %s preprocessed lines\n' \
+	"$(cc -E "$tmp/only.cpp" | wc -l)"
+printf '%d files, seconds\n' "$files"
+printf '%-4s %12s %12s %12s\n' opt header-only extern "+instances"
+ext=-DSTEVEMAC_VECTOR_EXTERN_TEMPLATES
+for opt in -O0 -O2; do
+	lib=$(best cc "$opt" "$ext" -c "$root/vector_instances.cpp" \
+		-o "$tmp/instances.o")
+	printf '%-4s %12.2f %12.2f %12.2f\n' "$opt" \
+		"$(best project header "$opt")" \
+		"$(best project extern "$opt" "$ext")" "$lib"
+done
@@ -0,0 +1,56 @@
+//===-- stevemac::extern_tu.cpp -----------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+/// A typical consumer translation unit for extern_build_time.sh: it uses
+/// most of the vector interface for three of the extern instantiated
+/// element types.  Built as bench_extern_tu against the stevemac_vector
+/// library so the extern declarations are checked to link.  The script
+/// compiles it N times with EXTERN_TU_ENTRY set to a different name each
+/// time and links the lot, as a project of N files using vector would be.
+#include "vector.h"
+#include <cstdio>
+#include <string>
+
+namespace
+{
+template <typename T> std::size_t exercise(const T &a, const T &b)
+{
+	stevemac::vector<T> v;
+	v.reserve(8);
+	for (int i = 0; i < 100; ++i)
+		v.push_back(i % 2 ? a : b);
+	v.emplace_back(a);
+	v.insert(v.begin() + 3, b);
+	v.erase(v.begin() + 5);
+	v.resize(50);
+	v.resize(60, a);
+	stevemac::vector<T> w(v);
+	w = v;
+	stevemac::vector<T> m(std::move(w));
+	m.swap(v);
+	v.assign(std::size_t(10), b);
+	v.append_n(5, a);
+	v.shrink_to_fit();
+	std::size_t n = 0;
+	for (const T &x : m)
+		n += x == a;
+	m.pop_back();
+	m.clear();
+	return n + v.size() + v.capacity() + (v == m);
+}
+} // namespace
+
+#ifndef EXTERN_TU_ENTRY
+#define EXTERN_TU_ENTRY main
+#endif
+
+int EXTERN_TU_ENTRY()
+{
+	std::size_t n = exercise(1, 2) + exercise(1.5, 2.5)
+			+ exercise(std::string("a"), std::string("b"));
+	std::printf("%zu\n", n);
+	return 0;
+}
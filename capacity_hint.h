@@ -0,0 +1,122 @@
+//===-- stevemac::capacity_hint.h ---------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <source_location>
+
+namespace stevemac
+{
+///===----------------------------------------------------------------------===//
+///
+/// Capacity hints learned per call site.
+/// A vector constructed from a capacity_hint_site reports its size to the
+/// site when it is destroyed, and the first allocation of the next vector
+/// built there is sized from what the site has seen instead of
+/// _push_back_init_cap, so a site that always ends up with ~5000 elements
+/// stops paying for the ten doublings on the way.
+/// The site keeps a decayed high-water mark: a larger size raises it at
+/// once, every smaller one lowers it by 1/decay_divisor, so one outlier
+/// does not pin a big first allocation forever.
+///
+/// STEVEMAC_CAPACITY_HINT_SITE() expands to a function local static site
+/// unique to the expansion, tagged with its std::source_location:
+///
+///   vector<row> rows(STEVEMAC_CAPACITY_HINT_SITE());
+///
+/// The counters are thread local, so instrumented vectors never share a
+/// cache line; read them on the thread that did the work.
+//===----------------------------------------------------------------------===//
+struct capacity_hint_stats {
+	/// tagged vectors destroyed
+	std::uint64_t vectors = 0;
+	/// first allocations sized from a hint rather than the default
+	std::uint64_t hinted_allocs = 0;
+	/// growth reallocations tagged vectors actually made
+	std::uint64_t growths = 0;
+	/// growth reallocations the default policy needed for the same sizes
+	std::uint64_t baseline_growths = 0;
+
+	std::int64_t reallocs_avoided() const noexcept
+	{
+		return std::int64_t(baseline_growths) - std::int64_t(growths);
+	}
+};
+
+inline capacity_hint_stats &capacity_hint_metrics() noexcept
+{
+	thread_local capacity_hint_stats stats;
+	return stats;
+}
+
+class capacity_hint_site
+{
+      public:
+	static constexpr std::size_t decay_divisor = 8;
+
+	explicit capacity_hint_site(
+		std::source_location where = std::source_location::current()) noexcept
+	    : _where(where)
+	{
+	}
+	capacity_hint_site(const capacity_hint_site &) = delete;
+	capacity_hint_site &operator=(const capacity_hint_site &) = delete;
+
+	/// Suggested first capacity, 0 until a vector has reported.
+	std::size_t hint() const noexcept
+	{
+		return _mark.load(std::memory_order_relaxed);
+	}
+
+	void record(std::size_t n) noexcept
+	{
+		std::size_t mark = _mark.load(std::memory_order_relaxed);
+		std::size_t next;
+		do {
+			const std::size_t decayed = mark - mark / decay_divisor;
+			next = n > decayed ? n : decayed;
+		} while (next != mark
+			 && !_mark.compare_exchange_weak(
+				 mark, next, std::memory_order_relaxed));
+	}
+
+	const std::source_location &where() const noexcept
+	{
+		return _where;
+	}
+
+      private:
+	std::atomic<std::size_t> _mark{0};
+	std::source_location _where;
+};
+
+namespace detail
+{
+/// The push_back growth policy: a first allocation of push_back_init_cap
+/// elements, then resize_factor times the size.  vector and
+/// circular_vector both take theirs from here.
+inline constexpr std::size_t push_back_init_cap = 10;
+inline constexpr std::size_t resize_factor = 2;
+
+/// Reallocations geometric growth by factor needs to go from first to n.
+constexpr std::size_t growth_steps(std::size_t first, std::size_t n,
+				   std::size_t factor) noexcept
+{
+	std::size_t steps = 0;
+	for (std::size_t cap = first ? first : 1; cap < n; cap *= factor)
+		++steps;
+	return steps;
+}
+} // namespace detail
+} // namespace stevemac
+
+#define STEVEMAC_CAPACITY_HINT_SITE()                                          \
+	([]() -> ::stevemac::capacity_hint_site & {                            \
+		static ::stevemac::capacity_hint_site site;                    \
+		return site;                                                   \
+	}())
@@ -0,0 +1,604 @@
+//===-- stevemac::circular_vector.h -------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#pragma once
+#include "capacity_hint.h"
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace stevemac
+{
+///===----------------------------------------------------------------------===//
+///
+/// \class stevemac::circular_iterator
+/// \brief Random access iterator over a circular_vector.  It holds the
+/// container and a logical index, so it stays valid across the wrap point;
+/// like vector_iterator it is invalidated by reallocation.
+///
+//===----------------------------------------------------------------------===//
+template <typename Container> class circular_iterator
+{
+      public:
+	using iterator_category = std::random_access_iterator_tag;
+	using value_type = typename std::remove_const_t<Container>::value_type;
+	using difference_type = std::ptrdiff_t;
+	using size_type = typename std::remove_const_t<Container>::size_type;
+	using reference = std::conditional_t<std::is_const_v<Container>,
+					     const value_type &, value_type &>;
+	using pointer = std::conditional_t<std::is_const_v<Container>,
+					   const value_type *, value_type *>;
+
+	circular_iterator() noexcept : _c(nullptr), _i(0) {}
+	circular_iterator(Container *c, size_type i) noexcept : _c(c), _i(i) {}
+	/// iterator -> const_iterator
+	template <typename Other,
+		  typename = std::enable_if_t<
+			  std::is_same_v<const Other, Container>
+			  && !std::is_same_v<Other, Container>>>
+	circular_iterator(const circular_iterator<Other> &other) noexcept
+	    : _c(other._c), _i(other._i)
+	{
+	}
+
+	reference operator*() const
+	{
+		return (*_c)[_i];
+	}
+	pointer operator->() const
+	{
+		return &(*_c)[_i];
+	}
+	reference operator[](difference_type n) const
+	{
+		return (*_c)[_i + n];
+	}
+
+	circular_iterator &operator++() noexcept
+	{
+		++_i;
+		return *this;
+	}
+	circular_iterator operator++(int) noexcept
+	{
+		circular_iterator tmp = *this;
+		++_i;
+		return tmp;
+	}
+	circular_iterator &operator--() noexcept
+	{
+		--_i;
+		return *this;
+	}
+	circular_iterator operator--(int) noexcept
+	{
+		circular_iterator tmp = *this;
+		--_i;
+		return tmp;
+	}
+	circular_iterator &operator+=(difference_type n) noexcept
+	{
+		_i += n;
+		return *this;
+	}
+	circular_iterator &operator-=(difference_type n) noexcept
+	{
+		_i -= n;
+		return *this;
+	}
+	circular_iterator operator+(difference_type n) const noexcept
+	{
+		return circular_iterator(_c, _i + n);
+	}
+	friend circular_iterator operator+(difference_type n,
+					   const circular_iterator &it) noexcept
+	{
+		return it + n;
+	}
+	circular_iterator operator-(difference_type n) const noexcept
+	{
+		return circular_iterator(_c, _i - n);
+	}
+	difference_type operator-(const circular_iterator &other) const noexcept
+	{
+		return static_cast<difference_type>(_i)
+		       - static_cast<difference_type>(other._i);
+	}
+
+	bool operator==(const circular_iterator &other) const noexcept
+	{
+		return _i == other._i;
+	}
+	bool operator!=(const circular_iterator &other) const noexcept
+	{
+		return _i != other._i;
+	}
+	bool operator<(const circular_iterator &other) const noexcept
+	{
+		return _i < other._i;
+	}
+	bool operator>(const circular_iterator &other) const noexcept
+	{
+		return _i > other._i;
+	}
+	bool operator<=(const circular_iterator &other) const noexcept
+	{
+		return _i <= other._i;
+	}
+	bool operator>=(const circular_iterator &other) const noexcept
+	{
+		return _i >= other._i;
+	}
+
+      private:
+	template <typename> friend class circular_iterator;
+	Container *_c;
+	size_type _i;
+};
+
+///===----------------------------------------------------------------------===//
+///
+/// stevemac::circular_vector
+/// Ring buffer with the vector interface, for sliding windows where
+/// vector::erase(begin()) would shift the whole buffer.  push and pop are
+/// O(1) at both ends; elements are addressed by logical index, the physical
+/// slot is (_head + i) wrapped at _capacity.
+/// Growth follows stevemac::vector: the first push allocates
+/// _push_back_init_cap slots, after that capacity grows by _resize_factor,
+/// and every reallocation moves the elements into the new buffer unwrapped
+/// (_head == 0).  as_spans() hands out the two contiguous halves so SIMD
+/// kernels can run over them directly.
+//===----------------------------------------------------------------------===//
+template <typename T, class Allocator = std::allocator<T>>
+class circular_vector
+{
+	using alloc_traits = std::allocator_traits<Allocator>;
+
+      public:
+	using value_type = T;
+	using allocator_type = Allocator;
+	using reference = value_type &;
+	using const_reference = const value_type &;
+	using pointer = typename alloc_traits::pointer;
+	using const_pointer = typename alloc_traits::const_pointer;
+	using size_type = typename alloc_traits::size_type;
+	using difference_type = typename alloc_traits::difference_type;
+	using iterator = circular_iterator<circular_vector>;
+	using const_iterator = circular_iterator<const circular_vector>;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+	//===----------------------------------------------------------------------===//
+	/// construct/copy/destroy
+	//===----------------------------------------------------------------------===//
+	explicit circular_vector(
+		const allocator_type &a = allocator_type()) noexcept
+	    : _allocator(a)
+	{
+	}
+
+	circular_vector(std::initializer_list<T> il,
+			const allocator_type &a = allocator_type())
+	    : _allocator(a)
+	{
+		reserve(il.size());
+		for (auto &v : il)
+			push_back(v);
+	}
+
+	circular_vector(const circular_vector &other)
+	    : _allocator(alloc_traits::select_on_container_copy_construction(
+		    other._allocator))
+	{
+		reserve(other._size);
+		for (size_type i = 0; i < other._size; ++i)
+			push_back(other[i]);
+	}
+
+	circular_vector(circular_vector &&other) noexcept
+	    : _allocator(std::move(other._allocator)), _begin(other._begin),
+	      _head(other._head), _size(other._size),
+	      _capacity(other._capacity)
+	{
+		other._begin = nullptr;
+		other._head = other._size = other._capacity = 0;
+	}
+
+	~circular_vector()
+	{
+		if (_begin != nullptr) {
+			clear();
+			alloc_traits::deallocate(_allocator, _begin, _capacity);
+		}
+	}
+
+	circular_vector &operator=(const circular_vector &other)
+	{
+		if (this != &other) {
+			circular_vector tmp(other);
+			swap(tmp);
+		}
+		return *this;
+	}
+
+	circular_vector &operator=(circular_vector &&other) noexcept
+	{
+		if (this != &other) {
+			circular_vector tmp(std::move(other));
+			swap(tmp);
+		}
+		return *this;
+	}
+
+	allocator_type get_allocator() const noexcept
+	{
+		return _allocator;
+	}
+
+	//===----------------------------------------------------------------------===//
+	/// iterators
+	//===----------------------------------------------------------------------===//
+	iterator begin() noexcept
+	{
+		return iterator(this, 0);
+	}
+	const_iterator begin() const noexcept
+	{
+		return const_iterator(this, 0);
+	}
+	iterator end() noexcept
+	{
+		return iterator(this, _size);
+	}
+	const_iterator end() const noexcept
+	{
+		return const_iterator(this, _size);
+	}
+	const_iterator cbegin() const noexcept
+	{
+		return begin();
+	}
+	const_iterator cend() const noexcept
+	{
+		return end();
+	}
+	reverse_iterator rbegin() noexcept
+	{
+		return reverse_iterator(end());
+	}
+	const_reverse_iterator rbegin() const noexcept
+	{
+		return const_reverse_iterator(end());
+	}
+	reverse_iterator rend() noexcept
+	{
+		return reverse_iterator(begin());
+	}
+	const_reverse_iterator rend() const noexcept
+	{
+		return const_reverse_iterator(begin());
+	}
+
+	//===----------------------------------------------------------------------===//
+	/// capacity
+	//===----------------------------------------------------------------------===//
+	size_type size() const noexcept
+	{
+		return _size;
+	}
+	size_type max_size() const noexcept
+	{
+		return _max;
+	}
+	size_type capacity() const noexcept
+	{
+		return _capacity;
+	}
+	[[nodiscard]] bool empty() const noexcept
+	{
+		return _size == 0;
+	}
+
+	/// can throw length_error if n > max_size().
+	void reserve(size_type n)
+	{
+		if (n > max_size())
+			throw std::length_error("request larger than max");
+
+		if (n > _capacity)
+			alloc_move_swap(n);
+	}
+
+	void shrink_to_fit()
+	{
+		if (_size < _capacity)
+			alloc_move_swap(_size);
+	}
+
+	//===----------------------------------------------------------------------===//
+	/// element access, index is logical: 0 is front()
+	//===----------------------------------------------------------------------===//
+	reference operator[](size_type n)
+	{
+		return _begin[slot(n)];
+	}
+	const_reference operator[](size_type n) const
+	{
+		return _begin[slot(n)];
+	}
+
+	reference at(size_type n)
+	{
+		if (n >= _size)
+			throw std::out_of_range("circular_vector::at");
+		return _begin[slot(n)];
+	}
+	const_reference at(size_type n) const
+	{
+		if (n >= _size)
+			throw std::out_of_range("circular_vector::at");
+		return _begin[slot(n)];
+	}
+
+	reference front()
+	{
+		return _begin[_head];
+	}
+	const_reference front() const
+	{
+		return _begin[_head];
+	}
+	reference back()
+	{
+		return _begin[slot(_size - 1)];
+	}
+	const_reference back() const
+	{
+		return _begin[slot(_size - 1)];
+	}
+
+	/// The live elements as two contiguous runs, front part first.  The
+	/// second span is empty unless the contents wrap.
+	std::pair<std::span<T>, std::span<T>> as_spans() noexcept
+	{
+		const size_type first = std::min(_size, _capacity - _head);
+		return {std::span<T>(std::to_address(_begin) + _head, first),
+			std::span<T>(std::to_address(_begin), _size - first)};
+	}
+	std::pair<std::span<const T>, std::span<const T>>
+	as_spans() const noexcept
+	{
+		const size_type first = std::min(_size, _capacity - _head);
+		return {std::span<const T>(std::to_address(_begin) + _head,
+					   first),
+			std::span<const T>(std::to_address(_begin),
+					   _size - first)};
+	}
+
+	//===----------------------------------------------------------------------===//
+	/// modifiers
+	/// push_* gives the strong guarantee: if growth or the element
+	/// construction throws, the ring is unchanged.
+	//===----------------------------------------------------------------------===//
+	void push_back(const T &val)
+	{
+		emplace_back(val);
+	}
+	void push_back(T &&val)
+	{
+		emplace_back(std::move(val));
+	}
+	void push_front(const T &val)
+	{
+		emplace_front(val);
+	}
+	void push_front(T &&val)
+	{
+		emplace_front(std::move(val));
+	}
+
+	template <class... Args> reference emplace_back(Args &&... args)
+	{
+		if (_size == _capacity)
+			return grow_emplace(false, std::forward<Args>(args)...);
+
+		const size_type s = slot(_size);
+		alloc_traits::construct(_allocator, std::to_address(_begin) + s,
+					std::forward<Args>(args)...);
+		++_size;
+		return _begin[s];
+	}
+
+	template <class... Args> reference emplace_front(Args &&... args)
+	{
+		if (_size == _capacity)
+			return grow_emplace(true, std::forward<Args>(args)...);
+
+		const size_type s = _head == 0 ? _capacity - 1 : _head - 1;
+		alloc_traits::construct(_allocator, std::to_address(_begin) + s,
+					std::forward<Args>(args)...);
+		_head = s;
+		++_size;
+		return _begin[s];
+	}
+
+	void pop_back()
+	{
+		alloc_traits::destroy(_allocator,
+				      std::to_address(_begin) + slot(_size - 1));
+		--_size;
+	}
+
+	void pop_front()
+	{
+		alloc_traits::destroy(_allocator,
+				      std::to_address(_begin) + _head);
+		_head = _head + 1 == _capacity ? 0 : _head + 1;
+		--_size;
+	}
+
+	/// capacity remains unchanged
+	void clear() noexcept
+	{
+		while (_size > 0)
+			pop_back();
+		_head = 0;
+	}
+
+	void swap(circular_vector &other) noexcept
+	{
+		using std::swap;
+		swap(_allocator, other._allocator);
+		swap(_begin, other._begin);
+		swap(_head, other._head);
+		swap(_size, other._size);
+		swap(_capacity, other._capacity);
+	}
+
+	//===----------------------------------------------------------------------===//
+	/// circular_vector private implementation
+	//===----------------------------------------------------------------------===//
+      private:
+	/// logical index -> physical slot, without a divide.
+	size_type slot(size_type i) const noexcept
+	{
+		return i < _capacity - _head ? _head + i : i - (_capacity - _head);
+	}
+
+	/// Same policy as vector::push_back: start at _push_back_init_cap,
+	/// then multiply by _resize_factor.
+	size_type next_capacity() const
+	{
+		if (_capacity >= _max)
+			throw std::length_error("circular_vector at max_size");
+
+		size_type newcap = _capacity == 0 ? _push_back_init_cap
+						  : _capacity * _resize_factor;
+		return newcap < _max ? newcap : _max;
+	}
+
+	/// emplace on a full ring.  The new element is constructed in the new
+	/// buffer before the old ring is relocated and freed, because args
+	/// may refer to an element of *this (c.push_back(c.front())).
+	/// at_front puts it in the last slot, which becomes the head.
+	template <class... Args>
+	reference grow_emplace(bool at_front, Args &&... args)
+	{
+		const size_type newcap = next_capacity();
+		pointer tmp = alloc_traits::allocate(_allocator, newcap);
+		const size_type s = at_front ? newcap - 1 : _size;
+		try {
+			alloc_traits::construct(_allocator,
+						std::to_address(tmp) + s,
+						std::forward<Args>(args)...);
+		} catch (...) {
+			alloc_traits::deallocate(_allocator, tmp, newcap);
+			throw;
+		}
+		try {
+			relocate_into(tmp);
+		} catch (...) {
+			alloc_traits::destroy(_allocator, std::to_address(tmp) + s);
+			alloc_traits::deallocate(_allocator, tmp, newcap);
+			throw;
+		}
+		adopt(tmp, newcap, _size + 1);
+		_head = at_front ? s : 0;
+		return _begin[s];
+	}
+
+	/// Relocates the ring into a fresh buffer of newcap slots, unwrapping
+	/// it so that _head becomes 0.  Moves only when the move constructor
+	/// cannot throw, otherwise copies, so a throw leaves *this untouched.
+	void alloc_move_swap(const size_type newcap)
+	{
+		pointer tmp = alloc_traits::allocate(_allocator, newcap);
+		try {
+			relocate_into(tmp);
+		} catch (...) {
+			alloc_traits::deallocate(_allocator, tmp, newcap);
+			throw;
+		}
+		adopt(tmp, newcap, _size);
+	}
+
+	/// Constructs the elements, in logical order, at tmp[0, size()).  On a
+	/// throw the ones already built are destroyed.
+	void relocate_into(pointer tmp)
+	{
+		size_type i = 0;
+		try {
+			for (; i < _size; ++i)
+				alloc_traits::construct(
+					_allocator, std::to_address(tmp) + i,
+					std::move_if_noexcept((*this)[i]));
+		} catch (...) {
+			while (i > 0)
+				alloc_traits::destroy(_allocator,
+						      std::to_address(tmp) + --i);
+			throw;
+		}
+	}
+
+	/// Frees the old ring and takes tmp, holding n elements from slot 0.
+	void adopt(pointer tmp, const size_type newcap, const size_type n)
+	{
+		if (_begin != nullptr) {
+			clear();
+			alloc_traits::deallocate(_allocator, _begin, _capacity);
+		}
+		_begin = tmp;
+		_head = 0;
+		_size = n;
+		_capacity = newcap;
+	}
+
+	//===----------------------------------------------------------------------===//
+	/// circular_vector private data members
+	//===----------------------------------------------------------------------===//
+      private:
+	Allocator _allocator;
+	pointer _begin = nullptr;
+	size_type _head = 0;
+	size_type _size = 0;
+	size_type _capacity = 0;
+	static constexpr size_type _push_back_init_cap =
+		detail::push_back_init_cap;
+	static constexpr size_type _resize_factor = detail::resize_factor;
+	static constexpr size_type _max = std::numeric_limits<int>::max();
+};
+
+//===----------------------------------------------------------------------===//
+/// non-member circular_vector helpers
+//===----------------------------------------------------------------------===//
+template <class T, class Allocator>
+bool operator==(const circular_vector<T, Allocator> &x,
+		const circular_vector<T, Allocator> &y)
+{
+	return x.size() == y.size() && std::equal(x.begin(), x.end(), y.begin());
+}
+
+template <class T, class Allocator>
+bool operator!=(const circular_vector<T, Allocator> &x,
+		const circular_vector<T, Allocator> &y)
+{
+	return !(x == y);
+}
+
+template <class T, class Allocator>
+void swap(circular_vector<T, Allocator> &x,
+	  circular_vector<T, Allocator> &y) noexcept
+{
+	x.swap(y);
+}
+} // namespace stevemac
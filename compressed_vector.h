@@ -0,0 +1,390 @@
+//===-- stevemac::compressed_vector.h -----------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#pragma once
+#include "simd.h"
+#include "vector.h"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+
+namespace stevemac
+{
+namespace detail
+{
+/// Bits needed to hold x; 0 for x == 0.
+template <typename T> unsigned bit_width(T x) noexcept
+{
+	return x == 0 ? 0 : 64 - __builtin_clzll(std::uint64_t(x));
+}
+
+#if STEVEMAC_SIMD_X86
+/// Unpacks 128 values of `width` bits starting at `words`, adding `base`.
+/// Four values per step: the two 64 bit words each value can straddle are
+/// fetched with gathers and funnel shifted into place.  The upper word
+/// index is clamped to the block's last word; a value that starts there
+/// cannot straddle, since every block ends on a word boundary.
+template <typename T, std::size_t N>
+STEVEMAC_TARGET("avx2")
+void unpack_block_avx2(const std::uint64_t *words, unsigned width, T base,
+		       T *out)
+{
+	const long long *src = reinterpret_cast<const long long *>(words);
+	const __m256i w = _mm256_set1_epi64x(width);
+	const __m256i last = _mm256_set1_epi64x(2 * width - 1);
+	const __m256i one = _mm256_set1_epi64x(1);
+	const __m256i sixty_four = _mm256_set1_epi64x(64);
+	const __m256i mask = _mm256_set1_epi64x(
+		width == 64 ? -1LL : (long long)((1ULL << width) - 1));
+	const __m256i vbase = _mm256_set1_epi64x((long long)base);
+	__m256i j = _mm256_setr_epi64x(0, 1, 2, 3);
+	const __m256i step = _mm256_set1_epi64x(4);
+
+	for (std::size_t i = 0; i < N; i += 4) {
+		const __m256i bit = _mm256_mul_epu32(j, w);
+		const __m256i idx = _mm256_srli_epi64(bit, 6);
+		const __m256i shift = _mm256_and_si256(bit, _mm256_set1_epi64x(63));
+		__m256i idx_hi = _mm256_add_epi64(idx, one);
+		idx_hi = _mm256_blendv_epi8(idx_hi, last,
+					    _mm256_cmpgt_epi64(idx_hi, last));
+
+		const __m256i lo = _mm256_i64gather_epi64(src, idx, 8);
+		const __m256i hi = _mm256_i64gather_epi64(src, idx_hi, 8);
+		// sllv by 64 yields 0, which covers shift == 0
+		__m256i v = _mm256_or_si256(
+			_mm256_srlv_epi64(lo, shift),
+			_mm256_sllv_epi64(hi, _mm256_sub_epi64(sixty_four, shift)));
+		v = _mm256_add_epi64(_mm256_and_si256(v, mask), vbase);
+
+		if constexpr (sizeof(T) == 8) {
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i),
+					    v);
+		} else {
+			const __m256i even = _mm256_permutevar8x32_epi32(
+				v, _mm256_setr_epi32(0, 2, 4, 6, 0, 0, 0, 0));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(out + i),
+					 _mm256_castsi256_si128(even));
+		}
+		j = _mm256_add_epi64(j, step);
+	}
+}
+#endif // STEVEMAC_SIMD_X86
+} // namespace detail
+
+///===----------------------------------------------------------------------===//
+///
+/// stevemac::compressed_vector
+/// Append-only vector of uint32_t or uint64_t stored in blocks of
+/// block_size values.  Each full block is frame-of-reference encoded: the
+/// block minimum is kept in the header and every value is bit-packed as
+/// (value - min) in just enough bits for the block's range.  Sorted IDs and
+/// timestamps typically need a handful of bits per value.
+/// A block of width w takes exactly 2 * w words, so a value's position is
+/// a multiply away and operator[] is O(1).  Values not yet filling a block
+/// sit uncompressed in _tail.
+/// Sequential reads should use the iterator (or decode_block), which
+/// unpacks a whole block at a time with the AVX2 kernel above when the CPU
+/// has it.
+//===----------------------------------------------------------------------===//
+template <typename T> class compressed_vector
+{
+	static_assert(std::is_same_v<T, std::uint32_t>
+			      || std::is_same_v<T, std::uint64_t>,
+		      "compressed_vector holds uint32_t or uint64_t");
+
+	struct block_header {
+		T base;
+		unsigned width;
+		std::size_t offset; // into _payload
+	};
+
+      public:
+	using value_type = T;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+	using const_reference = T;
+
+	static constexpr size_type block_size = 128;
+
+	class const_iterator;
+
+	//===----------------------------------------------------------------------===//
+	/// construct, conversion from and to stevemac::vector
+	//===----------------------------------------------------------------------===//
+	compressed_vector() = default;
+
+	template <class Allocator>
+	explicit compressed_vector(const vector<T, Allocator> &v)
+	{
+		const T *p = v.data();
+		size_type i = 0;
+		for (; i + block_size <= v.size(); i += block_size)
+			encode_block(p + i);
+		for (; i < v.size(); ++i)
+			_tail.push_back(p[i]);
+	}
+
+	template <class Allocator = std::allocator<T>>
+	vector<T, Allocator> to_vector() const
+	{
+		vector<T, Allocator> v;
+		v.resize(size());
+		for (size_type b = 0; b < _blocks.size(); ++b)
+			decode_block(b, v.data() + b * block_size);
+		std::copy(_tail.data(), _tail.data() + _tail.size(),
+			  v.data() + _blocks.size() * block_size);
+		return v;
+	}
+
+	//===----------------------------------------------------------------------===//
+	/// capacity and statistics
+	//===----------------------------------------------------------------------===//
+	size_type size() const noexcept
+	{
+		return _blocks.size() * block_size + _tail.size();
+	}
+	[[nodiscard]] bool empty() const noexcept
+	{
+		return size() == 0;
+	}
+	/// Full, encoded blocks; the tail is not counted.
+	size_type block_count() const noexcept
+	{
+		return _blocks.size();
+	}
+	/// Bytes held by the encoding, headers and the uncompressed tail.
+	size_type memory_bytes() const noexcept
+	{
+		return _payload.size() * sizeof(std::uint64_t)
+		       + _blocks.size() * sizeof(block_header)
+		       + _tail.size() * sizeof(T);
+	}
+	/// Uncompressed size over memory_bytes(); > 1 means it paid off.
+	double compression_ratio() const noexcept
+	{
+		const size_type bytes = memory_bytes();
+		return bytes == 0 ? 1.0 : double(size() * sizeof(T)) / bytes;
+	}
+
+	//===----------------------------------------------------------------------===//
+	/// element access
+	//===----------------------------------------------------------------------===//
+	const_reference operator[](size_type n) const
+	{
+		const size_type b = n / block_size;
+		if (b >= _blocks.size())
+			return _tail[n % block_size];
+
+		const block_header &h = _blocks[b];
+		if (h.width == 0)
+			return h.base;
+
+		const size_type bit = (n % block_size) * h.width;
+		const std::uint64_t *w = _payload.data() + h.offset + bit / 64;
+		const unsigned shift = bit % 64;
+		std::uint64_t v = w[0] >> shift;
+		if (shift + h.width > 64)
+			v |= w[1] << (64 - shift);
+		return h.base + T(v & low_mask(h.width));
+	}
+
+	const_reference at(size_type n) const
+	{
+		if (n >= size())
+			throw std::out_of_range("compressed_vector::at");
+		return (*this)[n];
+	}
+
+	/// Unpacks block b (block_size values) into out.
+	void decode_block(size_type b, T *out) const
+	{
+		const block_header &h = _blocks[b];
+		if (h.width == 0) {
+			std::fill(out, out + block_size, h.base);
+			return;
+		}
+
+		const std::uint64_t *w = _payload.data() + h.offset;
+#if STEVEMAC_SIMD_X86
+		if (simd_dispatch_level() == simd_level::avx2) {
+			detail::unpack_block_avx2<T, block_size>(w, h.width,
+								 h.base, out);
+			return;
+		}
+#endif
+		const std::uint64_t mask = low_mask(h.width);
+		for (size_type i = 0; i < block_size; ++i) {
+			const size_type bit = i * h.width;
+			const unsigned shift = bit % 64;
+			std::uint64_t v = w[bit / 64] >> shift;
+			if (shift + h.width > 64)
+				v |= w[bit / 64 + 1] << (64 - shift);
+			out[i] = h.base + T(v & mask);
+		}
+	}
+
+	const_iterator begin() const
+	{
+		return const_iterator(this, 0);
+	}
+	const_iterator end() const
+	{
+		return const_iterator(this, size());
+	}
+
+	//===----------------------------------------------------------------------===//
+	/// modifiers, append only
+	//===----------------------------------------------------------------------===//
+	void push_back(T val)
+	{
+		_tail.push_back(val);
+		if (_tail.size() == block_size) {
+			encode_block(_tail.data());
+			_tail.clear();
+		}
+	}
+
+	void clear() noexcept
+	{
+		_blocks.clear();
+		_payload.clear();
+		_tail.clear();
+	}
+
+	void swap(compressed_vector &other) noexcept
+	{
+		_blocks.swap(other._blocks);
+		_payload.swap(other._payload);
+		_tail.swap(other._tail);
+	}
+
+	///===----------------------------------------------------------------------===//
+	///
+	/// \class compressed_vector::const_iterator
+	/// \brief Forward iterator that decodes a block at a time into its own
+	/// buffer; a copy gets its own copy of the buffer, so copies are
+	/// independent.  Dereference is valid until the iterator moves on.
+	/// The position in the block is kept as an index, never as a pointer
+	/// into _buf, which would keep pointing at the source of a copy.
+	///
+	//===----------------------------------------------------------------------===//
+	class const_iterator
+	{
+	      public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const T *;
+		using reference = const T &;
+
+		const_iterator() = default;
+		const_iterator(const compressed_vector *c, size_type i)
+		    : _c(c), _i(i)
+		{
+			load();
+		}
+
+		reference operator*() const
+		{
+			const size_type k = _i % block_size;
+			return _in_tail ? _c->_tail.data()[k] : _buf[k];
+		}
+		pointer operator->() const
+		{
+			return &**this;
+		}
+		const_iterator &operator++()
+		{
+			if (++_i % block_size == 0)
+				load();
+			return *this;
+		}
+		const_iterator operator++(int)
+		{
+			const_iterator tmp = *this;
+			++*this;
+			return tmp;
+		}
+		bool operator==(const const_iterator &other) const noexcept
+		{
+			return _i == other._i;
+		}
+		bool operator!=(const const_iterator &other) const noexcept
+		{
+			return _i != other._i;
+		}
+
+	      private:
+		void load()
+		{
+			const size_type b = _i / block_size;
+			_in_tail = b >= _c->_blocks.size();
+			if (!_in_tail)
+				_c->decode_block(b, _buf.data());
+		}
+
+		const compressed_vector *_c = nullptr;
+		size_type _i = 0;
+		/// past the full blocks, reading _c->_tail instead of _buf
+		bool _in_tail = false;
+		std::array<T, block_size> _buf;
+	};
+
+	//===----------------------------------------------------------------------===//
+	/// compressed_vector private implementation
+	//===----------------------------------------------------------------------===//
+      private:
+	static std::uint64_t low_mask(unsigned width) noexcept
+	{
+		return width == 64 ? ~std::uint64_t(0)
+				   : (std::uint64_t(1) << width) - 1;
+	}
+
+	/// Frame of reference + bit packing for block_size values at p.
+	void encode_block(const T *p)
+	{
+		T lo = p[0], hi = p[0];
+		for (size_type i = 1; i < block_size; ++i) {
+			if (p[i] < lo)
+				lo = p[i];
+			if (hi < p[i])
+				hi = p[i];
+		}
+
+		const unsigned width = detail::bit_width(hi - lo);
+		const size_type offset = _payload.size();
+		_blocks.push_back(block_header{lo, width, offset});
+		if (width == 0)
+			return;
+
+		// block_size * width bits is exactly 2 * width words
+		for (unsigned i = 0; i < 2 * width; ++i)
+			_payload.push_back(0);
+
+		std::uint64_t *w = _payload.data() + offset;
+		for (size_type i = 0; i < block_size; ++i) {
+			const std::uint64_t v = std::uint64_t(p[i] - lo);
+			const size_type bit = i * width;
+			const unsigned shift = bit % 64;
+			w[bit / 64] |= v << shift;
+			if (shift + width > 64)
+				w[bit / 64 + 1] |= v >> (64 - shift);
+		}
+	}
+
+	//===----------------------------------------------------------------------===//
+	/// compressed_vector private data members
+	//===----------------------------------------------------------------------===//
+      private:
+	vector<block_header> _blocks;
+	vector<std::uint64_t> _payload;
+	vector<T> _tail;
+};
+} // namespace stevemac
@@ -0,0 +1,444 @@
+//===-- stevemac::dary_heap.h -------------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#pragma once
+#include "slot_map.h"
+#include "vector.h"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+namespace stevemac
+{
+namespace detail
+{
+//===----------------------------------------------------------------------===//
+/// d-ary heap kernels over a plain array.  The children of i are
+/// D*i+1 .. D*i+D, side by side, so picking the best child reads D
+/// neighbouring elements instead of chasing two cache lines per level of a
+/// binary heap, and the tree is log_D(n) levels deep.
+/// Both sifts move a hole instead of swapping.  moved(i) is called for every
+/// position that receives an element, for heaps that track positions.
+//===----------------------------------------------------------------------===//
+/// Returns the final position of a[i].
+template <std::size_t D, typename T, class Less, class Moved>
+std::size_t dary_sift_up(T *a, std::size_t i, Less &less, Moved &&moved)
+{
+	T tmp = std::move(a[i]);
+	while (i > 0) {
+		const std::size_t parent = (i - 1) / D;
+		if (!less(a[parent], tmp))
+			break;
+		a[i] = std::move(a[parent]);
+		moved(i);
+		i = parent;
+	}
+	a[i] = std::move(tmp);
+	moved(i);
+	return i;
+}
+
+/// Bottom-up: the hole goes all the way down the path of best children
+/// without comparing against a[i], then a[i] climbs back from the leaf.
+/// What sinks is usually the last leaf, which ends up near the bottom
+/// again, so this saves a comparison per level over the textbook loop.
+/// The child pick is a select rather than a branch; on random keys that
+/// branch is a coin flip.
+template <std::size_t D, typename T, class Less, class Moved>
+std::size_t dary_sift_down(T *a, std::size_t n, std::size_t i, Less &less,
+			   Moved &&moved)
+{
+	const std::size_t start = i;
+	T tmp = std::move(a[i]);
+	for (;;) {
+		const std::size_t first = D * i + 1;
+		if (first >= n)
+			break;
+		const std::size_t last = first + D < n ? first + D : n;
+		std::size_t best = first;
+		for (std::size_t c = first + 1; c < last; ++c)
+			best = less(a[best], a[c]) ? c : best;
+		a[i] = std::move(a[best]);
+		moved(i);
+		i = best;
+	}
+	while (i > start) {
+		const std::size_t parent = (i - 1) / D;
+		if (!less(a[parent], tmp))
+			break;
+		a[i] = std::move(a[parent]);
+		moved(i);
+		i = parent;
+	}
+	a[i] = std::move(tmp);
+	moved(i);
+	return i;
+}
+
+/// Floyd's bottom-up construction, O(n).
+template <std::size_t D, typename T, class Less, class Moved>
+void dary_heapify(T *a, std::size_t n, Less &less, Moved &&moved)
+{
+	if (n < 2)
+		return;
+	for (std::size_t i = (n - 2) / D + 1; i-- > 0;)
+		dary_sift_down<D>(a, n, i, less, moved);
+}
+
+struct dary_no_track {
+	void operator()(std::size_t) const noexcept {}
+};
+} // namespace detail
+
+///===----------------------------------------------------------------------===//
+///
+/// \class stevemac::dary_heap
+/// \brief Priority queue on a stevemac::vector with D children per node.
+/// Same contract as std::priority_queue: top() is the greatest element
+/// under Compare, so std::greater gives a min-heap.  D = 4 keeps the
+/// children of a node of 8 to 16 byte elements within a cache line or two;
+/// D = 8 only pays off for 4 byte elements.  Wider trees make push cheaper
+/// and pop compare more per level.
+///
+//===----------------------------------------------------------------------===//
+template <class T, std::size_t D = 4, class Compare = std::less<T>,
+	  class Allocator = std::allocator<T>>
+class dary_heap
+{
+	static_assert(D >= 2, "a d-ary heap needs at least two children");
+
+      public:
+	using value_type = T;
+	using size_type = std::size_t;
+	using reference = T &;
+	using const_reference = const T &;
+	using value_compare = Compare;
+	using allocator_type = Allocator;
+	using container_type = vector<T, Allocator>;
+	static constexpr std::size_t arity = D;
+
+	dary_heap() = default;
+	explicit dary_heap(const Compare &comp) : _comp(comp) {}
+	/// Heapifies v in place, O(n).
+	explicit dary_heap(container_type v, const Compare &comp = Compare())
+	    : _data(std::move(v)), _comp(comp)
+	{
+		make_heap();
+	}
+
+	/// Replaces the contents with v, heapified in O(n).
+	void heapify(container_type v)
+	{
+		_data = std::move(v);
+		make_heap();
+	}
+
+	[[nodiscard]] bool empty() const noexcept
+	{
+		return _data.empty();
+	}
+	size_type size() const noexcept
+	{
+		return _data.size();
+	}
+	void reserve(size_type n)
+	{
+		_data.reserve(n);
+	}
+	void clear() noexcept
+	{
+		_data.clear();
+	}
+
+	/// Requires: !empty()
+	const_reference top() const noexcept
+	{
+		assert(!empty());
+		return _data[0];
+	}
+
+	void push(const T &value)
+	{
+		emplace(value);
+	}
+	void push(T &&value)
+	{
+		emplace(std::move(value));
+	}
+	template <class... Args> void emplace(Args &&... args)
+	{
+		_data.emplace_back(std::forward<Args>(args)...);
+		detail::dary_sift_up<D>(_data.data(), _data.size() - 1, _comp,
+					detail::dary_no_track{});
+	}
+
+	/// Requires: !empty()
+	void pop()
+	{
+		assert(!empty());
+		const size_type n = _data.size() - 1;
+		if (n != 0)
+			_data[0] = std::move(_data[n]);
+		_data.pop_back();
+		if (n > 1)
+			detail::dary_sift_down<D>(_data.data(), n, 0, _comp,
+						  detail::dary_no_track{});
+	}
+	/// pop() that hands back the element it removes.
+	T extract_top()
+	{
+		assert(!empty());
+		T v = std::move(_data[0]);
+		pop();
+		return v;
+	}
+
+	/// The heap ordered array, e.g. to hand back to heapify() later.
+	const container_type &container() const noexcept
+	{
+		return _data;
+	}
+	container_type take() noexcept
+	{
+		return std::move(_data);
+	}
+
+	void swap(dary_heap &other)
+	{
+		using std::swap;
+		_data.swap(other._data);
+		swap(_comp, other._comp);
+	}
+
+      private:
+	void make_heap()
+	{
+		detail::dary_heapify<D>(_data.data(), _data.size(), _comp,
+					detail::dary_no_track{});
+	}
+
+	container_type _data;
+	Compare _comp;
+};
+
+///===----------------------------------------------------------------------===//
+///
+/// \class stevemac::mutable_dary_heap
+/// \brief dary_heap whose elements can be reprioritized or removed after
+/// they are pushed.  push returns a handle, a generational key like
+/// slot_map's: it stays valid until its element is popped or erased and is
+/// detected as stale after that.
+/// Each heap node carries its slot number and every move updates the
+/// slot's position, which costs a store per level against dary_heap.
+/// decrease_key follows the Dijkstra usage, with std::greater as Compare:
+/// the new value may only move the element towards the top.
+///
+//===----------------------------------------------------------------------===//
+template <class T, std::size_t D = 4, class Compare = std::less<T>,
+	  class Allocator = std::allocator<T>>
+class mutable_dary_heap
+{
+	static_assert(D >= 2, "a d-ary heap needs at least two children");
+
+	struct node {
+		T value;
+		std::uint32_t slot;
+	};
+	struct slot {
+		/// heap position while live, next free slot while free
+		std::uint32_t pos;
+		std::uint32_t generation;
+	};
+	struct node_less {
+		Compare comp;
+		bool operator()(const node &x, const node &y)
+		{
+			return comp(x.value, y.value);
+		}
+	};
+	struct track {
+		mutable_dary_heap *h;
+		void operator()(std::size_t i) const noexcept
+		{
+			h->_slots[h->_nodes[i].slot].pos = std::uint32_t(i);
+		}
+	};
+	using node_allocator = typename std::allocator_traits<
+		Allocator>::template rebind_alloc<node>;
+	using slot_allocator = typename std::allocator_traits<
+		Allocator>::template rebind_alloc<slot>;
+	static constexpr std::uint32_t no_slot =
+		std::numeric_limits<std::uint32_t>::max();
+
+      public:
+	using value_type = T;
+	using size_type = std::size_t;
+	using const_reference = const T &;
+	using value_compare = Compare;
+	using allocator_type = Allocator;
+	using handle_type = slot_map_key;
+	static constexpr std::size_t arity = D;
+
+	mutable_dary_heap() = default;
+	explicit mutable_dary_heap(const Compare &comp,
+				   const allocator_type &a = allocator_type())
+	    : _nodes(node_allocator(a)), _slots(slot_allocator(a)),
+	      _less{comp}
+	{
+	}
+
+	[[nodiscard]] bool empty() const noexcept
+	{
+		return _nodes.empty();
+	}
+	size_type size() const noexcept
+	{
+		return _nodes.size();
+	}
+	void reserve(size_type n)
+	{
+		_nodes.reserve(n);
+		_slots.reserve(n);
+	}
+	/// Removes everything; every outstanding handle becomes stale.
+	void clear() noexcept
+	{
+		for (size_type i = 0; i < _nodes.size(); ++i)
+			release(_nodes[i].slot);
+		_nodes.clear();
+	}
+
+	/// Requires: !empty()
+	const_reference top() const noexcept
+	{
+		assert(!empty());
+		return _nodes[0].value;
+	}
+	handle_type top_handle() const noexcept
+	{
+		assert(!empty());
+		return handle_of(0);
+	}
+
+	handle_type push(const T &value)
+	{
+		return emplace(value);
+	}
+	handle_type push(T &&value)
+	{
+		return emplace(std::move(value));
+	}
+	template <class... Args> handle_type emplace(Args &&... args)
+	{
+		if (_nodes.size() >= no_slot)
+			throw std::length_error("mutable_dary_heap::emplace");
+		if (_free == no_slot) {
+			_slots.push_back(slot{no_slot, 0});
+			_free = std::uint32_t(_slots.size() - 1);
+		}
+		const std::uint32_t s = _free;
+		_nodes.push_back(node{T(std::forward<Args>(args)...), s});
+		_free = _slots[s].pos;
+		detail::dary_sift_up<D>(_nodes.data(), _nodes.size() - 1, _less,
+					track{this});
+		return handle_type{s, _slots[s].generation};
+	}
+
+	/// Requires: !empty()
+	void pop()
+	{
+		assert(!empty());
+		remove_at(0);
+	}
+
+	bool contains(const handle_type &h) const noexcept
+	{
+		return h.index < _slots.size()
+		       && _slots[h.index].generation == h.generation
+		       && _slots[h.index].pos < _nodes.size()
+		       && _nodes[_slots[h.index].pos].slot == h.index;
+	}
+	/// Requires: contains(h)
+	const_reference operator[](const handle_type &h) const noexcept
+	{
+		assert(contains(h));
+		return _nodes[_slots[h.index].pos].value;
+	}
+
+	/// Gives the element a new value that is at least as close to the top,
+	/// !comp(value, old); with std::greater that is a smaller key.
+	/// Requires: contains(h)
+	void decrease_key(const handle_type &h, T value)
+	{
+		assert(contains(h));
+		const std::size_t pos = _slots[h.index].pos;
+		assert(!_less.comp(value, _nodes[pos].value));
+		_nodes[pos].value = std::move(value);
+		detail::dary_sift_up<D>(_nodes.data(), pos, _less, track{this});
+	}
+	/// Gives the element any new value.
+	/// Requires: contains(h)
+	void update(const handle_type &h, T value)
+	{
+		assert(contains(h));
+		const std::size_t pos = _slots[h.index].pos;
+		_nodes[pos].value = std::move(value);
+		restore(pos);
+	}
+	/// Removes the element h names; false if h is stale.
+	bool erase(const handle_type &h)
+	{
+		if (!contains(h))
+			return false;
+		remove_at(_slots[h.index].pos);
+		return true;
+	}
+
+      private:
+	handle_type handle_of(std::size_t pos) const noexcept
+	{
+		const std::uint32_t s = _nodes[pos].slot;
+		return handle_type{s, _slots[s].generation};
+	}
+
+	void restore(std::size_t pos)
+	{
+		if (detail::dary_sift_up<D>(_nodes.data(), pos, _less,
+					    track{this})
+		    == pos)
+			detail::dary_sift_down<D>(_nodes.data(), _nodes.size(),
+						  pos, _less, track{this});
+	}
+
+	void remove_at(std::size_t pos)
+	{
+		release(_nodes[pos].slot);
+		const std::size_t last = _nodes.size() - 1;
+		if (pos != last)
+			_nodes[pos] = std::move(_nodes[last]);
+		_nodes.pop_back();
+		if (pos != last)
+			restore(pos);
+	}
+
+	void release(std::uint32_t s) noexcept
+	{
+		++_slots[s].generation;
+		_slots[s].pos = _free;
+		_free = s;
+	}
+
+	vector<node, node_allocator> _nodes;
+	vector<slot, slot_allocator> _slots;
+	node_less _less;
+	std::uint32_t _free = no_slot;
+};
+} // namespace stevemac
@@ -0,0 +1,210 @@
+//===-- stevemac::execution.h -------------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace stevemac
+{
+///===----------------------------------------------------------------------===//
+///
+/// Execution policy for the parallel vector constructors, assign and
+/// resize.  Work is split into one contiguous chunk per thread, with chunk
+/// boundaries on page boundaries of the buffer being filled, so on a NUMA
+/// box every page is first touched, and therefore placed, by the thread
+/// that filled it.  Only element sizes that divide the page size can end
+/// exactly on a page; larger or odd sizes split within an element's reach.
+/// for_each_chunk() exposes the same partition so a later parallel scan
+/// with the same thread count reads node local memory.
+//===----------------------------------------------------------------------===//
+struct parallel_policy {
+	/// 0 means std::thread::hardware_concurrency()
+	unsigned threads = 0;
+	/// below this many bytes the work is done on the calling thread
+	std::size_t serial_cutoff = std::size_t(1) << 20;
+};
+
+inline constexpr parallel_policy par{};
+
+namespace detail
+{
+constexpr std::size_t first_touch_page = 4096;
+
+/// Splits [0, n) into at most `threads` contiguous ranges of the same
+/// multiple of `grain` elements, the last one shorter.  Given the address
+/// of element 0, the first range also takes the elements before the first
+/// page boundary, which makes it the longest, so that every later one
+/// starts on a page; without it boundaries are page multiples from 0.
+class chunk_plan
+{
+      public:
+	chunk_plan(std::size_t n, std::size_t bytes_each,
+		   const parallel_policy &policy, const void *first = nullptr)
+	    : _n(n)
+	{
+		std::size_t threads = policy.threads != 0
+					      ? policy.threads
+					      : std::thread::hardware_concurrency();
+		if (threads == 0 || n * bytes_each < policy.serial_cutoff)
+			threads = 1;
+
+		const std::size_t grain =
+			bytes_each >= first_touch_page
+				? 1
+				: first_touch_page / bytes_each;
+		std::size_t per = (n + threads - 1) / threads;
+		per = (per + grain - 1) / grain * grain;
+		_per = per == 0 ? 1 : per;
+
+		if (first != nullptr && bytes_each < first_touch_page
+		    && first_touch_page % bytes_each == 0) {
+			const std::size_t off =
+				reinterpret_cast<std::uintptr_t>(first)
+				% first_touch_page;
+			if (off % bytes_each == 0)
+				_lead = std::min(n, (first_touch_page - off)
+							    % first_touch_page
+							    / bytes_each);
+		}
+		const std::size_t head = std::min(n, _lead + _per);
+		_chunks = n == 0 ? 0 : 1 + (n - head + _per - 1) / _per;
+	}
+
+	std::size_t chunks() const noexcept
+	{
+		return _chunks;
+	}
+	std::size_t begin(std::size_t i) const noexcept
+	{
+		return i == 0 ? 0 : std::min(_n, _lead + i * _per);
+	}
+	std::size_t end(std::size_t i) const noexcept
+	{
+		return std::min(_n, _lead + (i + 1) * _per);
+	}
+
+      private:
+	std::size_t _n;
+	std::size_t _per;
+	/// elements before the first page boundary
+	std::size_t _lead = 0;
+	std::size_t _chunks;
+};
+
+/// Runs f(chunk, begin, end) for every chunk of plan, chunk 0 on the
+/// calling thread.  Waits for all of them; if any threw, the first
+/// exception is rethrown.
+template <class F> void run_chunks(const chunk_plan &plan, F &&f)
+{
+	if (plan.chunks() <= 1) {
+		if (plan.chunks() == 1)
+			f(std::size_t(0), plan.begin(0), plan.end(0));
+		return;
+	}
+
+	std::exception_ptr error;
+	std::mutex error_lock;
+	auto body = [&](std::size_t i) {
+		try {
+			f(i, plan.begin(i), plan.end(i));
+		} catch (...) {
+			std::lock_guard<std::mutex> g(error_lock);
+			if (!error)
+				error = std::current_exception();
+		}
+	};
+
+	std::vector<std::thread> workers;
+	workers.reserve(plan.chunks() - 1);
+	try {
+		for (std::size_t i = 1; i < plan.chunks(); ++i)
+			workers.emplace_back(body, i);
+	} catch (...) {
+		// could not start a thread; run the rest here
+		for (std::size_t i = workers.size() + 1; i < plan.chunks(); ++i)
+			body(i);
+	}
+	body(0);
+	for (auto &t : workers)
+		t.join();
+
+	if (error)
+		std::rethrow_exception(error);
+}
+
+/// vector's parallel constructors, assign and resize: constructs n
+/// elements at first from args on the threads of policy.  A chunk that
+/// throws destroys its own elements; once everyone has joined the chunks
+/// that did finish are destroyed too, then the first exception is
+/// rethrown.  Declared in vector.h, which does not include this file.
+template <class Allocator, class Pointer, class... Args>
+void parallel_construct(const parallel_policy &policy, Allocator &a,
+			Pointer first, std::size_t n, const Args &... args)
+{
+	using traits = std::allocator_traits<Allocator>;
+	auto destroy = [&](std::size_t b, std::size_t e) {
+		for (; b != e; ++b)
+			traits::destroy(a, std::to_address(first + b));
+	};
+
+	const chunk_plan plan(n, sizeof(*std::to_address(first)), policy,
+			      std::to_address(first));
+	std::unique_ptr<bool[]> done(new bool[plan.chunks()]());
+	try {
+		run_chunks(plan, [&](std::size_t c, std::size_t b,
+				     std::size_t e) {
+			std::size_t i = b;
+			try {
+				for (; i < e; ++i)
+					traits::construct(
+						a, std::to_address(first + i),
+						args...);
+			} catch (...) {
+				destroy(b, i);
+				throw;
+			}
+			done[c] = true;
+		});
+	} catch (...) {
+		for (std::size_t c = 0; c < plan.chunks(); ++c)
+			if (done[c])
+				destroy(plan.begin(c), plan.end(c));
+		throw;
+	}
+}
+} // namespace detail
+
+/// Calls f(begin, end) over [0, n) split into page multiples from 0, as
+/// a buffer of n elements of elem_size bytes starting on a page would be.
+template <class F>
+void for_each_chunk(const parallel_policy &policy, std::size_t n,
+		    std::size_t elem_size, F f)
+{
+	detail::run_chunks(detail::chunk_plan(n, elem_size, policy),
+			   [&](std::size_t, std::size_t b, std::size_t e) {
+				   f(b, e);
+			   });
+}
+
+/// Calls f(begin, end) over the n elements at first, split exactly as a
+/// vector with that data() was filled under the same policy.
+template <class T, class F>
+void for_each_chunk(const parallel_policy &policy, const T *first,
+		    std::size_t n, F f)
+{
+	detail::run_chunks(detail::chunk_plan(n, sizeof(T), policy, first),
+			   [&](std::size_t, std::size_t b, std::size_t e) {
+				   f(b, e);
+			   });
+}
+} // namespace stevemac
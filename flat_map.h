@@ -0,0 +1,584 @@
+//===-- stevemac::flat_map.h --------------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#pragma once
+#include "flat_search.h"
+#include "vector.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace stevemac
+{
+///===----------------------------------------------------------------------===//
+///
+/// \class stevemac::flat_map_iterator
+/// \brief Random access iterator over a flat_map.  Dereferencing yields a
+/// pair of references into the key and value arrays, so like
+/// std::flat_map's iterator it is a proxy, not a value_type &.
+///
+//===----------------------------------------------------------------------===//
+template <typename Map, bool Const> class flat_map_iterator
+{
+	using map_pointer = std::conditional_t<Const, const Map *, Map *>;
+
+      public:
+	using iterator_category = std::random_access_iterator_tag;
+	using value_type = typename Map::value_type;
+	using difference_type = std::ptrdiff_t;
+	using size_type = typename Map::size_type;
+	using reference = std::conditional_t<Const, typename Map::const_reference,
+					     typename Map::reference>;
+	struct pointer {
+		reference ref;
+		reference *operator->() noexcept
+		{
+			return &ref;
+		}
+	};
+
+	flat_map_iterator() noexcept : _m(nullptr), _i(0) {}
+	flat_map_iterator(map_pointer m, size_type i) noexcept : _m(m), _i(i) {}
+	/// iterator -> const_iterator
+	template <bool OtherConst, typename = std::enable_if_t<Const && !OtherConst>>
+	flat_map_iterator(const flat_map_iterator<Map, OtherConst> &other) noexcept
+	    : _m(other._m), _i(other._i)
+	{
+	}
+
+	reference operator*() const
+	{
+		return reference(_m->_keys[_i], _m->_values[_i]);
+	}
+	pointer operator->() const
+	{
+		return pointer{**this};
+	}
+	reference operator[](difference_type n) const
+	{
+		return *(*this + n);
+	}
+
+	/// the position in keys() and values()
+	size_type index() const noexcept
+	{
+		return _i;
+	}
+
+	flat_map_iterator &operator++() noexcept
+	{
+		++_i;
+		return *this;
+	}
+	flat_map_iterator operator++(int) noexcept
+	{
+		flat_map_iterator tmp = *this;
+		++_i;
+		return tmp;
+	}
+	flat_map_iterator &operator--() noexcept
+	{
+		--_i;
+		return *this;
+	}
+	flat_map_iterator operator--(int) noexcept
+	{
+		flat_map_iterator tmp = *this;
+		--_i;
+		return tmp;
+	}
+	flat_map_iterator &operator+=(difference_type n) noexcept
+	{
+		_i += n;
+		return *this;
+	}
+	flat_map_iterator &operator-=(difference_type n) noexcept
+	{
+		_i -= n;
+		return *this;
+	}
+	flat_map_iterator operator+(difference_type n) const noexcept
+	{
+		return flat_map_iterator(_m, _i + n);
+	}
+	friend flat_map_iterator operator+(difference_type n,
+					   const flat_map_iterator &it) noexcept
+	{
+		return it + n;
+	}
+	flat_map_iterator operator-(difference_type n) const noexcept
+	{
+		return flat_map_iterator(_m, _i - n);
+	}
+	difference_type operator-(const flat_map_iterator &other) const noexcept
+	{
+		return static_cast<difference_type>(_i)
+		       - static_cast<difference_type>(other._i);
+	}
+
+	bool operator==(const flat_map_iterator &other) const noexcept
+	{
+		return _i == other._i;
+	}
+	bool operator!=(const flat_map_iterator &other) const noexcept
+	{
+		return _i != other._i;
+	}
+	bool operator<(const flat_map_iterator &other) const noexcept
+	{
+		return _i < other._i;
+	}
+	bool operator>(const flat_map_iterator &other) const noexcept
+	{
+		return _i > other._i;
+	}
+	bool operator<=(const flat_map_iterator &other) const noexcept
+	{
+		return _i <= other._i;
+	}
+	bool operator>=(const flat_map_iterator &other) const noexcept
+	{
+		return _i >= other._i;
+	}
+
+      private:
+	template <typename, bool> friend class flat_map_iterator;
+	map_pointer _m;
+	size_type _i;
+};
+
+///===----------------------------------------------------------------------===//
+///
+/// \class stevemac::flat_map
+/// \brief Sorted map stored as two stevemac::vectors, keys and values.
+/// Searches only touch the key array, so a lookup walks densely packed
+/// keys instead of striding over the values.  The search, the optional
+/// Eytzinger index (build_index()) and the duplicate rule (first one wins)
+/// are those of flat_set.
+/// Bulk construction sorts a permutation of the input once and moves the
+/// pairs into place in a single deduplicating pass; range insert does the
+/// same for the new pairs and then merges the two sorted runs.
+///
+//===----------------------------------------------------------------------===//
+template <class Key, class T, class Compare = std::less<Key>,
+	  class KeyAllocator = std::allocator<Key>,
+	  class MappedAllocator = std::allocator<T>>
+class flat_map
+{
+      public:
+	using key_type = Key;
+	using mapped_type = T;
+	using value_type = std::pair<Key, T>;
+	using key_compare = Compare;
+	using reference = std::pair<const Key &, T &>;
+	using const_reference = std::pair<const Key &, const T &>;
+	using key_container_type = vector<Key, KeyAllocator>;
+	using mapped_container_type = vector<T, MappedAllocator>;
+	using size_type = typename key_container_type::size_type;
+	using difference_type = typename key_container_type::difference_type;
+	using iterator = flat_map_iterator<flat_map, false>;
+	using const_iterator = flat_map_iterator<flat_map, true>;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+	flat_map() : _comp() {}
+	explicit flat_map(const Compare &comp) : _comp(comp) {}
+	/// keys[i] maps to values[i]; sorts and deduplicates.
+	flat_map(key_container_type keys, mapped_container_type values,
+		 const Compare &comp = Compare())
+	    : _comp(comp)
+	{
+		assert(keys.size() == values.size());
+		sort_unique_into(keys, values, _keys, _values);
+	}
+	/// keys must already be sorted and unique.
+	flat_map(sorted_unique_t, key_container_type keys,
+		 mapped_container_type values, const Compare &comp = Compare())
+	    : _keys(std::move(keys)), _values(std::move(values)), _comp(comp)
+	{
+		assert(_keys.size() == _values.size());
+	}
+	template <class InputIterator>
+	flat_map(InputIterator first, InputIterator last,
+		 const Compare &comp = Compare())
+	    : _comp(comp)
+	{
+		insert(first, last);
+	}
+	flat_map(std::initializer_list<value_type> il,
+		 const Compare &comp = Compare())
+	    : flat_map(il.begin(), il.end(), comp)
+	{
+	}
+
+	// iterators
+	iterator begin() noexcept
+	{
+		return iterator(this, 0);
+	}
+	const_iterator begin() const noexcept
+	{
+		return const_iterator(this, 0);
+	}
+	iterator end() noexcept
+	{
+		return iterator(this, size());
+	}
+	const_iterator end() const noexcept
+	{
+		return const_iterator(this, size());
+	}
+	const_iterator cbegin() const noexcept
+	{
+		return begin();
+	}
+	const_iterator cend() const noexcept
+	{
+		return end();
+	}
+	reverse_iterator rbegin() noexcept
+	{
+		return reverse_iterator(end());
+	}
+	const_reverse_iterator rbegin() const noexcept
+	{
+		return const_reverse_iterator(end());
+	}
+	reverse_iterator rend() noexcept
+	{
+		return reverse_iterator(begin());
+	}
+	const_reverse_iterator rend() const noexcept
+	{
+		return const_reverse_iterator(begin());
+	}
+
+	// capacity
+	bool empty() const noexcept
+	{
+		return _keys.empty();
+	}
+	size_type size() const noexcept
+	{
+		return _keys.size();
+	}
+	size_type max_size() const noexcept
+	{
+		return std::min(_keys.max_size(), _values.max_size());
+	}
+	void reserve(size_type n)
+	{
+		_keys.reserve(n);
+		_values.reserve(n);
+	}
+	void shrink_to_fit()
+	{
+		_keys.shrink_to_fit();
+		_values.shrink_to_fit();
+	}
+
+	// element access
+	T &operator[](const Key &k)
+	{
+		return try_emplace(k).first->second;
+	}
+	T &operator[](Key &&k)
+	{
+		return try_emplace(std::move(k)).first->second;
+	}
+	T &at(const Key &k)
+	{
+		iterator it = find(k);
+		if (it == end())
+			throw std::out_of_range("flat_map::at");
+		return _values[it.index()];
+	}
+	const T &at(const Key &k) const
+	{
+		const_iterator it = find(k);
+		if (it == end())
+			throw std::out_of_range("flat_map::at");
+		return _values[it.index()];
+	}
+
+	// modifiers
+	std::pair<iterator, bool> insert(const value_type &v)
+	{
+		return try_emplace(v.first, v.second);
+	}
+	std::pair<iterator, bool> insert(value_type &&v)
+	{
+		return try_emplace(std::move(v.first), std::move(v.second));
+	}
+	template <class... Args> std::pair<iterator, bool> emplace(Args &&... args)
+	{
+		value_type v(std::forward<Args>(args)...);
+		return try_emplace(std::move(v.first), std::move(v.second));
+	}
+	template <class K, class... Args>
+	std::pair<iterator, bool> try_emplace(K &&k, Args &&... args)
+	{
+		const size_type i = lower_bound_index(k);
+		if (i != size() && !_comp(k, _keys[i]))
+			return {iterator(this, i), false};
+		detail::insert_at(_keys, i, std::forward<K>(k));
+		_index.clear();
+		try {
+			detail::insert_at(_values, i, std::forward<Args>(args)...);
+		} catch (...) {
+			detail::erase_at(_keys, i, i + 1);
+			throw;
+		}
+		return {iterator(this, i), true};
+	}
+	template <class K, class M>
+	std::pair<iterator, bool> insert_or_assign(K &&k, M &&obj)
+	{
+		auto r = try_emplace(std::forward<K>(k), std::forward<M>(obj));
+		if (!r.second)
+			_values[r.first.index()] = std::forward<M>(obj);
+		return r;
+	}
+
+	/// Sorts and deduplicates [first, last) and merges it into the map
+	/// in one pass.
+	template <class InputIterator>
+	void insert(InputIterator first, InputIterator last)
+	{
+		key_container_type keys;
+		mapped_container_type values;
+		for (; first != last; ++first) {
+			keys.push_back(first->first);
+			values.push_back(first->second);
+		}
+		if (empty()) {
+			sort_unique_into(keys, values, _keys, _values);
+			_index.clear();
+			return;
+		}
+
+		key_container_type new_keys;
+		mapped_container_type new_values;
+		sort_unique_into(keys, values, new_keys, new_values);
+		merge(new_keys, new_values);
+	}
+	void insert(std::initializer_list<value_type> il)
+	{
+		insert(il.begin(), il.end());
+	}
+
+	iterator erase(const_iterator position)
+	{
+		const size_type i = position.index();
+		detail::erase_at(_keys, i, i + 1);
+		detail::erase_at(_values, i, i + 1);
+		_index.clear();
+		return iterator(this, i);
+	}
+	iterator erase(const_iterator first, const_iterator last)
+	{
+		const size_type i = first.index(), j = last.index();
+		detail::erase_at(_keys, i, j);
+		detail::erase_at(_values, i, j);
+		_index.clear();
+		return iterator(this, i);
+	}
+	size_type erase(const Key &k)
+	{
+		const_iterator it = find(k);
+		if (it == end())
+			return 0;
+		erase(it);
+		return 1;
+	}
+	void clear() noexcept
+	{
+		_keys.clear();
+		_values.clear();
+		_index.clear();
+	}
+	void swap(flat_map &other) noexcept
+	{
+		_keys.swap(other._keys);
+		_values.swap(other._values);
+		std::swap(_comp, other._comp);
+		std::swap(_index, other._index);
+	}
+
+	const key_container_type &keys() const noexcept
+	{
+		return _keys;
+	}
+	const mapped_container_type &values() const noexcept
+	{
+		return _values;
+	}
+
+	// lookup
+	iterator find(const Key &k)
+	{
+		return iterator(this, find_index(k));
+	}
+	const_iterator find(const Key &k) const
+	{
+		return const_iterator(this, find_index(k));
+	}
+	bool contains(const Key &k) const
+	{
+		if (_index.built())
+			return _index.contains(k, _comp);
+		return find_index(k) != size();
+	}
+	size_type count(const Key &k) const
+	{
+		return contains(k) ? 1 : 0;
+	}
+	iterator lower_bound(const Key &k)
+	{
+		return iterator(this, lower_bound_index(k));
+	}
+	const_iterator lower_bound(const Key &k) const
+	{
+		return const_iterator(this, lower_bound_index(k));
+	}
+	iterator upper_bound(const Key &k)
+	{
+		return iterator(this, upper_bound_index(k));
+	}
+	const_iterator upper_bound(const Key &k) const
+	{
+		return const_iterator(this, upper_bound_index(k));
+	}
+	std::pair<iterator, iterator> equal_range(const Key &k)
+	{
+		return {lower_bound(k), upper_bound(k)};
+	}
+	std::pair<const_iterator, const_iterator>
+	equal_range(const Key &k) const
+	{
+		return {lower_bound(k), upper_bound(k)};
+	}
+
+	/// Builds the Eytzinger search index over the keys for a read mostly
+	/// map; see flat_set::build_index().  Assigning through values or
+	/// iterators keeps it; anything that adds or removes a key drops it.
+	void build_index()
+	{
+		_index.build(_keys.data(), _keys.size());
+	}
+	bool indexed() const noexcept
+	{
+		return _index.built();
+	}
+
+	key_compare key_comp() const
+	{
+		return _comp;
+	}
+
+	friend bool operator==(const flat_map &x, const flat_map &y)
+	{
+		return x._keys == y._keys && x._values == y._values;
+	}
+	friend bool operator!=(const flat_map &x, const flat_map &y)
+	{
+		return !(x == y);
+	}
+
+      private:
+	template <typename, bool> friend class flat_map_iterator;
+	using size_allocator = typename std::allocator_traits<
+		KeyAllocator>::template rebind_alloc<size_type>;
+
+	size_type lower_bound_index(const Key &k) const
+	{
+		if (_index.built())
+			return _index.lower_bound(k, _comp);
+		return detail::branchless_lower_bound(_keys.data(),
+						      _keys.size(), k, _comp);
+	}
+	size_type upper_bound_index(const Key &k) const
+	{
+		const size_type i = lower_bound_index(k);
+		return i != size() && !_comp(k, _keys[i]) ? i + 1 : i;
+	}
+	size_type find_index(const Key &k) const
+	{
+		const size_type i = lower_bound_index(k);
+		return i != size() && !_comp(k, _keys[i]) ? i : size();
+	}
+
+	/// Stable sorts a permutation of keys, then moves each first of a run
+	/// of equal keys, and its value, to the back of out_keys/out_values.
+	void sort_unique_into(key_container_type &keys,
+			      mapped_container_type &values,
+			      key_container_type &out_keys,
+			      mapped_container_type &out_values)
+	{
+		const size_type n = keys.size();
+		vector<size_type, size_allocator> order;
+		order.reserve(n);
+		for (size_type i = 0; i < n; ++i)
+			order.push_back(i);
+		std::stable_sort(order.data(), order.data() + n,
+				 [&](size_type a, size_type b) {
+					 return _comp(keys[a], keys[b]);
+				 });
+
+		out_keys.clear();
+		out_values.clear();
+		out_keys.reserve(n);
+		out_values.reserve(n);
+		for (size_type j = 0; j < n; ++j) {
+			const size_type i = order[j];
+			if (!out_keys.empty() && !_comp(out_keys.back(), keys[i]))
+				continue;
+			out_keys.push_back(std::move(keys[i]));
+			out_values.push_back(std::move(values[i]));
+		}
+	}
+
+	/// Merges a sorted, unique run into the map; existing keys win.
+	void merge(key_container_type &keys, mapped_container_type &values)
+	{
+		key_container_type out_keys;
+		mapped_container_type out_values;
+		out_keys.reserve(_keys.size() + keys.size());
+		out_values.reserve(_keys.size() + keys.size());
+
+		size_type i = 0, j = 0;
+		while (i < _keys.size() || j < keys.size()) {
+			if (j == keys.size()
+			    || (i < _keys.size() && !_comp(keys[j], _keys[i]))) {
+				if (j < keys.size() && !_comp(_keys[i], keys[j]))
+					++j;
+				out_keys.push_back(std::move(_keys[i]));
+				out_values.push_back(std::move(_values[i]));
+				++i;
+			} else {
+				out_keys.push_back(std::move(keys[j]));
+				out_values.push_back(std::move(values[j]));
+				++j;
+			}
+		}
+		_keys.swap(out_keys);
+		_values.swap(out_values);
+		_index.clear();
+	}
+
+	key_container_type _keys;
+	mapped_container_type _values;
+	Compare _comp;
+	detail::eytzinger_index<Key, Compare, KeyAllocator> _index;
+};
+} // namespace stevemac
@@ -0,0 +1,162 @@
+//===-- stevemac::flat_search.h -----------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#pragma once
+#include "vector.h"
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace stevemac
+{
+/// Tag for the flat_set/flat_map constructors taking input that is
+/// already sorted and free of duplicates.
+struct sorted_unique_t {
+	explicit sorted_unique_t() = default;
+};
+inline constexpr sorted_unique_t sorted_unique{};
+
+namespace detail
+{
+///===----------------------------------------------------------------------===//
+///
+/// Search kernels behind flat_set and flat_map.
+/// branchless_lower_bound is the plain sorted array search: the loop body
+/// is a conditional move, so no mispredicted branch per level, and the two
+/// possible next midpoints are prefetched while the compare resolves.
+///
+/// eytzinger_index is the read-mostly layout: a copy of the keys in BFS
+/// order of the implicit search tree (children of node k at 2k and 2k+1,
+/// 1-based), so the first levels of every search share a few cache lines,
+/// and the descendants four levels down (for 4 byte keys) sit on one line
+/// that is prefetched while the levels in between are compared.  rank maps a
+/// node back to its position in the sorted array.
+//===----------------------------------------------------------------------===//
+template <class Key, class Compare>
+std::size_t branchless_lower_bound(const Key *first, std::size_t n,
+				   const Key &x, const Compare &comp)
+{
+	if (n == 0)
+		return 0;
+	const Key *base = first;
+	while (n > 1) {
+		const std::size_t half = n / 2;
+		__builtin_prefetch(base + half / 2);
+		__builtin_prefetch(base + half + half / 2);
+		base = comp(base[half], x) ? base + half : base;
+		n -= half;
+	}
+	return std::size_t(base - first) + comp(*base, x);
+}
+
+template <class Key, class Compare, class Allocator> class eytzinger_index
+{
+	using size_alloc = typename std::allocator_traits<
+		Allocator>::template rebind_alloc<std::size_t>;
+
+      public:
+	bool built() const noexcept
+	{
+		return _built;
+	}
+	void clear() noexcept
+	{
+		_tree.clear();
+		_rank.clear();
+		_built = false;
+	}
+
+	void build(const Key *sorted, std::size_t n)
+	{
+		clear();
+		_rank.resize(n + 1);
+		std::size_t next = 0;
+		fill_rank(1, n, next);
+		_tree.reserve(n);
+		for (std::size_t k = 1; k <= n; ++k)
+			_tree.push_back(sorted[_rank[k]]);
+		_built = true;
+	}
+
+	/// Index into the sorted array of the first key not less than x, or
+	/// size() if there is none.
+	std::size_t lower_bound(const Key &x, const Compare &comp) const
+	{
+		const std::size_t k = node_lower_bound(x, comp);
+		return k == 0 ? _tree.size() : _rank[k];
+	}
+	/// Membership only; compares against the tree node, so unlike
+	/// lower_bound it does not touch the rank array.
+	bool contains(const Key &x, const Compare &comp) const
+	{
+		const std::size_t k = node_lower_bound(x, comp);
+		return k != 0 && !comp(x, _tree[k - 1]);
+	}
+
+      private:
+	/// 1-based node of the first key not less than x, 0 if there is none
+	std::size_t node_lower_bound(const Key &x, const Compare &comp) const
+	{
+		const std::size_t n = _tree.size();
+		const Key *t = _tree.data();
+		const std::uintptr_t line = reinterpret_cast<std::uintptr_t>(t);
+		std::size_t k = 1;
+		while (k <= n) {
+			// prefetch is a hint; the address may be past the end
+			__builtin_prefetch(reinterpret_cast<const void *>(
+				line + (k * prefetch_stride - 1) * sizeof(Key)));
+			k = 2 * k + comp(t[k - 1], x);
+		}
+		// strip the right turns taken after the last left turn
+		return k >> __builtin_ffsll(static_cast<long long>(~k));
+	}
+
+	/// node k's descendants log2(stride) levels down start at k * stride
+	/// and fill one cache line
+	static constexpr std::size_t prefetch_stride =
+		std::bit_floor(64 / sizeof(Key) > 0 ? 64 / sizeof(Key) : 1);
+
+	void fill_rank(std::size_t k, std::size_t n, std::size_t &next)
+	{
+		if (k > n)
+			return;
+		fill_rank(2 * k, n, next);
+		_rank[k] = next++;
+		fill_rank(2 * k + 1, n, next);
+	}
+
+	vector<Key, Allocator> _tree;
+	vector<std::size_t, size_alloc> _rank;
+	bool _built = false;
+};
+
+//===----------------------------------------------------------------------===//
+/// Element shifting for the sorted containers, through emplace_back,
+/// pop_back and moves over data() only.  Appending and then rotating into
+/// place, and moving the tail down before popping, leave every element
+/// constructed or destroyed exactly once.
+//===----------------------------------------------------------------------===//
+template <class V, class... Args>
+void insert_at(V &v, std::size_t i, Args &&... args)
+{
+	v.emplace_back(std::forward<Args>(args)...);
+	auto *d = v.data();
+	std::rotate(d + i, d + v.size() - 1, d + v.size());
+}
+
+/// Removes [i, j).
+template <class V> void erase_at(V &v, std::size_t i, std::size_t j)
+{
+	auto *d = v.data();
+	std::move(d + j, d + v.size(), d + i);
+	for (std::size_t n = j - i; n != 0; --n)
+		v.pop_back();
+}
+} // namespace detail
+} // namespace stevemac
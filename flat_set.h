@@ -0,0 +1,306 @@
+//===-- stevemac::flat_set.h --------------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#pragma once
+#include "flat_search.h"
+#include "vector.h"
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+namespace stevemac
+{
+///===----------------------------------------------------------------------===//
+///
+/// \class stevemac::flat_set
+/// \brief Sorted set stored in one stevemac::vector of keys.
+/// Lookups are a branchless binary search over contiguous keys.  For read
+/// mostly tables build_index() adds an Eytzinger copy of the keys that
+/// lookups use until the next modification drops it.
+/// Bulk construction and range insert sort and deduplicate the new keys,
+/// then merge them in, so loading n keys is O(n log n) rather than n
+/// single inserts each shifting the tail.  On duplicate keys the first
+/// one, or the one already in the set, is kept.
+/// Iterators are pointers into the key array; anything that modifies the
+/// set invalidates them.
+///
+//===----------------------------------------------------------------------===//
+template <class Key, class Compare = std::less<Key>,
+	  class Allocator = std::allocator<Key>>
+class flat_set
+{
+      public:
+	using key_type = Key;
+	using value_type = Key;
+	using key_compare = Compare;
+	using value_compare = Compare;
+	using allocator_type = Allocator;
+	using container_type = vector<Key, Allocator>;
+	using size_type = typename container_type::size_type;
+	using difference_type = typename container_type::difference_type;
+	using reference = const Key &;
+	using const_reference = const Key &;
+	using iterator = const Key *;
+	using const_iterator = const Key *;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+	flat_set() : _comp() {}
+	explicit flat_set(const Compare &comp) : _comp(comp) {}
+	/// Sorts and deduplicates keys.
+	explicit flat_set(container_type keys, const Compare &comp = Compare())
+	    : _keys(std::move(keys)), _comp(comp)
+	{
+		sort_unique(0);
+	}
+	/// keys must already be sorted and unique.
+	flat_set(sorted_unique_t, container_type keys,
+		 const Compare &comp = Compare())
+	    : _keys(std::move(keys)), _comp(comp)
+	{
+	}
+	template <class InputIterator>
+	flat_set(InputIterator first, InputIterator last,
+		 const Compare &comp = Compare())
+	    : _comp(comp)
+	{
+		insert(first, last);
+	}
+	flat_set(std::initializer_list<Key> il, const Compare &comp = Compare())
+	    : flat_set(il.begin(), il.end(), comp)
+	{
+	}
+
+	// iterators
+	const_iterator begin() const noexcept
+	{
+		return _keys.data();
+	}
+	const_iterator end() const noexcept
+	{
+		return _keys.data() + _keys.size();
+	}
+	const_iterator cbegin() const noexcept
+	{
+		return begin();
+	}
+	const_iterator cend() const noexcept
+	{
+		return end();
+	}
+	const_reverse_iterator rbegin() const noexcept
+	{
+		return const_reverse_iterator(end());
+	}
+	const_reverse_iterator rend() const noexcept
+	{
+		return const_reverse_iterator(begin());
+	}
+
+	// capacity
+	bool empty() const noexcept
+	{
+		return _keys.empty();
+	}
+	size_type size() const noexcept
+	{
+		return _keys.size();
+	}
+	size_type max_size() const noexcept
+	{
+		return _keys.max_size();
+	}
+	void reserve(size_type n)
+	{
+		_keys.reserve(n);
+	}
+	void shrink_to_fit()
+	{
+		_keys.shrink_to_fit();
+	}
+
+	// modifiers
+	std::pair<iterator, bool> insert(const Key &k)
+	{
+		return emplace_key(k);
+	}
+	std::pair<iterator, bool> insert(Key &&k)
+	{
+		return emplace_key(std::move(k));
+	}
+	template <class... Args> std::pair<iterator, bool> emplace(Args &&... args)
+	{
+		return emplace_key(Key(std::forward<Args>(args)...));
+	}
+
+	/// Appends [first, last), sorts and deduplicates it, and merges it
+	/// into the existing keys in one pass.
+	template <class InputIterator>
+	void insert(InputIterator first, InputIterator last)
+	{
+		const size_type old = _keys.size();
+		for (; first != last; ++first)
+			_keys.push_back(*first);
+		sort_unique(old);
+	}
+	void insert(std::initializer_list<Key> il)
+	{
+		insert(il.begin(), il.end());
+	}
+
+	iterator erase(const_iterator position)
+	{
+		const size_type i = size_type(position - begin());
+		detail::erase_at(_keys, i, i + 1);
+		_index.clear();
+		return begin() + i;
+	}
+	iterator erase(const_iterator first, const_iterator last)
+	{
+		const size_type i = size_type(first - begin());
+		detail::erase_at(_keys, i, size_type(last - begin()));
+		_index.clear();
+		return begin() + i;
+	}
+	size_type erase(const Key &k)
+	{
+		const_iterator it = find(k);
+		if (it == end())
+			return 0;
+		erase(it);
+		return 1;
+	}
+	void clear() noexcept
+	{
+		_keys.clear();
+		_index.clear();
+	}
+	void swap(flat_set &other) noexcept
+	{
+		_keys.swap(other._keys);
+		std::swap(_comp, other._comp);
+		std::swap(_index, other._index);
+	}
+
+	/// Moves the key array out, leaving the set empty.
+	container_type extract() &&
+	{
+		_index.clear();
+		return std::move(_keys);
+	}
+	const container_type &keys() const noexcept
+	{
+		return _keys;
+	}
+
+	// lookup
+	const_iterator find(const Key &k) const
+	{
+		const size_type i = lower_bound_index(k);
+		return i != _keys.size() && !_comp(k, _keys[i]) ? begin() + i
+								 : end();
+	}
+	bool contains(const Key &k) const
+	{
+		if (_index.built())
+			return _index.contains(k, _comp);
+		return find(k) != end();
+	}
+	size_type count(const Key &k) const
+	{
+		return contains(k) ? 1 : 0;
+	}
+	const_iterator lower_bound(const Key &k) const
+	{
+		return begin() + lower_bound_index(k);
+	}
+	const_iterator upper_bound(const Key &k) const
+	{
+		const_iterator it = lower_bound(k);
+		return it != end() && !_comp(k, *it) ? it + 1 : it;
+	}
+	std::pair<const_iterator, const_iterator>
+	equal_range(const Key &k) const
+	{
+		return {lower_bound(k), upper_bound(k)};
+	}
+
+	/// Builds the Eytzinger search index for a read mostly set.  Costs a
+	/// second copy of the keys plus a size_t per key; any modification
+	/// drops it.  contains() and count() answer from the tree alone;
+	/// find() and the bounds take one more load to map the tree node back
+	/// to its position, which makes them a wash against the plain search.
+	void build_index()
+	{
+		_index.build(_keys.data(), _keys.size());
+	}
+	bool indexed() const noexcept
+	{
+		return _index.built();
+	}
+
+	key_compare key_comp() const
+	{
+		return _comp;
+	}
+	value_compare value_comp() const
+	{
+		return _comp;
+	}
+
+	friend bool operator==(const flat_set &x, const flat_set &y)
+	{
+		return std::equal(x.begin(), x.end(), y.begin(), y.end());
+	}
+	friend bool operator!=(const flat_set &x, const flat_set &y)
+	{
+		return !(x == y);
+	}
+
+      private:
+	size_type lower_bound_index(const Key &k) const
+	{
+		if (_index.built())
+			return _index.lower_bound(k, _comp);
+		return detail::branchless_lower_bound(_keys.data(),
+						      _keys.size(), k, _comp);
+	}
+
+	template <class K> std::pair<iterator, bool> emplace_key(K &&k)
+	{
+		const size_type i = lower_bound_index(k);
+		if (i != _keys.size() && !_comp(k, _keys[i]))
+			return {begin() + i, false};
+		detail::insert_at(_keys, i, std::forward<K>(k));
+		_index.clear();
+		return {begin() + i, true};
+	}
+
+	/// [0, sorted) is sorted and unique; sorts the rest, merges it in and
+	/// drops the later of every run of equal keys.
+	void sort_unique(size_type sorted)
+	{
+		Key *d = _keys.data();
+		const size_type n = _keys.size();
+		std::stable_sort(d + sorted, d + n, _comp);
+		std::inplace_merge(d, d + sorted, d + n, _comp);
+		Key *last = std::unique(d, d + n, [this](const Key &a,
+							 const Key &b) {
+			return !_comp(a, b);
+		});
+		detail::erase_at(_keys, size_type(last - d), n);
+		_index.clear();
+	}
+
+	container_type _keys;
+	Compare _comp;
+	detail::eytzinger_index<Key, Compare, Allocator> _index;
+};
+} // namespace stevemac
@@ -0,0 +1,251 @@
+//===-- stevemac::gather.h ----------------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#pragma once
+#include "simd.h"
+#include "vector.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+namespace stevemac
+{
+///===----------------------------------------------------------------------===//
+///
+/// stevemac batch gather / scatter
+/// gather:  out[i] = src[indices[i]]
+/// scatter: dst[indices[i]] = src[i]
+/// With random indices over a table bigger than the cache, the naive loop
+/// waits on one miss at a time.  These issue a prefetch for the element
+/// prefetch_distance positions ahead, so that many misses are in flight at
+/// once.  For trivially copyable 4 and 8 byte T with 32 or 64 bit indices
+/// gather also uses the AVX2 gather instructions when the CPU has them;
+/// AVX2 has no scatter, so scatter is always scalar with write prefetches.
+/// sort_batches reorders each batch of indices before touching src/dst,
+/// which turns clustered indices into near sequential access at the cost of
+/// a sort; results are the same as the unsorted loop, including which write
+/// wins when scatter sees an index twice (the last one).
+/// Requires: every index < the size of the vector it indexes.
+//===----------------------------------------------------------------------===//
+struct gather_options {
+	/// how many elements ahead to prefetch; 0 disables prefetching
+	std::size_t prefetch_distance = 16;
+	/// sort each batch of indices first
+	bool sort_batches = false;
+	/// indices per sorted batch
+	std::size_t batch = 4096;
+};
+
+namespace detail
+{
+template <typename T, typename I>
+constexpr bool simd_gatherable_v =
+	std::is_trivially_copyable_v<T> && (sizeof(T) == 4 || sizeof(T) == 8)
+	&& std::is_integral_v<I> && (sizeof(I) == 4 || sizeof(I) == 8);
+
+//===----------------------------------------------------------------------===//
+/// scalar kernels; the loop is split so the prefetch needs no bounds check
+//===----------------------------------------------------------------------===//
+template <typename T, typename I>
+void gather_scalar(const T *src, const I *idx, std::size_t n, T *out,
+		   std::size_t distance)
+{
+	std::size_t i = 0;
+	if (distance != 0 && n > distance)
+		for (; i < n - distance; ++i) {
+			__builtin_prefetch(src + idx[i + distance]);
+			out[i] = src[idx[i]];
+		}
+	for (; i < n; ++i)
+		out[i] = src[idx[i]];
+}
+
+template <typename T, typename I>
+void scatter_scalar(T *dst, const I *idx, std::size_t n, const T *src,
+		    std::size_t distance)
+{
+	std::size_t i = 0;
+	if (distance != 0 && n > distance)
+		for (; i < n - distance; ++i) {
+			__builtin_prefetch(dst + idx[i + distance], 1);
+			dst[idx[i]] = src[i];
+		}
+	for (; i < n; ++i)
+		dst[idx[i]] = src[i];
+}
+
+#if STEVEMAC_SIMD_X86
+//===----------------------------------------------------------------------===//
+/// AVX2 gather, one register of results per step: 8 lanes for 4 byte T
+/// with 4 byte indices, 4 lanes otherwise.  The hardware treats indices as
+/// signed, so 4 byte indices are only sent here when src.size() fits in
+/// int32_t.
+//===----------------------------------------------------------------------===//
+template <typename T, typename I>
+STEVEMAC_TARGET("avx2")
+void gather_avx2(const T *src, const I *idx, std::size_t n, T *out,
+		 std::size_t distance)
+{
+	constexpr std::size_t lanes = sizeof(T) == 4 && sizeof(I) == 4 ? 8 : 4;
+	const std::size_t prefetch_end = n > distance ? n - distance : 0;
+
+	std::size_t i = 0;
+	for (; i + lanes <= n; i += lanes) {
+		if (distance != 0 && i + lanes <= prefetch_end)
+			for (std::size_t j = 0; j < lanes; ++j)
+				__builtin_prefetch(src + idx[i + distance + j]);
+
+		if constexpr (sizeof(T) == 4 && sizeof(I) == 4) {
+			const __m256i vi = _mm256_loadu_si256(
+				reinterpret_cast<const __m256i *>(idx + i));
+			const __m256i v = _mm256_i32gather_epi32(
+				reinterpret_cast<const int *>(src), vi, 4);
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i),
+					    v);
+		} else if constexpr (sizeof(T) == 4) {
+			const __m256i vi = _mm256_loadu_si256(
+				reinterpret_cast<const __m256i *>(idx + i));
+			const __m128i v = _mm256_i64gather_epi32(
+				reinterpret_cast<const int *>(src), vi, 4);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), v);
+		} else if constexpr (sizeof(I) == 4) {
+			const __m128i vi = _mm_loadu_si128(
+				reinterpret_cast<const __m128i *>(idx + i));
+			const __m256i v = _mm256_i32gather_epi64(
+				reinterpret_cast<const long long *>(src), vi, 8);
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i),
+					    v);
+		} else {
+			const __m256i vi = _mm256_loadu_si256(
+				reinterpret_cast<const __m256i *>(idx + i));
+			const __m256i v = _mm256_i64gather_epi64(
+				reinterpret_cast<const long long *>(src), vi, 8);
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i),
+					    v);
+		}
+	}
+	for (; i < n; ++i)
+		out[i] = src[idx[i]];
+}
+#endif // STEVEMAC_SIMD_X86
+
+//===----------------------------------------------------------------------===//
+/// dispatch
+//===----------------------------------------------------------------------===//
+template <typename T, typename I>
+void gather_range(const T *src, std::size_t src_size, const I *idx,
+		  std::size_t n, T *out, std::size_t distance)
+{
+#if STEVEMAC_SIMD_X86
+	if constexpr (simd_gatherable_v<T, I>) {
+		const bool fits = sizeof(I) == 8
+				  || src_size <= std::size_t(
+					     std::numeric_limits<std::int32_t>::max());
+		if (fits && simd_dispatch_level() == simd_level::avx2)
+			return gather_avx2(src, idx, n, out, distance);
+	}
+#endif
+	(void)src_size;
+	gather_scalar(src, idx, n, out, distance);
+}
+
+/// Runs the batch through (index, position) pairs sorted by index, stable
+/// so repeated indices keep their order.
+template <typename I, class F>
+void sorted_batches(const I *idx, std::size_t n, std::size_t batch,
+		    std::size_t distance, F f)
+{
+	if (batch == 0)
+		batch = n;
+	vector<std::pair<I, std::size_t>> order;
+	order.reserve(std::min(batch, n));
+	for (std::size_t b = 0; b < n; b += batch) {
+		const std::size_t e = std::min(n, b + batch);
+		order.clear();
+		for (std::size_t i = b; i < e; ++i)
+			order.push_back({idx[i], i});
+		std::stable_sort(order.data(), order.data() + order.size(),
+				 [](const auto &x, const auto &y) {
+					 return x.first < y.first;
+				 });
+		const std::size_t m = order.size();
+		for (std::size_t j = 0; j < m; ++j)
+			f(order[j].first, order[j].second,
+			  distance != 0 && j + distance < m
+				  ? &order[j + distance].first
+				  : nullptr);
+	}
+}
+} // namespace detail
+
+//===----------------------------------------------------------------------===//
+/// public interface
+//===----------------------------------------------------------------------===//
+/// out[i] = src[indices[i]] for every i; out is resized to indices.size().
+template <typename T, class Allocator, typename I, class IndexAllocator,
+	  class OutAllocator>
+void gather(const vector<T, Allocator> &src,
+	    const vector<I, IndexAllocator> &indices,
+	    vector<T, OutAllocator> &out, const gather_options &opts = {})
+{
+	static_assert(std::is_integral_v<I>, "indices must be integers");
+	const std::size_t n = indices.size();
+	out.resize_for_overwrite(n);
+	if (n == 0)
+		return;
+
+	const T *s = src.data();
+	T *o = out.data();
+	if (!opts.sort_batches) {
+		detail::gather_range(s, src.size(), indices.data(), n, o,
+				     opts.prefetch_distance);
+		return;
+	}
+	detail::sorted_batches(indices.data(), n, opts.batch,
+			       opts.prefetch_distance,
+			       [&](I index, std::size_t pos, const I *ahead) {
+				       if (ahead)
+					       __builtin_prefetch(s + *ahead);
+				       o[pos] = s[index];
+			       });
+}
+
+/// dst[indices[i]] = src[i] for every i; where an index repeats the
+/// last write wins.
+/// Requires: src.size() == indices.size().
+template <typename T, class Allocator, typename I, class IndexAllocator,
+	  class SrcAllocator>
+void scatter(vector<T, Allocator> &dst,
+	     const vector<I, IndexAllocator> &indices,
+	     const vector<T, SrcAllocator> &src,
+	     const gather_options &opts = {})
+{
+	static_assert(std::is_integral_v<I>, "indices must be integers");
+	assert(src.size() == indices.size());
+	const std::size_t n = indices.size();
+	if (n == 0)
+		return;
+
+	T *d = dst.data();
+	const T *s = src.data();
+	if (!opts.sort_batches) {
+		detail::scatter_scalar(d, indices.data(), n, s,
+				       opts.prefetch_distance);
+		return;
+	}
+	detail::sorted_batches(indices.data(), n, opts.batch,
+			       opts.prefetch_distance,
+			       [&](I index, std::size_t pos, const I *ahead) {
+				       if (ahead)
+					       __builtin_prefetch(d + *ahead, 1);
+				       d[index] = s[pos];
+			       });
+}
+} // namespace stevemac
@@ -0,0 +1,59 @@
+//===-- stevemac::io.h --------------------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#pragma once
+#include "vector.h"
+#include <cerrno>
+#include <cstddef>
+#include <type_traits>
+#include <sys/types.h>
+#include <unistd.h>
+
+namespace stevemac
+{
+///===----------------------------------------------------------------------===//
+///
+/// read_into
+/// Appends up to max bytes from fd to v, reading straight into the vector's
+/// spare capacity; no temporary buffer, no zero fill.  Capacity grows with
+/// the vector's growth policy, at least read_chunk bytes at a time.
+/// Reading stops at max, at end of file, or after a short read, so a
+/// socket with nothing more queued does not block a second time.
+/// Returns the number of bytes appended, or -1 with errno set if the
+/// first read failed.  EINTR is retried.  On a later error the bytes
+/// already appended are kept and counted.
+//===----------------------------------------------------------------------===//
+constexpr std::size_t read_chunk = 64 * 1024;
+
+template <typename T, class Allocator>
+::ssize_t read_into(int fd, vector<T, Allocator> &v, std::size_t max)
+{
+	static_assert(sizeof(T) == 1 && std::is_trivially_copyable_v<T>,
+		      "read_into needs a byte vector");
+
+	std::size_t total = 0;
+	while (total < max) {
+		const std::size_t want =
+			max - total < read_chunk ? max - total : read_chunk;
+		auto spare = v.spare_capacity(want);
+		const std::size_t ask =
+			spare.size() < max - total ? spare.size() : max - total;
+
+		::ssize_t got = ::read(fd, spare.data(), ask);
+		if (got < 0) {
+			if (errno == EINTR)
+				continue;
+			return total == 0 ? -1 : ::ssize_t(total);
+		}
+
+		v.commit(std::size_t(got));
+		total += std::size_t(got);
+		if (std::size_t(got) < ask)
+			break;
+	}
+	return ::ssize_t(total);
+}
+} // namespace stevemac
@@ -26,7 +26,9 @@ public:
   using value_type = typename Container::value_type;
   using pointer = typename Container::pointer;
   using reference = typename Container::reference;
-  using difference_type = typename Container::size_type;
+  using difference_type = typename Container::difference_type;
+  /// elements are contiguous, so std::ranges algorithms may use data()
+  using iterator_concept = std::contiguous_iterator_tag;
 
 protected:
   /// pointee is owned by the Container
@@ -51,8 +53,9 @@ public:
   ///
   //===----------------------------------------------------------------------===//
 
-  reference operator*() { return *pointee; }
-  pointer operator->() { return pointee; }
+  reference operator*() const { return *pointee; }
+  pointer operator->() const { return pointee; }
+  reference operator[](difference_type n) const { return pointee[n]; }
 
   vector_iterator &operator++() {
     ++pointee;
@@ -75,15 +78,19 @@ public:
     return tmp;
   }
   
-  difference_type operator-(vector_iterator &other) {
+  difference_type operator-(const vector_iterator &other) const {
     return pointee - other.pointee;
   }
-  vector_iterator operator+(difference_type n) {
+  vector_iterator operator+(difference_type n) const {
     return vector_iterator(pointee + n);
   }
-  vector_iterator operator-(difference_type n) {
+  vector_iterator operator-(difference_type n) const {
     return vector_iterator(pointee - n);
   }
+  friend vector_iterator operator+(difference_type n,
+                                   const vector_iterator &it) {
+    return it + n;
+  }
   vector_iterator &operator+=(difference_type n) {
     pointee += n;
     return *this;
@@ -105,19 +112,19 @@ public:
     return pointee != other.pointee;
   }
 
-  bool operator<(const vector_iterator &other) {
+  bool operator<(const vector_iterator &other) const {
     return pointee < other.pointee;
   }
 
-  bool operator>(const vector_iterator &other) {
+  bool operator>(const vector_iterator &other) const {
     return pointee > other.pointee;
   }
 
-  bool operator<=(const vector_iterator &other) {
+  bool operator<=(const vector_iterator &other) const {
     return pointee <= other.pointee;
   }
 
-  bool operator>=(const vector_iterator &other) {
+  bool operator>=(const vector_iterator &other) const {
     return pointee >= other.pointee;
   }
 };
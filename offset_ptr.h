@@ -0,0 +1,199 @@
+//===-- stevemac::offset_ptr.h ------------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#pragma once
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+
+namespace stevemac
+{
+///===----------------------------------------------------------------------===//
+///
+/// \class stevemac::offset_ptr
+/// \brief Fancy pointer that stores the distance from itself to the
+/// pointee instead of an address, so a structure of offset_ptrs that all
+/// point into the same mapping stays valid wherever that mapping lands in
+/// each process.  This is the pointer type of shm_allocator, and what lets
+/// a stevemac::vector live inside shared memory.
+/// Copying recomputes the offset for the new location.  An offset of 1
+/// means null, so an offset_ptr cannot point at the byte right after
+/// itself.
+/// Models a random access iterator and works with std::pointer_traits and
+/// std::to_address.
+///
+//===----------------------------------------------------------------------===//
+template <typename T> class offset_ptr
+{
+	struct not_a_reference;
+	using ref_type = std::conditional_t<std::is_void_v<T>, not_a_reference &,
+					    std::add_lvalue_reference_t<T>>;
+
+      public:
+	using element_type = T;
+	using value_type = std::remove_cv_t<T>;
+	using difference_type = std::ptrdiff_t;
+	using pointer = offset_ptr;
+	using reference = ref_type;
+	using iterator_category = std::random_access_iterator_tag;
+	template <typename U> using rebind = offset_ptr<U>;
+
+	offset_ptr() noexcept : _off(null_offset) {}
+	offset_ptr(std::nullptr_t) noexcept : _off(null_offset) {}
+	offset_ptr(T *p) noexcept
+	{
+		set(p);
+	}
+	offset_ptr(const offset_ptr &other) noexcept
+	{
+		set(other.get());
+	}
+	/// offset_ptr<Derived> -> offset_ptr<Base>, offset_ptr<T> -> <const T>
+	template <typename U,
+		  typename = std::enable_if_t<std::is_convertible_v<U *, T *>>>
+	offset_ptr(const offset_ptr<U> &other) noexcept
+	{
+		set(other.get());
+	}
+	/// the static_cast pointer_traits and allocator_traits rely on,
+	/// offset_ptr<void> -> offset_ptr<T>
+	template <typename U,
+		  typename = std::enable_if_t<!std::is_convertible_v<U *, T *>
+					      && std::is_void_v<U>>,
+		  typename = void>
+	explicit offset_ptr(const offset_ptr<U> &other) noexcept
+	{
+		set(static_cast<T *>(other.get()));
+	}
+
+	offset_ptr &operator=(const offset_ptr &other) noexcept
+	{
+		set(other.get());
+		return *this;
+	}
+	offset_ptr &operator=(T *p) noexcept
+	{
+		set(p);
+		return *this;
+	}
+	offset_ptr &operator=(std::nullptr_t) noexcept
+	{
+		_off = null_offset;
+		return *this;
+	}
+
+	T *get() const noexcept
+	{
+		return _off == null_offset
+			       ? nullptr
+			       : reinterpret_cast<T *>(
+				       reinterpret_cast<std::uintptr_t>(this)
+				       + _off);
+	}
+	T *operator->() const noexcept
+	{
+		return get();
+	}
+	reference operator*() const noexcept
+	{
+		return *get();
+	}
+	reference operator[](difference_type n) const noexcept
+	{
+		return get()[n];
+	}
+	explicit operator bool() const noexcept
+	{
+		return _off != null_offset;
+	}
+
+	static offset_ptr pointer_to(reference r) noexcept
+	{
+		return offset_ptr(std::addressof(r));
+	}
+
+	offset_ptr &operator++() noexcept
+	{
+		_off += sizeof(T);
+		return *this;
+	}
+	offset_ptr operator++(int) noexcept
+	{
+		offset_ptr tmp = *this;
+		_off += sizeof(T);
+		return tmp;
+	}
+	offset_ptr &operator--() noexcept
+	{
+		_off -= sizeof(T);
+		return *this;
+	}
+	offset_ptr operator--(int) noexcept
+	{
+		offset_ptr tmp = *this;
+		_off -= sizeof(T);
+		return tmp;
+	}
+	offset_ptr &operator+=(difference_type n) noexcept
+	{
+		_off += n * difference_type(sizeof(T));
+		return *this;
+	}
+	offset_ptr &operator-=(difference_type n) noexcept
+	{
+		_off -= n * difference_type(sizeof(T));
+		return *this;
+	}
+	friend offset_ptr operator+(offset_ptr p, difference_type n) noexcept
+	{
+		return p += n;
+	}
+	friend offset_ptr operator+(difference_type n, offset_ptr p) noexcept
+	{
+		return p += n;
+	}
+	friend offset_ptr operator-(offset_ptr p, difference_type n) noexcept
+	{
+		return p -= n;
+	}
+	friend difference_type operator-(const offset_ptr &x,
+					 const offset_ptr &y) noexcept
+	{
+		return x.get() - y.get();
+	}
+
+	friend bool operator==(const offset_ptr &x, const offset_ptr &y) noexcept
+	{
+		return x.get() == y.get();
+	}
+	friend bool operator==(const offset_ptr &x, std::nullptr_t) noexcept
+	{
+		return !x;
+	}
+	friend std::strong_ordering operator<=>(const offset_ptr &x,
+						const offset_ptr &y) noexcept
+	{
+		return std::compare_three_way()(x.get(), y.get());
+	}
+
+      private:
+	static constexpr std::ptrdiff_t null_offset = 1;
+
+	void set(T *p) noexcept
+	{
+		_off = p == nullptr
+			       ? null_offset
+			       : std::ptrdiff_t(reinterpret_cast<std::uintptr_t>(p)
+						- reinterpret_cast<std::uintptr_t>(
+							this));
+	}
+
+	std::ptrdiff_t _off;
+};
+} // namespace stevemac
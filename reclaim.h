@@ -0,0 +1,78 @@
+//===-- stevemac::reclaim.h ---------------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace stevemac
+{
+///===----------------------------------------------------------------------===//
+///
+/// Capacity reclamation for long running services.
+/// A vector opts in with vector::set_reclaim_policy().  From then on every
+/// clear() and pop_back() checks the load factor; once size() has stayed
+/// below capacity() / low_water_divisor for `patience` calls in a row the
+/// buffer is shrunk to size() * headroom: the elements are moved (copied if
+/// their move may throw) into the smaller buffer and the originals
+/// destroyed.  The streak is the hysteresis: a vector that dips briefly and
+/// refills is left alone.  low_water_divisor and headroom must be nonzero.
+///
+/// trim_all() is the memory pressure hook.  vector is not thread safe, so
+/// it cannot be shrunk from under its owner; instead trim_all() bumps a
+/// process wide epoch and every opted in vector trims on its next
+/// clear()/pop_back(), regardless of its streak.
+//===----------------------------------------------------------------------===//
+struct reclaim_policy {
+	/// shrink once size() < capacity() / low_water_divisor ...
+	std::size_t low_water_divisor = 4;
+	/// ... for this many consecutive clear()/pop_back() calls ...
+	std::size_t patience = 8;
+	/// ... down to size() * headroom elements ...
+	std::size_t headroom = 2;
+	/// ... but only if that frees at least this many bytes.
+	std::size_t min_bytes = 4096;
+};
+
+/// Process wide counters, updated with relaxed atomics.
+struct reclaim_stats {
+	std::atomic<std::uint64_t> bytes_reclaimed{0};
+	std::atomic<std::uint64_t> shrinks{0};
+	std::atomic<std::uint64_t> trim_requests{0};
+};
+
+inline reclaim_stats &reclaim_metrics() noexcept
+{
+	static reclaim_stats stats;
+	return stats;
+}
+
+namespace detail
+{
+inline std::atomic<std::uint64_t> &reclaim_epoch() noexcept
+{
+	static std::atomic<std::uint64_t> epoch{0};
+	return epoch;
+}
+
+/// Per vector state, only allocated for vectors that opted in.
+struct reclaim_state {
+	reclaim_policy policy;
+	std::size_t streak = 0;
+	std::uint64_t epoch = reclaim_epoch().load(std::memory_order_relaxed);
+};
+} // namespace detail
+
+/// Asks every vector with a reclaim policy to trim at its next
+/// clear()/pop_back().
+inline void trim_all() noexcept
+{
+	detail::reclaim_epoch().fetch_add(1, std::memory_order_relaxed);
+	reclaim_metrics().trim_requests.fetch_add(1,
+						  std::memory_order_relaxed);
+}
+} // namespace stevemac
@@ -0,0 +1,476 @@
+//===-- stevemac::shm_allocator.h ---------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#pragma once
+#include "offset_ptr.h"
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace stevemac
+{
+///===----------------------------------------------------------------------===//
+///
+/// Shared memory segments for stevemac containers.
+/// shm_segment maps a POSIX shared memory object (shm_open + mmap) and
+/// runs a small first-fit heap inside it: free blocks are kept in an
+/// address ordered list and coalesced on free, the list lock is a spin
+/// lock on a lock-free atomic, so it works between processes.  Everything
+/// inside the segment refers to everything else through offsets, never
+/// addresses, so each process may map it anywhere.
+///
+/// shm_allocator<T> hands out offset_ptr<T> into a segment.  A
+/// stevemac::vector<T, shm_allocator<T>> constructed in the segment with
+/// shm_segment::construct keeps its header, its allocator and its buffer
+/// there; another process opens the segment and finds it by name:
+///
+///   auto seg = shm_segment::create("/tables", 1 << 20);
+///   using shm_ints = vector<int, shm_allocator<int>>;
+///   auto *v = seg.construct<shm_ints>("ids", seg.get_allocator<int>());
+///   ...
+///   auto other = shm_segment::open("/tables");	// another process
+///   shm_ints *w = other.find<shm_ints>("ids");
+///
+/// Concurrent modification needs the caller's own synchronization, as for
+/// any vector.  Elements must be self contained too: a vector of
+/// std::string would leave process local pointers in the segment.  Do not
+/// set a reclaim policy on a vector in shared memory or build it from a
+/// capacity_hint_site; both live in process local memory.
+//===----------------------------------------------------------------------===//
+template <class T> class shm_allocator;
+
+namespace detail
+{
+/// Lives at offset 0 of every segment.
+struct shm_header {
+	static constexpr std::uint64_t magic_value = 0x73746576656d6163ull;
+	static constexpr std::size_t max_roots = 32;
+	static constexpr std::size_t max_name = 47;
+	static constexpr std::size_t grain = 16;
+
+	struct root {
+		char name[max_name + 1];
+		offset_ptr<void> p;
+	};
+	/// allocated blocks keep size, free blocks also next (an offset from
+	/// the header, 0 ends the list)
+	struct block {
+		std::size_t size;
+		std::size_t next;
+	};
+
+	std::uint64_t magic;
+	std::size_t size;
+	std::atomic<std::uint32_t> lock;
+	std::size_t free_head;
+	std::size_t free_bytes;
+	root roots[max_roots];
+
+	static_assert(std::atomic<std::uint32_t>::is_always_lock_free,
+		      "the segment lock must be address free");
+
+	void init(std::size_t bytes) noexcept
+	{
+		size = bytes;
+		lock.store(0, std::memory_order_relaxed);
+		for (root &r : roots) {
+			r.name[0] = '\0';
+			::new (static_cast<void *>(&r.p)) offset_ptr<void>();
+		}
+		const std::size_t first = round_up(sizeof(shm_header));
+		free_head = first;
+		free_bytes = bytes - first;
+		at(first)->size = free_bytes;
+		at(first)->next = 0;
+		std::atomic_thread_fence(std::memory_order_release);
+		magic = magic_value;
+	}
+
+	void *allocate(std::size_t bytes)
+	{
+		if (bytes > size)
+			throw std::bad_alloc();
+		std::size_t need = round_up(bytes + sizeof(std::size_t) * 2);
+		if (need < sizeof(block) * 2)
+			need = sizeof(block) * 2;
+
+		guard g(lock);
+		std::size_t *link = &free_head;
+		for (std::size_t off = free_head; off != 0;
+		     link = &at(off)->next, off = at(off)->next) {
+			block *b = at(off);
+			if (b->size < need)
+				continue;
+			if (b->size - need >= sizeof(block) * 2) {
+				// split, the tail stays free
+				block *rest = at(off + need);
+				rest->size = b->size - need;
+				rest->next = b->next;
+				*link = off + need;
+				b->size = need;
+			} else {
+				*link = b->next;
+			}
+			free_bytes -= b->size;
+			return reinterpret_cast<char *>(b) + grain;
+		}
+		throw std::bad_alloc();
+	}
+
+	void deallocate(void *p) noexcept
+	{
+		if (p == nullptr)
+			return;
+		const std::size_t off =
+			std::size_t(static_cast<char *>(p) - base()) - grain;
+
+		guard g(lock);
+		block *b = at(off);
+		free_bytes += b->size;
+
+		std::size_t prev = 0;
+		std::size_t next = free_head;
+		while (next != 0 && next < off) {
+			prev = next;
+			next = at(next)->next;
+		}
+		b->next = next;
+		if (next != 0 && off + b->size == next) {
+			b->size += at(next)->size;
+			b->next = at(next)->next;
+		}
+		if (prev == 0) {
+			free_head = off;
+		} else if (prev + at(prev)->size == off) {
+			at(prev)->size += b->size;
+			at(prev)->next = b->next;
+		} else {
+			at(prev)->next = off;
+		}
+	}
+
+	root *find_root(const char *name) noexcept
+	{
+		for (root &r : roots)
+			if (r.p && std::strncmp(r.name, name, max_name) == 0)
+				return &r;
+		return nullptr;
+	}
+	root *free_root() noexcept
+	{
+		for (root &r : roots)
+			if (!r.p)
+				return &r;
+		return nullptr;
+	}
+
+	struct guard {
+		explicit guard(std::atomic<std::uint32_t> &l) noexcept : _l(l)
+		{
+			while (_l.exchange(1, std::memory_order_acquire) != 0)
+				std::this_thread::yield();
+		}
+		~guard()
+		{
+			_l.store(0, std::memory_order_release);
+		}
+		std::atomic<std::uint32_t> &_l;
+	};
+
+      private:
+	static constexpr std::size_t round_up(std::size_t n) noexcept
+	{
+		return (n + grain - 1) / grain * grain;
+	}
+	char *base() noexcept
+	{
+		return reinterpret_cast<char *>(this);
+	}
+	block *at(std::size_t off) noexcept
+	{
+		return reinterpret_cast<block *>(base() + off);
+	}
+};
+} // namespace detail
+
+///===----------------------------------------------------------------------===//
+///
+/// \class stevemac::shm_segment
+/// \brief Process local handle to a mapped segment; destroying it unmaps
+/// the segment, remove() deletes the shared memory object itself.
+///
+//===----------------------------------------------------------------------===//
+class shm_segment
+{
+      public:
+	/// Creates and maps a new segment of size bytes; fails if name
+	/// exists.
+	static shm_segment create(const char *name, std::size_t size)
+	{
+		if (size < sizeof(detail::shm_header) * 2)
+			throw std::invalid_argument("shm_segment::create: size");
+		const int fd = ::shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+		if (fd < 0)
+			throw_errno("shm_open");
+		if (::ftruncate(fd, ::off_t(size)) != 0) {
+			const int err = errno;
+			::close(fd);
+			::shm_unlink(name);
+			throw std::system_error(err, std::generic_category(),
+						"ftruncate");
+		}
+		shm_segment seg(map(fd, size), size);
+		seg._h->init(size);
+		return seg;
+	}
+
+	/// Maps an existing segment.
+	static shm_segment open(const char *name)
+	{
+		const int fd = ::shm_open(name, O_RDWR, 0);
+		if (fd < 0)
+			throw_errno("shm_open");
+		struct ::stat st;
+		if (::fstat(fd, &st) != 0) {
+			const int err = errno;
+			::close(fd);
+			throw std::system_error(err, std::generic_category(),
+						"fstat");
+		}
+		shm_segment seg(map(fd, std::size_t(st.st_size)),
+				std::size_t(st.st_size));
+		if (seg._size < sizeof(detail::shm_header)
+		    || seg._h->magic != detail::shm_header::magic_value)
+			throw std::runtime_error("shm_segment::open: not a "
+						 "stevemac segment");
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return seg;
+	}
+
+	/// Deletes the shared memory object; processes that have it mapped
+	/// keep their mapping.
+	static bool remove(const char *name) noexcept
+	{
+		return ::shm_unlink(name) == 0;
+	}
+
+	shm_segment(shm_segment &&other) noexcept
+	    : _h(std::exchange(other._h, nullptr)),
+	      _size(std::exchange(other._size, 0))
+	{
+	}
+	shm_segment &operator=(shm_segment &&other) noexcept
+	{
+		if (&other != this) {
+			unmap();
+			_h = std::exchange(other._h, nullptr);
+			_size = std::exchange(other._size, 0);
+		}
+		return *this;
+	}
+	shm_segment(const shm_segment &) = delete;
+	shm_segment &operator=(const shm_segment &) = delete;
+	~shm_segment()
+	{
+		unmap();
+	}
+
+	void *allocate(std::size_t bytes)
+	{
+		return _h->allocate(bytes);
+	}
+	void deallocate(void *p) noexcept
+	{
+		_h->deallocate(p);
+	}
+
+	/// Constructs a T in the segment and registers it under name.
+	template <class T, class... Args>
+	T *construct(const char *name, Args &&... args)
+	{
+		static_assert(alignof(T) <= detail::shm_header::grain,
+			      "over-aligned type");
+		if (std::strlen(name) > detail::shm_header::max_name)
+			throw std::length_error("shm_segment::construct: name");
+
+		void *raw = _h->allocate(sizeof(T));
+		T *obj;
+		try {
+			obj = ::new (raw) T(std::forward<Args>(args)...);
+		} catch (...) {
+			_h->deallocate(raw);
+			throw;
+		}
+
+		bool registered = false;
+		{
+			detail::shm_header::guard g(_h->lock);
+			detail::shm_header::root *r =
+				_h->find_root(name) ? nullptr : _h->free_root();
+			if (r != nullptr) {
+				std::strncpy(r->name, name,
+					     detail::shm_header::max_name);
+				r->p = obj;
+				registered = true;
+			}
+		}
+		if (!registered) {
+			obj->~T();
+			_h->deallocate(raw);
+			throw std::invalid_argument(
+				"shm_segment::construct: name taken or no "
+				"free root");
+		}
+		return obj;
+	}
+
+	/// The object registered under name, or nullptr.
+	template <class T> T *find(const char *name) noexcept
+	{
+		detail::shm_header::guard g(_h->lock);
+		detail::shm_header::root *r = _h->find_root(name);
+		return r ? static_cast<T *>(r->p.get()) : nullptr;
+	}
+
+	/// Destroys and frees the object registered under name.
+	template <class T> bool destroy(const char *name)
+	{
+		T *obj;
+		{
+			detail::shm_header::guard g(_h->lock);
+			detail::shm_header::root *r = _h->find_root(name);
+			if (r == nullptr)
+				return false;
+			obj = static_cast<T *>(r->p.get());
+			r->p = nullptr;
+		}
+		obj->~T();
+		_h->deallocate(obj);
+		return true;
+	}
+
+	template <class T> shm_allocator<T> get_allocator() const noexcept
+	{
+		return shm_allocator<T>(_h);
+	}
+
+	std::size_t size() const noexcept
+	{
+		return _size;
+	}
+	std::size_t free_bytes() const noexcept
+	{
+		detail::shm_header::guard g(_h->lock);
+		return _h->free_bytes;
+	}
+
+      private:
+	shm_segment(void *p, std::size_t size) noexcept
+	    : _h(static_cast<detail::shm_header *>(p)), _size(size)
+	{
+	}
+
+	static void *map(int fd, std::size_t size)
+	{
+		void *p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+				 MAP_SHARED, fd, 0);
+		const int err = errno;
+		::close(fd);
+		if (p == MAP_FAILED)
+			throw std::system_error(err, std::generic_category(),
+						"mmap");
+		return p;
+	}
+	[[noreturn]] static void throw_errno(const char *what)
+	{
+		throw std::system_error(errno, std::generic_category(), what);
+	}
+	void unmap() noexcept
+	{
+		if (_h != nullptr)
+			::munmap(_h, _size);
+		_h = nullptr;
+	}
+
+	detail::shm_header *_h = nullptr;
+	std::size_t _size = 0;
+};
+
+///===----------------------------------------------------------------------===//
+///
+/// \class stevemac::shm_allocator
+/// \brief Allocator over an shm_segment's heap.  Its pointer type is
+/// offset_ptr<T>, and it refers to its segment through an offset_ptr too,
+/// so it may itself be stored in the segment, as it is inside a vector
+/// constructed there.
+///
+//===----------------------------------------------------------------------===//
+template <class T> class shm_allocator
+{
+	static_assert(alignof(T) <= detail::shm_header::grain,
+		      "over-aligned type");
+
+      public:
+	using value_type = T;
+	using pointer = offset_ptr<T>;
+	using const_pointer = offset_ptr<const T>;
+	using void_pointer = offset_ptr<void>;
+	using const_void_pointer = offset_ptr<const void>;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+	using is_always_equal = std::false_type;
+
+	template <class U> struct rebind {
+		using other = shm_allocator<U>;
+	};
+
+	explicit shm_allocator(detail::shm_header *h) noexcept : _h(h) {}
+	shm_allocator(const shm_allocator &other) noexcept : _h(other._h) {}
+	template <class U>
+	shm_allocator(const shm_allocator<U> &other) noexcept : _h(other._h)
+	{
+	}
+	shm_allocator &operator=(const shm_allocator &other) noexcept
+	{
+		_h = other._h;
+		return *this;
+	}
+
+	pointer allocate(size_type n)
+	{
+		if (n > std::numeric_limits<size_type>::max() / sizeof(T))
+			throw std::bad_array_new_length();
+		return pointer(static_cast<T *>(_h->allocate(n * sizeof(T))));
+	}
+	void deallocate(pointer p, size_type) noexcept
+	{
+		_h->deallocate(p.get());
+	}
+
+	friend bool operator==(const shm_allocator &x,
+			       const shm_allocator &y) noexcept
+	{
+		return x._h == y._h;
+	}
+
+      private:
+	template <class> friend class shm_allocator;
+	offset_ptr<detail::shm_header> _h;
+};
+} // namespace stevemac
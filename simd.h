@@ -0,0 +1,11 @@
+//===-- stevemac::simd.h ------------------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#pragma once
+#include "simd_dispatch.h"
+#if STEVEMAC_SIMD_X86
+#include <immintrin.h>
+#endif
@@ -0,0 +1,51 @@
+//===-- stevemac::simd_dispatch.h ---------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#pragma once
+#if !defined(STEVEMAC_NO_SIMD) && defined(__GNUC__)                           \
+	&& (defined(__x86_64__) || defined(__i386__))
+#define STEVEMAC_SIMD_X86 1
+/// Per-function ISA selection, the translation unit itself does not need to
+/// be built with -mavx2.  Callers must check simd_dispatch_level() first.
+#define STEVEMAC_TARGET(isa) __attribute__((target(isa)))
+#else
+#define STEVEMAC_SIMD_X86 0
+#define STEVEMAC_TARGET(isa)
+#endif
+
+namespace stevemac
+{
+///===----------------------------------------------------------------------===//
+///
+/// Runtime SIMD dispatch
+/// The kernels in algorithm.h (and friends) are compiled for every level
+/// below and the best one the running CPU supports is picked on each call.
+/// Detection runs once; the result is cached in a function local static.
+/// Define STEVEMAC_NO_SIMD to force the scalar fallback everywhere.
+/// This header has the dispatch alone; simd.h adds the intrinsics, whose
+/// <immintrin.h> costs a few tenths of a second per file, so that only
+/// the kernel headers pay for it.
+//===----------------------------------------------------------------------===//
+enum class simd_level { scalar, sse41, avx2 };
+
+inline simd_level detect_simd_level() noexcept
+{
+#if STEVEMAC_SIMD_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return simd_level::avx2;
+	if (__builtin_cpu_supports("sse4.1"))
+		return simd_level::sse41;
+#endif
+	return simd_level::scalar;
+}
+
+inline simd_level simd_dispatch_level() noexcept
+{
+	static const simd_level level = detect_simd_level();
+	return level;
+}
+} // namespace stevemac
@@ -0,0 +1,273 @@
+//===-- stevemac::slot_map.h --------------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#pragma once
+#include "vector.h"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+namespace stevemac
+{
+/// Handle to a slot_map element.  Stays valid until that element is
+/// erased; after that it is stale and every lookup with it fails.
+struct slot_map_key {
+	std::uint32_t index = std::numeric_limits<std::uint32_t>::max();
+	std::uint32_t generation = 0;
+
+	friend bool operator==(const slot_map_key &x,
+			       const slot_map_key &y) noexcept
+	{
+		return x.index == y.index && x.generation == y.generation;
+	}
+	friend bool operator!=(const slot_map_key &x,
+			       const slot_map_key &y) noexcept
+	{
+		return !(x == y);
+	}
+};
+
+///===----------------------------------------------------------------------===//
+///
+/// \class stevemac::slot_map
+/// \brief Values packed densely in a stevemac::vector, addressed through
+/// stable generational keys.
+/// A key names a slot; the slot holds the value's current position in the
+/// dense array and a generation count.  erase moves the last value into
+/// the hole (O(1), no shifting), repoints that value's slot and bumps the
+/// erased slot's generation, so old keys to it are detected as stale.
+/// Freed slots are reused through an intrusive free list.
+/// Iteration runs over the dense array, in no particular order; it is
+/// invalidated, like vector iterators, by insert and erase.  Keys are not.
+/// A slot reused 2^32 times wraps its generation, at which point a key
+/// that old could match again.
+///
+//===----------------------------------------------------------------------===//
+template <class T, class Allocator = std::allocator<T>> class slot_map
+{
+	struct slot {
+		/// position in _values while live, next free slot while free
+		std::uint32_t index;
+		std::uint32_t generation;
+	};
+	using slot_allocator = typename std::allocator_traits<
+		Allocator>::template rebind_alloc<slot>;
+	using index_allocator = typename std::allocator_traits<
+		Allocator>::template rebind_alloc<std::uint32_t>;
+	static constexpr std::uint32_t no_slot =
+		std::numeric_limits<std::uint32_t>::max();
+
+      public:
+	using key_type = slot_map_key;
+	using value_type = T;
+	using allocator_type = Allocator;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+	using reference = T &;
+	using const_reference = const T &;
+	using iterator = T *;
+	using const_iterator = const T *;
+	using container_type = vector<T, Allocator>;
+
+	slot_map() = default;
+	explicit slot_map(const allocator_type &a)
+	    : _values(a), _slot_of(index_allocator(a)), _slots(slot_allocator(a))
+	{
+	}
+
+	// iterators, over the dense values
+	iterator begin() noexcept
+	{
+		return _values.data();
+	}
+	const_iterator begin() const noexcept
+	{
+		return _values.data();
+	}
+	iterator end() noexcept
+	{
+		return _values.data() + _values.size();
+	}
+	const_iterator end() const noexcept
+	{
+		return _values.data() + _values.size();
+	}
+	const_iterator cbegin() const noexcept
+	{
+		return begin();
+	}
+	const_iterator cend() const noexcept
+	{
+		return end();
+	}
+
+	// capacity
+	bool empty() const noexcept
+	{
+		return _values.empty();
+	}
+	size_type size() const noexcept
+	{
+		return _values.size();
+	}
+	void reserve(size_type n)
+	{
+		_values.reserve(n);
+		_slot_of.reserve(n);
+		_slots.reserve(n);
+	}
+
+	// modifiers
+	key_type insert(const T &value)
+	{
+		return emplace(value);
+	}
+	key_type insert(T &&value)
+	{
+		return emplace(std::move(value));
+	}
+	template <class... Args> key_type emplace(Args &&... args)
+	{
+		const std::uint32_t pos = std::uint32_t(_values.size());
+		if (_values.size() >= no_slot)
+			throw std::length_error("slot_map::emplace");
+
+		if (_free == no_slot) {
+			_slots.push_back(slot{no_slot, 0});
+			_free = std::uint32_t(_slots.size() - 1);
+		}
+		_values.emplace_back(std::forward<Args>(args)...);
+		try {
+			_slot_of.push_back(_free);
+		} catch (...) {
+			_values.pop_back();
+			throw;
+		}
+
+		const std::uint32_t s = _free;
+		_free = _slots[s].index;
+		_slots[s].index = pos;
+		return key_type{s, _slots[s].generation};
+	}
+
+	/// O(1): the last value moves into the hole.  Returns false for a
+	/// stale key.
+	bool erase(const key_type &key)
+	{
+		if (!contains(key))
+			return false;
+		erase_at(_slots[key.index].index);
+		return true;
+	}
+	/// Erases the value at it and returns the iterator to the value that
+	/// took its place, so erasing in a loop does not skip anything.
+	iterator erase(const_iterator it)
+	{
+		const std::uint32_t pos = std::uint32_t(it - begin());
+		erase_at(pos);
+		return begin() + pos;
+	}
+
+	/// Removes everything; every outstanding key becomes stale.
+	void clear() noexcept
+	{
+		for (std::uint32_t s : _slot_of)
+			release(s);
+		_values.clear();
+		_slot_of.clear();
+	}
+
+	// lookup
+	bool contains(const key_type &key) const noexcept
+	{
+		return key.index < _slots.size()
+		       && _slots[key.index].generation == key.generation
+		       && _slots[key.index].index < _values.size()
+		       && _slot_of[_slots[key.index].index] == key.index;
+	}
+	/// nullptr for a stale key
+	T *find(const key_type &key) noexcept
+	{
+		return contains(key) ? &_values[_slots[key.index].index]
+				     : nullptr;
+	}
+	const T *find(const key_type &key) const noexcept
+	{
+		return contains(key) ? &_values[_slots[key.index].index]
+				     : nullptr;
+	}
+	/// Requires: contains(key)
+	T &operator[](const key_type &key) noexcept
+	{
+		assert(contains(key));
+		return _values[_slots[key.index].index];
+	}
+	const T &operator[](const key_type &key) const noexcept
+	{
+		assert(contains(key));
+		return _values[_slots[key.index].index];
+	}
+	T &at(const key_type &key)
+	{
+		T *p = find(key);
+		if (p == nullptr)
+			throw std::out_of_range("slot_map::at: stale key");
+		return *p;
+	}
+	const T &at(const key_type &key) const
+	{
+		const T *p = find(key);
+		if (p == nullptr)
+			throw std::out_of_range("slot_map::at: stale key");
+		return *p;
+	}
+
+	/// The key of the value at it.
+	key_type key_of(const_iterator it) const noexcept
+	{
+		const std::uint32_t s = _slot_of[std::size_t(it - begin())];
+		return key_type{s, _slots[s].generation};
+	}
+
+	/// The dense values, e.g. for a SIMD pass.
+	const container_type &values() const noexcept
+	{
+		return _values;
+	}
+
+      private:
+	void erase_at(std::uint32_t pos)
+	{
+		const std::uint32_t s = _slot_of[pos];
+		const std::uint32_t last = std::uint32_t(_values.size() - 1);
+		if (pos != last) {
+			_values[pos] = std::move(_values[last]);
+			_slot_of[pos] = _slot_of[last];
+			_slots[_slot_of[pos]].index = pos;
+		}
+		_values.pop_back();
+		_slot_of.pop_back();
+		release(s);
+	}
+
+	void release(std::uint32_t s) noexcept
+	{
+		++_slots[s].generation;
+		_slots[s].index = _free;
+		_free = s;
+	}
+
+	container_type _values;
+	/// dense position -> slot, to repoint the slot of a moved value
+	vector<std::uint32_t, index_allocator> _slot_of;
+	vector<slot, slot_allocator> _slots;
+	std::uint32_t _free = no_slot;
+};
+} // namespace stevemac
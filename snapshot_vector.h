@@ -0,0 +1,217 @@
+//===-- stevemac::snapshot_vector.h -------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#pragma once
+#include "vector.h"
+#include <atomic>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <utility>
+
+namespace stevemac
+{
+///===----------------------------------------------------------------------===//
+///
+/// \class stevemac::snapshot_vector
+/// \brief A vector for read-mostly tables shared between threads.  Every
+/// version is an immutable, reference counted vector; readers hold a
+/// snapshot for as long as they like, and a writer builds the next version
+/// and publishes it in one step.  The old version is freed when its last
+/// reader lets go of it.
+///
+/// Readers that poll should keep a snapshot_vector::reader: it caches its
+/// snapshot and only checks an atomic version number on every get(), so
+/// reads are lock-free in the steady state: one acquire load, no shared
+/// writes.  The current version is a std::atomic<std::shared_ptr>, so there
+/// is no mutex for readers and writers to contend on.  Picking up a new
+/// version, once per publish, is a load of that atomic; libstdc++ makes it
+/// with a spin bit in the pointer held for a reference count bump, so
+/// that one step is not lock-free.
+///
+/// A writer starts from the current version and copies it on the first
+/// call to edit(); publish() fails if another version went out in the
+/// meantime, which update() retries.
+///
+//===----------------------------------------------------------------------===//
+template <class T, class Allocator = std::allocator<T>> class snapshot_vector
+{
+      public:
+	using vector_type = vector<T, Allocator>;
+	using value_type = T;
+	using allocator_type = Allocator;
+	using size_type = typename vector_type::size_type;
+	using snapshot = std::shared_ptr<const vector_type>;
+
+	snapshot_vector() : _current(std::make_shared<const vector_type>()) {}
+	explicit snapshot_vector(vector_type v)
+	    : _current(std::make_shared<const vector_type>(std::move(v)))
+	{
+	}
+	snapshot_vector(std::initializer_list<T> il)
+	    : _current(std::make_shared<const vector_type>(il))
+	{
+	}
+	snapshot_vector(const snapshot_vector &) = delete;
+	snapshot_vector &operator=(const snapshot_vector &) = delete;
+
+	/// The current version.  It never changes; a publish makes a new one.
+	/// Every call is a full atomic<shared_ptr> load, dearer than a
+	/// reader's get() (see bench_snapshot_vector); pollers keep a reader.
+	snapshot load() const
+	{
+		return _current.load(std::memory_order_acquire);
+	}
+	/// Bumped by every publish.
+	std::uint64_t version() const noexcept
+	{
+		return _version.load(std::memory_order_acquire);
+	}
+
+	/// Replaces the contents unconditionally.
+	void publish(vector_type v)
+	{
+		store(std::make_shared<const vector_type>(std::move(v)));
+	}
+
+	/// Copy-on-write edit of the current version.  Starts from load();
+	/// the first edit() copies it, view() reads whichever is current.
+	class writer
+	{
+	      public:
+		explicit writer(snapshot_vector &sv)
+		    : _sv(&sv), _base(sv.load())
+		{
+		}
+
+		const vector_type &view() const noexcept
+		{
+			return _copy ? *_copy : *_base;
+		}
+		vector_type &edit()
+		{
+			if (!_copy)
+				_copy = std::make_unique<vector_type>(*_base);
+			return *_copy;
+		}
+		bool dirty() const noexcept
+		{
+			return _copy != nullptr;
+		}
+
+		/// Publishes the edited copy if nobody published since this
+		/// writer started.  Returns false, and drops the copy, if
+		/// someone did.  Publishing an unedited writer is a no-op.
+		bool publish()
+		{
+			if (!_copy)
+				return true;
+			snapshot next(std::move(_copy));
+			if (!_sv->compare_and_store(_base, next))
+				return false;
+			_base = std::move(next);
+			return true;
+		}
+
+	      private:
+		snapshot_vector *_sv;
+		snapshot _base;
+		std::unique_ptr<vector_type> _copy;
+	};
+
+	writer write()
+	{
+		return writer(*this);
+	}
+
+	/// Applies f(vector_type &) to a copy of the current version and
+	/// publishes it, starting over if another writer got there first.
+	template <class F> void update(F f)
+	{
+		for (;;) {
+			writer w(*this);
+			f(w.edit());
+			if (w.publish())
+				return;
+		}
+	}
+
+	/// A reader's cached view of a snapshot_vector.  Not shared between
+	/// threads; each reader thread keeps its own.
+	class reader
+	{
+	      public:
+		explicit reader(const snapshot_vector &sv)
+		    : _sv(&sv), _version(sv.version()), _snap(sv.load())
+		{
+		}
+
+		/// The latest version, refreshed only when it changed.
+		const vector_type &get()
+		{
+			if (_sv->version() != _version)
+				refresh();
+			return *_snap;
+		}
+		const vector_type &operator*()
+		{
+			return get();
+		}
+		const vector_type *operator->()
+		{
+			return &get();
+		}
+		/// The snapshot get() last returned, without checking.
+		const snapshot &pinned() const noexcept
+		{
+			return _snap;
+		}
+
+	      private:
+		/// The version is read before the snapshot: a publish stores
+		/// its snapshot before bumping the version, so _snap is at
+		/// least as new as _version says, never older.
+		void refresh()
+		{
+			_version = _sv->version();
+			_snap = _sv->load();
+		}
+
+		const snapshot_vector *_sv;
+		std::uint64_t _version;
+		snapshot _snap;
+	};
+
+	reader read() const
+	{
+		return reader(*this);
+	}
+
+      private:
+	void store(snapshot next)
+	{
+		// the old version, if this was its last owner, is freed when the
+		// returned pointer goes out of scope, outside the atomic
+		snapshot old =
+			_current.exchange(std::move(next), std::memory_order_acq_rel);
+		_version.fetch_add(1, std::memory_order_release);
+	}
+
+	bool compare_and_store(const snapshot &expected, const snapshot &next)
+	{
+		snapshot seen = expected;
+		if (!_current.compare_exchange_strong(seen, next,
+						      std::memory_order_acq_rel,
+						      std::memory_order_acquire))
+			return false;
+		_version.fetch_add(1, std::memory_order_release);
+		return true;
+	}
+
+	std::atomic<snapshot> _current;
+	std::atomic<std::uint64_t> _version{0};
+};
+} // namespace stevemac
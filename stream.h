@@ -0,0 +1,272 @@
+//===-- stevemac::stream.h ----------------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#pragma once
+#include "simd_dispatch.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <unistd.h>
+
+namespace stevemac
+{
+///===----------------------------------------------------------------------===//
+///
+/// Non-temporal copy and fill
+/// An ordinary copy of a multi-GB buffer pulls every destination line into
+/// the cache (read for ownership) and leaves the last LLC-sized slice of it
+/// there, evicting everything else running on the socket.  stream_copy and
+/// stream_fill write with non-temporal stores instead (vmovntdq on AVX2,
+/// movntdq otherwise) which go around the cache to memory in whole lines,
+/// then issue an sfence so the data is visible to other threads like
+/// ordinary stores.  The source of a copy is still read through the cache.
+/// For buffers that fit in the cache this is slower than memcpy, whose
+/// result the next reader finds in cache, so vector only takes this path
+/// above stream_threshold() bytes: half the LLC when sysconf knows its
+/// size, 8 MiB otherwise.  Store a different value to tune it, 0 to always
+/// stream, SIZE_MAX to never.
+/// At simd_level::scalar (or with STEVEMAC_NO_SIMD) both fall back to
+/// memcpy and std::fill_n.
+//===----------------------------------------------------------------------===//
+inline std::size_t default_stream_threshold() noexcept
+{
+	long llc = -1;
+#ifdef _SC_LEVEL3_CACHE_SIZE
+	llc = ::sysconf(_SC_LEVEL3_CACHE_SIZE);
+#endif
+	return llc > 0 ? std::size_t(llc) / 2 : std::size_t(8) << 20;
+}
+
+inline std::atomic<std::size_t> &stream_threshold() noexcept
+{
+	static std::atomic<std::size_t> threshold{default_stream_threshold()};
+	return threshold;
+}
+
+namespace detail
+{
+/// Streaming needs T's bytes to be all there is to copy.
+template <typename T>
+constexpr bool streamable_v = std::is_trivially_copyable_v<T>;
+
+/// fill builds a register of repeated T, so sizeof(T) must divide it.
+template <typename T>
+constexpr bool stream_fillable_v =
+	streamable_v<T> && sizeof(T) <= 32 && (32 % sizeof(T)) == 0;
+
+inline bool stream_worthwhile(std::size_t bytes) noexcept
+{
+	return bytes >= stream_threshold().load(std::memory_order_relaxed);
+}
+
+#if STEVEMAC_SIMD_X86
+//===----------------------------------------------------------------------===//
+/// kernels: ordinary stores up to the first aligned destination byte,
+/// non-temporal stores of whole registers, ordinary stores for the tail.
+/// Four registers per step so each step covers whole cache lines.
+/// vector.h includes this file, so the registers are GNU vector types and
+/// the stores one instruction of inline asm each, not the _mm*_stream
+/// intrinsics: those would bring <immintrin.h> into every user of vector.
+//===----------------------------------------------------------------------===//
+typedef long long stream_reg32 __attribute__((vector_size(32), may_alias));
+typedef long long stream_reg16 __attribute__((vector_size(16), may_alias));
+
+STEVEMAC_TARGET("avx2")
+inline void stream_store(unsigned char *dst, stream_reg32 v) noexcept
+{
+	asm volatile("vmovntdq %1, %0"
+	    : "=m"(*reinterpret_cast<stream_reg32 *>(dst))
+	    : "x"(v));
+}
+STEVEMAC_TARGET("sse2")
+inline void stream_store(unsigned char *dst, stream_reg16 v) noexcept
+{
+	asm volatile("movntdq %1, %0"
+	    : "=m"(*reinterpret_cast<stream_reg16 *>(dst))
+	    : "x"(v));
+}
+/// Orders the non-temporal stores before any later store, like ordinary
+/// ones; also a compiler barrier.
+inline void stream_fence() noexcept
+{
+	asm volatile("sfence" ::: "memory");
+}
+
+/// Out through a reference, not returned: this is compiled for the base
+/// ISA, where a 32 byte vector is returned in memory, and its AVX2 callers
+/// would expect it in a register.
+template <class Reg>
+inline void stream_load(Reg &v, const unsigned char *src) noexcept
+{
+	std::memcpy(&v, src, sizeof(Reg));
+}
+
+STEVEMAC_TARGET("avx2")
+inline void stream_copy_avx2(unsigned char *dst, const unsigned char *src,
+			     std::size_t n)
+{
+	const std::size_t head =
+		std::min(n, (32 - reinterpret_cast<std::uintptr_t>(dst) % 32) % 32);
+	std::memcpy(dst, src, head);
+	dst += head;
+	src += head;
+	n -= head;
+
+	for (; n >= 128; n -= 128, dst += 128, src += 128) {
+		stream_reg32 a, b, c, e;
+		stream_load(a, src);
+		stream_load(b, src + 32);
+		stream_load(c, src + 64);
+		stream_load(e, src + 96);
+		stream_store(dst, a);
+		stream_store(dst + 32, b);
+		stream_store(dst + 64, c);
+		stream_store(dst + 96, e);
+	}
+	stream_fence();
+	std::memcpy(dst, src, n);
+}
+
+STEVEMAC_TARGET("sse2")
+inline void stream_copy_sse2(unsigned char *dst, const unsigned char *src,
+			     std::size_t n)
+{
+	const std::size_t head =
+		std::min(n, (16 - reinterpret_cast<std::uintptr_t>(dst) % 16) % 16);
+	std::memcpy(dst, src, head);
+	dst += head;
+	src += head;
+	n -= head;
+
+	for (; n >= 64; n -= 64, dst += 64, src += 64) {
+		stream_reg16 a, b, c, e;
+		stream_load(a, src);
+		stream_load(b, src + 16);
+		stream_load(c, src + 32);
+		stream_load(e, src + 48);
+		stream_store(dst, a);
+		stream_store(dst + 16, b);
+		stream_store(dst + 32, c);
+		stream_store(dst + 48, e);
+	}
+	stream_fence();
+	std::memcpy(dst, src, n);
+}
+
+/// pattern is 32 bytes of repeated T.  dst is aligned to sizeof(T), which
+/// divides 32, so every aligned register and every 32 byte step past the
+/// head starts on an element boundary and at the start of the pattern.
+STEVEMAC_TARGET("avx2")
+inline void stream_fill_avx2(unsigned char *dst, const unsigned char *pattern,
+			     std::size_t elem, std::size_t n)
+{
+	for (; n != 0 && reinterpret_cast<std::uintptr_t>(dst) % 32 != 0;
+	     n -= elem, dst += elem)
+		std::memcpy(dst, pattern, elem);
+
+	stream_reg32 v;
+	stream_load(v, pattern);
+	for (; n >= 128; n -= 128, dst += 128) {
+		stream_store(dst, v);
+		stream_store(dst + 32, v);
+		stream_store(dst + 64, v);
+		stream_store(dst + 96, v);
+	}
+	stream_fence();
+	for (std::size_t i = 0; i < n; i += 32)
+		std::memcpy(dst + i, pattern, std::min<std::size_t>(32, n - i));
+}
+
+STEVEMAC_TARGET("sse2")
+inline void stream_fill_sse2(unsigned char *dst, const unsigned char *pattern,
+			     std::size_t elem, std::size_t n)
+{
+	for (; n != 0 && reinterpret_cast<std::uintptr_t>(dst) % 16 != 0;
+	     n -= elem, dst += elem)
+		std::memcpy(dst, pattern, elem);
+
+	// two halves, a 32 byte element does not repeat every 16 bytes
+	stream_reg16 lo, hi;
+	stream_load(lo, pattern);
+	stream_load(hi, pattern + 16);
+	for (; n >= 64; n -= 64, dst += 64) {
+		stream_store(dst, lo);
+		stream_store(dst + 16, hi);
+		stream_store(dst + 32, lo);
+		stream_store(dst + 48, hi);
+	}
+	stream_fence();
+	for (std::size_t i = 0; i < n; i += 32)
+		std::memcpy(dst + i, pattern, std::min<std::size_t>(32, n - i));
+}
+#endif // STEVEMAC_SIMD_X86
+
+inline void stream_copy_bytes(void *dst, const void *src, std::size_t n)
+{
+	auto *d = static_cast<unsigned char *>(dst);
+	auto *s = static_cast<const unsigned char *>(src);
+#if STEVEMAC_SIMD_X86
+	switch (simd_dispatch_level()) {
+	case simd_level::avx2:
+		return stream_copy_avx2(d, s, n);
+	case simd_level::sse41:
+		return stream_copy_sse2(d, s, n);
+	case simd_level::scalar:
+		break;
+	}
+#endif
+	std::memcpy(d, s, n);
+}
+} // namespace detail
+
+//===----------------------------------------------------------------------===//
+/// public interface
+//===----------------------------------------------------------------------===//
+/// Copies n elements from src to dst with non-temporal stores, whatever n
+/// is.  dst must be raw storage or hold trivially destructible T.
+/// Requires: the ranges do not overlap.
+template <typename T>
+void stream_copy(const T *src, std::size_t n, T *dst) noexcept
+{
+	static_assert(detail::streamable_v<T>,
+		      "stream_copy needs trivially copyable elements");
+	if (n != 0)
+		detail::stream_copy_bytes(dst, src, n * sizeof(T));
+}
+
+/// Sets n elements at dst to value with non-temporal stores.  Element
+/// sizes that do not divide 32 bytes, and dst not aligned to sizeof(T),
+/// take the std::fill_n path.
+template <typename T>
+void stream_fill(T *dst, std::size_t n, const T &value) noexcept
+{
+	static_assert(detail::streamable_v<T>,
+		      "stream_fill needs trivially copyable elements");
+#if STEVEMAC_SIMD_X86
+	if constexpr (detail::stream_fillable_v<T>) {
+		const simd_level level = simd_dispatch_level();
+		if (level != simd_level::scalar
+		    && reinterpret_cast<std::uintptr_t>(dst) % sizeof(T) == 0) {
+			unsigned char pattern[32];
+			for (std::size_t i = 0; i < 32; i += sizeof(T))
+				std::memcpy(pattern + i, &value, sizeof(T));
+			auto *d = reinterpret_cast<unsigned char *>(dst);
+			if (level == simd_level::avx2)
+				detail::stream_fill_avx2(d, pattern, sizeof(T),
+							 n * sizeof(T));
+			else
+				detail::stream_fill_sse2(d, pattern, sizeof(T),
+							 n * sizeof(T));
+			return;
+		}
+	}
+#endif
+	std::fill_n(dst, n, value);
+}
+} // namespace stevemac
@@ -0,0 +1,57 @@
+//===-- stevemac::test_algorithm.cpp ------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#undef NDEBUG
+#include "algorithm.h"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+using namespace stevemac;
+
+/// Every kernel the CPU has agrees with the scalar reference, for lengths
+/// around the vector width and past the 255 step count flush.
+template <typename T> static void kernels_match_scalar()
+{
+	for (std::size_t n : {0, 1, 15, 16, 17, 33, 255 * 16, 255 * 16 + 5,
+			      70000}) {
+		for (int mod : {1, 2, 7, 1000}) {
+			vector<T> v;
+			for (std::size_t i = 0; i < n; ++i)
+				v.push_back(T(i % mod));
+			const T *p = v.data();
+			for (const T x : {T(0), T(1), T(99)}) {
+				const std::size_t f = detail::find_scalar(p, n, x);
+				const std::size_t c = detail::count_scalar(p, n, x);
+#if STEVEMAC_SIMD_X86
+				if (simd_dispatch_level() != simd_level::scalar) {
+					assert(detail::find_sse41<false>(p, n, x) == f);
+					assert(detail::count_sse41<false>(p, n, x) == c);
+				}
+				if (simd_dispatch_level() == simd_level::avx2) {
+					assert(detail::find_avx2<false>(p, n, x) == f);
+					assert(detail::count_avx2<false>(p, n, x) == c);
+				}
+#endif
+				assert(std::size_t(find(v, x) - v.begin()) == f);
+				assert(count(v, x) == c);
+				assert(contains(v, x) == (f < n));
+			}
+			if (n != 0)
+				assert(minmax(v) == detail::minmax_scalar(p, n));
+		}
+	}
+}
+
+int main()
+{
+	kernels_match_scalar<std::uint8_t>();
+	kernels_match_scalar<std::int8_t>();
+	kernels_match_scalar<std::int32_t>();
+	kernels_match_scalar<std::uint32_t>();
+	kernels_match_scalar<float>();
+	return 0;
+}
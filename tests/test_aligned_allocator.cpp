@@ -0,0 +1,93 @@
+//===-- stevemac::test_aligned_allocator.cpp ----------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#undef NDEBUG
+#include "aligned_allocator.h"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+using namespace stevemac;
+
+static bool aligned(const void *p, std::size_t n)
+{
+	return reinterpret_cast<std::uintptr_t>(p) % n == 0;
+}
+
+// Leaving construct to allocator_traits keeps the byte copy and stream
+// paths open for trivially copyable T.
+static_assert(!detail::customizes_construct<aligned_allocator<float, 32>,
+					    float>::value);
+static_assert(!detail::customizes_construct<aligned_allocator<float, 64, true>,
+					    float>::value);
+
+static_assert(is_aligned_v<aligned_vector<float>>);
+static_assert(is_aligned_v<aligned_vector<float>, 64>);
+static_assert(!is_aligned_v<aligned_vector<float>, 128>);
+static_assert(is_aligned_v<vector<float, aligned_allocator<float, 32>>>);
+static_assert(!is_aligned_v<vector<float, aligned_allocator<float, 32>>, 64>);
+static_assert(!is_aligned_v<vector<float>>);
+static_assert(is_aligned_v<vector<float>, alignof(float)>);
+static_assert(allocator_alignment_v<std::allocator<double>> == alignof(double));
+
+/// data() stays on the boundary through growth, shrinking, copies and
+/// moves, whatever the element type.
+template <class T, std::size_t A> static void keeps_alignment(T value)
+{
+	vector<T, aligned_allocator<T, A>> v;
+	for (int i = 0; i < 1000; ++i) {
+		v.push_back(value);
+		assert(aligned(v.data(), A));
+	}
+	v.resize(3);
+	v.shrink_to_fit();
+	assert(v.capacity() == 3 && aligned(v.data(), A));
+
+	auto copy = v;
+	assert(aligned(copy.data(), A) && copy == v);
+	auto moved = std::move(copy);
+	assert(aligned(moved.data(), A) && moved == v);
+	v = moved;
+	assert(aligned(v.data(), A));
+	v.reserve(5000);
+	assert(aligned(v.data(), A) && v.size() == 3 && v[2] == value);
+}
+
+/// With PadCapacity every capacity is a whole number of Alignment byte
+/// blocks, so a SIMD loop may run to capacity().
+static void pads_capacity()
+{
+	aligned_vector<float> v; // 64 bytes: 16 floats per block
+	for (int i = 0; i < 100; ++i) {
+		v.push_back(float(i));
+		assert(v.capacity() % 16 == 0 && aligned(v.data(), 64));
+	}
+	v.resize(17);
+	v.shrink_to_fit();
+	assert(v.capacity() == 32 && v[16] == 16.0f);
+	aligned_vector<double, 32> d(5, 1.0);
+	assert(d.capacity() == 8 && aligned(d.data(), 32));
+
+	static_assert(aligned_allocator<float, 64, true>::pad_capacity(1) == 16);
+	static_assert(aligned_allocator<float, 64, false>::pad_capacity(1) == 1);
+	// an element size that does not divide the alignment is left alone
+	struct three {
+		char c[3];
+	};
+	static_assert(aligned_allocator<three, 64, true>::pad_capacity(5) == 5);
+}
+
+int main()
+{
+	keeps_alignment<float, 32>(1.5f);
+	keeps_alignment<double, 64>(2.5);
+	keeps_alignment<std::string, 64>(std::string(40, 's'));
+	pads_capacity();
+	return 0;
+}
@@ -0,0 +1,253 @@
+//===-- stevemac::test_append.cpp ---------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#undef NDEBUG
+#include "vector.h"
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using stevemac::vector;
+
+/// Counts live objects and throws from the copy constructor once
+/// copies_left reaches zero.  NothrowMove picks whether growth moves the
+/// old elements or has to copy them.
+template <bool NothrowMove> struct thrower {
+	static int live;
+	static int copies_left;
+
+	thrower(int v = 0) : value(v) { ++live; }
+	thrower(const thrower &o) : value(o.value)
+	{
+		if (copies_left >= 0 && copies_left-- == 0)
+			throw std::runtime_error("copy");
+		++live;
+	}
+	thrower(thrower &&o) noexcept(NothrowMove) : value(o.value) { ++live; }
+	thrower &operator=(const thrower &) = default;
+	~thrower() { --live; }
+
+	int value;
+};
+template <bool N> int thrower<N>::live = 0;
+template <bool N> int thrower<N>::copies_left = -1;
+
+/// Yields the elements of a vector through an input iterator with no
+/// size, so append_range takes its one push_back at a time path.
+template <class T> struct input_only {
+	struct iterator {
+		using value_type = T;
+		using difference_type = std::ptrdiff_t;
+
+		const T &operator*() const { return *p; }
+		iterator &operator++()
+		{
+			++p;
+			return *this;
+		}
+		void operator++(int) { ++p; }
+		bool operator==(std::default_sentinel_t) const
+		{
+			return p == e;
+		}
+
+		const T *p;
+		const T *e;
+	};
+
+	iterator begin() const { return {v.data(), v.data() + v.size()}; }
+	std::default_sentinel_t end() const { return {}; }
+
+	const std::vector<T> &v;
+};
+
+/// Elements 0, 1, ..., n - 1 with the given capacity.
+template <class T> static vector<T> counting(int n, std::size_t cap)
+{
+	vector<T> v;
+	v.reserve(cap);
+	for (int i = 0; i < n; ++i)
+		v.push_back(T(i));
+	return v;
+}
+
+template <class T> static void assert_values(const vector<T> &v, int n)
+{
+	assert(v.size() == std::size_t(n));
+	for (int i = 0; i < n; ++i)
+		assert(v[std::size_t(i)].value == i);
+}
+
+/// Calls append(v) with the k-th copy throwing, for every k up to the
+/// first that succeeds, with and without room; v must come back with the
+/// same elements and no object leaked.  Only the bulk paths also keep the
+/// buffer: the push_back path may have grown it before the throw.
+template <class T, class Append>
+static void strong(Append append, bool same_buffer = true)
+{
+	const int before = T::live;
+	for (const std::size_t cap : {std::size_t(8), std::size_t(64)})
+		for (int k = 0;; ++k) {
+			vector<T> v = counting<T>(8, cap);
+			const T *data = v.data();
+			const int live = T::live;
+			T::copies_left = k;
+			bool threw = false;
+			try {
+				append(v);
+			} catch (const std::runtime_error &) {
+				threw = true;
+			}
+			T::copies_left = -1;
+			if (!threw)
+				break;
+			assert(!same_buffer
+			       || (v.data() == data && v.capacity() == cap));
+			assert_values(v, 8);
+			assert(T::live == live);
+		}
+	assert(T::live == before);
+}
+
+/// Each bulk append either adds all of its elements or none, whether it
+/// throws while building the new ones or while copying the old ones into
+/// a grown buffer.
+template <bool NothrowMove> static void strong_guarantee()
+{
+	using T = thrower<NothrowMove>;
+	const std::vector<T> src = {T(8), T(9), T(10), T(11), T(12)};
+
+	strong<T>([&](vector<T> &v) { v.append_range(src); });
+	const std::list<T> list(src.begin(), src.end());
+	strong<T>([&](vector<T> &v) { v.append_range(list); });
+	strong<T>([&](vector<T> &v) { v.append_n(5, T(8)); });
+	strong<T>([&](vector<T> &v) {
+		int i = 8;
+		v.generate_back_n(5, [&] {
+			if (T::copies_left >= 0 && T::copies_left-- == 0)
+				throw std::runtime_error("generate");
+			return T(i++);
+		});
+	});
+	strong<T>([&](vector<T> &v) { v.append_range(input_only<T>{src}); },
+		  false);
+
+	vector<T> v = counting<T>(8, 8);
+	v.append_range(src);
+	v.append_n(2, T(13));
+	assert(v.size() == 15 && v[14].value == 13);
+}
+
+/// v.append_range(v) and v.append_n(k, v[i]) read the source before any
+/// old element moves, with or without growth.
+static void self_aliasing()
+{
+	for (const std::size_t cap : {std::size_t(5), std::size_t(10)}) {
+		vector<std::string> s;
+		s.reserve(cap);
+		for (int i = 0; i < 5; ++i)
+			s.push_back(std::string(30, char('a' + i)));
+		s.append_range(s);
+		assert(s.size() == 10);
+		for (std::size_t i = 0; i < 10; ++i)
+			assert(s[i] == std::string(30, char('a' + i % 5)));
+
+		vector<int> v = counting<int>(5, cap);
+		v.append_range(v);
+		assert(v.size() == 10);
+		for (std::size_t i = 0; i < 10; ++i)
+			assert(v[i] == int(i % 5));
+	}
+
+	vector<std::string> s;
+	s.push_back(std::string(40, 'x'));
+	s.shrink_to_fit();
+	s.append_n(3, s[0]);
+	assert(s.size() == 4 && s[3] == std::string(40, 'x'));
+}
+
+/// Only counts the elements it constructs, which makes vector construct
+/// trivially copyable T one by one instead of copying bytes.
+template <class T> struct counting_allocator : std::allocator<T> {
+	template <class U> struct rebind {
+		using other = counting_allocator<U>;
+	};
+	counting_allocator() = default;
+	template <class U> counting_allocator(const counting_allocator<U> &) {}
+
+	template <class U, class... Args> void construct(U *p, Args &&... args)
+	{
+		++constructed;
+		::new (static_cast<void *>(p)) U(std::forward<Args>(args)...);
+	}
+
+	static inline std::size_t constructed = 0;
+};
+
+/// 24 bytes, so fill cannot build a register of repeated T.
+struct triple {
+	std::int64_t a, b, c;
+};
+
+/// memcpy, fill_n and the streamed copy and fill give the same elements
+/// as the element by element path an allocator's construct forces.
+static void lowered_paths()
+{
+	const std::size_t saved = stevemac::stream_threshold().load();
+	for (const std::size_t threshold : {std::size_t(0), SIZE_MAX}) {
+		stevemac::stream_threshold().store(threshold);
+		for (const std::size_t n : {1, 7, 33, 1000, 100003}) {
+			std::vector<std::uint16_t> src(n);
+			for (std::size_t i = 0; i < n; ++i)
+				src[i] = std::uint16_t(i * 7);
+
+			vector<std::uint16_t> v;
+			v.push_back(1);
+			v.append_range(src);
+			v.append_n(n, std::uint16_t(0xbeef));
+			v.append_range(std::array<std::uint16_t, 3>{4, 5, 6});
+			assert(v.size() == 2 * n + 4 && v[0] == 1);
+			for (std::size_t i = 0; i < n; ++i)
+				assert(v[1 + i] == src[i]
+				       && v[1 + n + i] == 0xbeef);
+			assert(v[2 * n + 3] == 6);
+
+			vector<triple> t;
+			t.append_n(n, triple{1, 2, 3});
+			t.append_range(t);
+			assert(t.size() == 2 * n);
+			for (const triple &x : t)
+				assert(x.a == 1 && x.b == 2 && x.c == 3);
+
+			counting_allocator<std::uint16_t>::constructed = 0;
+			vector<std::uint16_t, counting_allocator<std::uint16_t>>
+				c;
+			c.append_range(src);
+			c.append_n(n, std::uint16_t(0xbeef));
+			assert(counting_allocator<std::uint16_t>::constructed
+			       == 2 * n);
+			for (std::size_t i = 0; i < n; ++i)
+				assert(c[i] == v[1 + i] && c[n + i] == 0xbeef);
+		}
+	}
+	stevemac::stream_threshold().store(saved);
+}
+
+int main()
+{
+	strong_guarantee<true>();
+	strong_guarantee<false>();
+	self_aliasing();
+	lowered_paths();
+	return 0;
+}
@@ -0,0 +1,71 @@
+//===-- stevemac::test_capacity_hint.cpp --------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#undef NDEBUG
+#include "vector.h"
+#include <cassert>
+#include <cstddef>
+
+using stevemac::capacity_hint_metrics;
+using stevemac::capacity_hint_site;
+using stevemac::vector;
+
+/// The site learns from the first vector; the next ones built there
+/// allocate the hint up front, whichever way they are filled first.  Each
+/// small one lowers the hint a little when it reports.
+static void first_allocation_uses_hint()
+{
+	capacity_hint_site site;
+	{
+		vector<int> v(site);
+		for (int i = 0; i < 5000; ++i)
+			v.push_back(i);
+	}
+	assert(site.hint() == 5000);
+
+	const auto before = capacity_hint_metrics();
+	{
+		vector<int> v(site);
+		v.push_back(1);
+		assert(v.capacity() >= site.hint());
+	}
+	{
+		const std::size_t hint = site.hint();
+		assert(hint > 4000);
+		vector<int> v(site);
+		v.append_n(100, 7);
+		assert(v.capacity() >= hint);
+		v.append_n(4000, 8);
+		assert(v.size() == 4100 && v[99] == 7 && v[100] == 8);
+	}
+	{
+		const std::size_t hint = site.hint();
+		vector<int> v(site);
+		int next = 0;
+		v.generate_back_n(10, [&] { return next++; });
+		assert(v.capacity() >= hint && v[9] == 9);
+	}
+	const auto after = capacity_hint_metrics();
+	assert(after.hinted_allocs == before.hinted_allocs + 3);
+	assert(after.growths == before.growths);
+}
+
+/// A bulk append larger than the hint is sized by the append.
+static void append_larger_than_hint()
+{
+	capacity_hint_site site;
+	site.record(100);
+	vector<int> v(site);
+	v.append_n(1000, 1);
+	assert(v.size() == 1000 && v.capacity() >= 1000);
+}
+
+int main()
+{
+	first_allocation_uses_hint();
+	append_larger_than_hint();
+	return 0;
+}
@@ -0,0 +1,73 @@
+//===-- stevemac::test_circular_vector.cpp ------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#undef NDEBUG
+#include "circular_vector.h"
+#include "vector.h"
+#include <cassert>
+#include <string>
+
+using stevemac::circular_vector;
+
+/// push_* on a full ring with an argument that lives in the ring: the
+/// growth must not free it before the new element is built.
+static void push_own_element_when_full()
+{
+	circular_vector<std::string> c;
+	for (int i = 0; i < 10; ++i)
+		c.push_back(std::string(30, char('a' + i)));
+	assert(c.size() == c.capacity());
+
+	c.push_back(c.front());
+	assert(c.size() == 11 && c.back() == std::string(30, 'a'));
+
+	while (c.size() < c.capacity())
+		c.push_back("x");
+	c.pop_front();
+	c.push_back("y"); // full and wrapped
+	assert(c.size() == c.capacity());
+	c.push_front(c.back());
+	assert(c.front() == "y" && c.back() == "y");
+
+	while (c.size() < c.capacity())
+		c.push_back("z");
+	const std::string third = c[3];
+	c.push_front(c[3]);
+	assert(c.front() == third && c[4] == third);
+}
+
+static void wraps_and_grows_in_order()
+{
+	circular_vector<int> c;
+	for (int i = 0; i < 1000; ++i) {
+		c.push_back(i);
+		if (i % 3 == 0)
+			c.pop_front();
+	}
+	for (std::size_t i = 1; i < c.size(); ++i)
+		assert(c[i] == c[i - 1] + 1);
+	assert(c.back() == 999);
+}
+
+/// push_back grows the ring to the same capacities as a vector.
+static void grows_like_vector()
+{
+	circular_vector<int> c;
+	stevemac::vector<int> v;
+	for (int i = 0; i < 5000; ++i) {
+		c.push_back(i);
+		v.push_back(i);
+		assert(c.capacity() == v.capacity());
+	}
+}
+
+int main()
+{
+	push_own_element_when_full();
+	wraps_and_grows_in_order();
+	grows_like_vector();
+	return 0;
+}
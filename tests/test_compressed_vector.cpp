@@ -0,0 +1,73 @@
+//===-- stevemac::test_compressed_vector.cpp ----------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#undef NDEBUG
+#include "compressed_vector.h"
+#include <cassert>
+#include <cstdint>
+
+using stevemac::compressed_vector;
+
+static compressed_vector<std::uint32_t> threes(std::uint32_t n)
+{
+	compressed_vector<std::uint32_t> c;
+	for (std::uint32_t i = 0; i < n; ++i)
+		c.push_back(i * 3);
+	return c;
+}
+
+/// *it++ across block boundaries and into the tail.
+static void post_increment()
+{
+	const compressed_vector<std::uint32_t> c = threes(300);
+	auto it = c.begin();
+	for (std::uint32_t i = 0; i < 300; ++i)
+		assert(*it++ == i * 3);
+	assert(it == c.end());
+}
+
+/// A copy keeps its values after the original moves to the next block.
+static void copies_are_independent()
+{
+	const compressed_vector<std::uint32_t> c = threes(300);
+	auto it = c.begin();
+	for (int i = 0; i < 127; ++i)
+		++it;
+	const auto copy = it;
+	++it;
+	assert(*copy == 127 * 3 && *it == 128 * 3);
+
+	for (int i = 0; i < 128; ++i)
+		++it;
+	auto in_tail = it;
+	assert(*in_tail == 256 * 3);
+	auto assigned = c.begin();
+	assigned = copy;
+	++in_tail;
+	assert(*assigned == 127 * 3 && *in_tail == 257 * 3);
+	assert(*it == 256 * 3);
+}
+
+/// The iterator agrees with operator[] and to_vector().
+static void matches_indexing()
+{
+	const compressed_vector<std::uint32_t> c = threes(1000);
+	const auto v = c.to_vector();
+	std::size_t i = 0;
+	for (std::uint32_t x : c) {
+		assert(x == c[i] && x == v[i]);
+		++i;
+	}
+	assert(i == c.size());
+}
+
+int main()
+{
+	post_increment();
+	copies_are_independent();
+	matches_indexing();
+	return 0;
+}
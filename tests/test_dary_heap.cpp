@@ -0,0 +1,181 @@
+//===-- stevemac::test_dary_heap.cpp ------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#undef NDEBUG
+#include "dary_heap.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <queue>
+#include <random>
+#include <vector>
+
+using stevemac::dary_heap;
+using stevemac::mutable_dary_heap;
+
+/// Every node is no greater than its parent.
+template <std::size_t D, class T, class Compare>
+static bool is_dary_heap(const stevemac::vector<T> &v, Compare comp)
+{
+	for (std::size_t i = 1; i < v.size(); ++i)
+		if (comp(v[(i - 1) / D], v[i]))
+			return false;
+	return true;
+}
+
+/// Interleaved pushes and pops come out in std::priority_queue's order.
+template <std::size_t D, class Compare> static void same_order_as_std()
+{
+	std::mt19937 rng(D);
+	dary_heap<int, D, Compare> h;
+	std::priority_queue<int, std::vector<int>, Compare> ref;
+	for (int step = 0; step < 50000; ++step) {
+		if (ref.empty() || rng() % 5 < 3) {
+			const int x = int(rng() % 1000); // with duplicates
+			h.push(x);
+			ref.push(x);
+		} else {
+			assert(h.top() == ref.top());
+			h.pop();
+			ref.pop();
+		}
+		assert(h.size() == ref.size());
+		if (step % 997 == 0)
+			assert(is_dary_heap<D>(h.container(), Compare()));
+	}
+	while (!ref.empty()) {
+		assert(h.extract_top() == ref.top());
+		ref.pop();
+	}
+	assert(h.empty());
+}
+
+/// heapify and the vector constructor build a valid heap in place.
+template <std::size_t D> static void heapify_in_place()
+{
+	std::mt19937 rng(7);
+	for (std::size_t n : {std::size_t(0), std::size_t(1), std::size_t(2), D,
+			      D + 1, std::size_t(1000)}) {
+		stevemac::vector<int> v;
+		for (std::size_t i = 0; i < n; ++i)
+			v.push_back(int(rng() % 100));
+		std::vector<int> sorted(v.begin(), v.end());
+		std::sort(sorted.begin(), sorted.end(), std::greater<int>());
+
+		dary_heap<int, D> h;
+		h.heapify(v);
+		assert(h.size() == n && is_dary_heap<D>(h.container(),
+							 std::less<int>()));
+		dary_heap<int, D, std::greater<int>> g(v);
+		assert(is_dary_heap<D>(g.container(), std::greater<int>()));
+		for (int x : sorted) {
+			assert(h.top() == x);
+			h.pop();
+		}
+		assert(h.empty());
+
+		dary_heap<int, D> again;
+		again.heapify(g.take());
+		assert(again.size() == n);
+	}
+}
+
+/// Random push, pop, decrease_key, update and erase against a map from
+/// handle to value; pops and erases leave the handle stale.
+template <std::size_t D> static void mutable_against_map()
+{
+	using heap = mutable_dary_heap<int, D, std::greater<int>>;
+	using handle = typename heap::handle_type;
+	auto key = [](const handle &h) {
+		return (std::uint64_t(h.generation) << 32) | h.index;
+	};
+
+	std::mt19937 rng(D * 11);
+	heap h;
+	std::map<std::uint64_t, std::pair<handle, int>> live;
+	std::vector<handle> dead;
+	auto pick = [&] {
+		auto it = live.begin();
+		std::advance(it, rng() % live.size());
+		return it;
+	};
+	auto min_value = [&] {
+		int m = live.begin()->second.second;
+		for (auto &[k, hv] : live)
+			m = std::min(m, hv.second);
+		return m;
+	};
+
+	for (int step = 0; step < 20000; ++step) {
+		const unsigned op = live.empty() ? 0 : rng() % 6;
+		if (op <= 1) {
+			const int x = int(rng() % 10000);
+			const handle hd = h.push(x);
+			assert(h.contains(hd) && h[hd] == x);
+			live[key(hd)] = {hd, x};
+		} else if (op == 2) {
+			const int top = min_value();
+			assert(h.top() == top);
+			const handle th = h.top_handle();
+			assert(live.at(key(th)).second == top);
+			h.pop();
+			live.erase(key(th));
+			dead.push_back(th);
+		} else if (op == 3) {
+			auto it = pick();
+			const int x = it->second.second - int(rng() % 500);
+			h.decrease_key(it->second.first, x);
+			it->second.second = x;
+		} else if (op == 4) {
+			auto it = pick();
+			const int x = int(rng() % 10000);
+			h.update(it->second.first, x);
+			it->second.second = x;
+		} else {
+			auto it = pick();
+			assert(h.erase(it->second.first));
+			dead.push_back(it->second.first);
+			live.erase(it);
+		}
+
+		assert(h.size() == live.size());
+		if (!live.empty())
+			assert(h.top() == min_value());
+		if (step % 499 == 0)
+			for (auto &[k, hv] : live)
+				assert(h.contains(hv.first)
+				       && h[hv.first] == hv.second);
+	}
+	for (const handle &d : dead)
+		assert(!h.contains(d) && !h.erase(d));
+
+	std::vector<handle> handles;
+	for (auto &[k, hv] : live)
+		handles.push_back(hv.first);
+	h.clear();
+	assert(h.empty());
+	for (const handle &hd : handles)
+		assert(!h.contains(hd));
+}
+
+int main()
+{
+	same_order_as_std<2, std::less<int>>();
+	same_order_as_std<4, std::less<int>>();
+	same_order_as_std<8, std::less<int>>();
+	same_order_as_std<4, std::greater<int>>();
+	heapify_in_place<2>();
+	heapify_in_place<4>();
+	heapify_in_place<8>();
+	mutable_against_map<2>();
+	mutable_against_map<4>();
+	mutable_against_map<8>();
+	return 0;
+}
@@ -0,0 +1,140 @@
+//===-- stevemac::test_execution.cpp ------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#undef NDEBUG
+#include "execution.h"
+#include "vector.h"
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+using stevemac::parallel_policy;
+using stevemac::detail::chunk_plan;
+using stevemac::detail::first_touch_page;
+
+/// The ranges cover [0, n) in order, at most one per thread.
+static void check_cover(const chunk_plan &plan, std::size_t n,
+			unsigned threads)
+{
+	assert(plan.chunks() <= threads);
+	std::size_t at = 0;
+	for (std::size_t i = 0; i < plan.chunks(); ++i) {
+		assert(plan.begin(i) == at && plan.end(i) > at);
+		at = plan.end(i);
+	}
+	assert(at == n);
+}
+
+/// Every chunk after the first starts on a page, wherever the buffer is.
+static void boundaries_on_pages()
+{
+	const parallel_policy policy{4, 0};
+	for (std::size_t skew = 0; skew < first_touch_page; skew += 8) {
+		const auto addr = std::uintptr_t(1) << 20 | skew;
+		const void *first = reinterpret_cast<const void *>(addr);
+		for (std::size_t n : {std::size_t(0), std::size_t(1),
+				      std::size_t(100), std::size_t(5000),
+				      std::size_t(100003)}) {
+			const chunk_plan plan(n, sizeof(double), policy, first);
+			check_cover(plan, n, 4);
+			for (std::size_t i = 1; i < plan.chunks(); ++i)
+				assert((addr + plan.begin(i) * sizeof(double))
+					       % first_touch_page
+				       == 0);
+		}
+	}
+}
+
+/// Without an address, or for sizes that do not divide a page, the split
+/// is the plain one.
+static void unaligned_sizes()
+{
+	const parallel_policy policy{3, 0};
+	const void *first = reinterpret_cast<const void *>(std::uintptr_t(12));
+	const chunk_plan odd(10000, 12, policy, first);
+	check_cover(odd, 10000, 3);
+	assert(odd.begin(1) % (first_touch_page / 12) == 0);
+
+	const chunk_plan plain(10000, 8, policy);
+	check_cover(plain, 10000, 3);
+	assert(plain.begin(1) % (first_touch_page / 8) == 0);
+}
+
+/// The parallel constructor and for_each_chunk over data() agree.
+static void vector_split()
+{
+	const parallel_policy policy{4, 0};
+	stevemac::vector<std::uint64_t> v(policy, 100000, 7);
+	assert(v.size() == 100000);
+	std::atomic<std::size_t> seen{0};
+	stevemac::for_each_chunk(policy, v.data(), v.size(),
+				 [&](std::size_t b, std::size_t e) {
+					 if (b != 0)
+						 assert(reinterpret_cast<std::uintptr_t>(
+								v.data() + b)
+							       % first_touch_page
+						       == 0);
+					 for (std::size_t i = b; i < e; ++i)
+						 assert(v[i] == 7);
+					 seen += e - b;
+				 });
+	assert(seen == v.size());
+}
+
+/// Counts live objects; construction number throw_at throws.
+struct counted {
+	static inline std::atomic<int> live{0};
+	static inline std::atomic<int> made{0};
+	static inline int throw_at = -1;
+
+	counted()
+	{
+		if (made++ == throw_at)
+			throw std::runtime_error("counted");
+		++live;
+	}
+	counted(const counted &) : counted() {}
+	~counted()
+	{
+		--live;
+	}
+	char pad[64];
+};
+
+/// A constructor throwing in one chunk leaves nothing constructed in any
+/// chunk and no buffer behind, and the exception reaches the caller.
+static void constructor_throws()
+{
+	const parallel_policy policy{4, 0};
+	for (int at : {0, 10, 5000, 19999}) {
+		counted::made = 0;
+		counted::throw_at = at;
+		bool threw = false;
+		try {
+			stevemac::vector<counted> v(policy, 20000);
+		} catch (const std::runtime_error &) {
+			threw = true;
+		}
+		assert(threw && counted::live == 0);
+	}
+	counted::throw_at = -1;
+	{
+		stevemac::vector<counted> v(policy, 20000);
+		assert(counted::live == 20000);
+	}
+	assert(counted::live == 0);
+}
+
+int main()
+{
+	boundaries_on_pages();
+	unaligned_sizes();
+	vector_split();
+	constructor_throws();
+	return 0;
+}
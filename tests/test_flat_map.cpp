@@ -0,0 +1,89 @@
+//===-- stevemac::test_flat_map.cpp -------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#undef NDEBUG
+#include "flat_map.h"
+#include <cassert>
+#include <cstddef>
+#include <map>
+#include <string>
+
+using stevemac::flat_map;
+
+/// Long enough that every key and value owns a heap buffer.
+static std::string text(int i)
+{
+	return "key-" + std::to_string(i * 7919 % 1000) + std::string(24, 'x');
+}
+
+static void check_same(const flat_map<std::string, std::string> &m,
+		       const std::map<std::string, std::string> &ref)
+{
+	assert(m.size() == ref.size());
+	auto r = ref.begin();
+	for (auto it = m.begin(); it != m.end(); ++it, ++r) {
+		assert((*it).first == r->first);
+		assert((*it).second == r->second);
+	}
+}
+
+/// Single element try_emplace, insert_or_assign and erase with non-trivial
+/// keys and values, checked against std::map.
+static void single_element_strings()
+{
+	flat_map<std::string, std::string> m;
+	std::map<std::string, std::string> ref;
+	for (int i = 0; i < 500; ++i) {
+		const std::string k = text(i);
+		const bool added = m.try_emplace(k, k + "-v").second;
+		assert(added == ref.try_emplace(k, k + "-v").second);
+	}
+	check_same(m, ref);
+
+	for (int i = 0; i < 500; i += 3)
+		m.insert_or_assign(text(i), std::string("new"));
+	for (int i = 0; i < 500; i += 3)
+		ref.insert_or_assign(text(i), std::string("new"));
+	check_same(m, ref);
+
+	for (int i = 0; i < 500; i += 2)
+		assert(m.erase(text(i)) == ref.erase(text(i)));
+	check_same(m, ref);
+
+	m.erase(m.begin());
+	ref.erase(ref.begin());
+	m.erase(m.begin() + 10, m.begin() + 40);
+	ref.erase(std::next(ref.begin(), 10), std::next(ref.begin(), 40));
+	check_same(m, ref);
+
+	m.build_index();
+	for (int i = 0; i < 500; ++i)
+		m[text(i)] += "!";
+	for (int i = 0; i < 500; ++i)
+		ref[text(i)] += "!";
+	check_same(m, ref);
+}
+
+/// Erasing the last elements and everything leaves a usable map.
+static void erase_to_empty()
+{
+	flat_map<std::string, std::string> m;
+	for (int i = 0; i < 50; ++i)
+		m.try_emplace(text(i), text(i));
+	m.erase(m.begin() + 40, m.end());
+	assert(m.size() == 40);
+	m.erase(m.begin(), m.end());
+	assert(m.empty());
+	m.try_emplace(text(1), "one");
+	assert(m.size() == 1 && m.at(text(1)) == "one");
+}
+
+int main()
+{
+	single_element_strings();
+	erase_to_empty();
+	return 0;
+}
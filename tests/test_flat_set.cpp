@@ -0,0 +1,68 @@
+//===-- stevemac::test_flat_set.cpp -------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#undef NDEBUG
+#include "flat_set.h"
+#include <algorithm>
+#include <cassert>
+#include <set>
+#include <string>
+
+using stevemac::flat_set;
+
+static std::string text(int i)
+{
+	return "key-" + std::to_string(i * 7919 % 1000) + std::string(24, 'x');
+}
+
+static void check_same(const flat_set<std::string> &s,
+		       const std::set<std::string> &ref)
+{
+	assert(s.size() == ref.size());
+	assert(std::equal(s.begin(), s.end(), ref.begin(), ref.end()));
+}
+
+/// Single key insert and erase with std::string keys.
+static void single_element_strings()
+{
+	flat_set<std::string> s;
+	std::set<std::string> ref;
+	for (int i = 0; i < 500; ++i)
+		assert(s.insert(text(i)).second == ref.insert(text(i)).second);
+	check_same(s, ref);
+
+	for (int i = 0; i < 500; i += 2)
+		assert(s.erase(text(i)) == ref.erase(text(i)));
+	check_same(s, ref);
+
+	s.erase(s.begin() + 5, s.begin() + 25);
+	ref.erase(std::next(ref.begin(), 5), std::next(ref.begin(), 25));
+	s.erase(s.end() - 1);
+	ref.erase(std::prev(ref.end()));
+	check_same(s, ref);
+}
+
+/// Range insert drops duplicates at the end of the buffer.
+static void range_insert_duplicates()
+{
+	flat_set<std::string> s;
+	std::set<std::string> ref;
+	for (int round = 0; round < 3; ++round) {
+		std::string batch[64];
+		for (int i = 0; i < 64; ++i)
+			batch[i] = text(i * (round + 1));
+		s.insert(batch, batch + 64);
+		ref.insert(batch, batch + 64);
+		check_same(s, ref);
+	}
+}
+
+int main()
+{
+	single_element_strings();
+	range_insert_duplicates();
+	return 0;
+}
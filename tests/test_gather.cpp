@@ -0,0 +1,210 @@
+//===-- stevemac::test_gather.cpp ---------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#undef NDEBUG
+#include "gather.h"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <sys/mman.h>
+
+using namespace stevemac;
+
+/// Index counts around the 4 and 8 lane steps and the prefetch distance.
+static const std::size_t counts[] = {0, 1,  3,  4,   5,
+				     7, 8, 9, 16, 17, 100, 1001};
+
+template <typename T> static T value_of(std::size_t i)
+{
+	if constexpr (std::is_floating_point_v<T>)
+		return T(i) * T(0.5) - T(7);
+	else
+		return T(i * 2654435761u);
+}
+
+template <typename T> static vector<T> table(std::size_t n)
+{
+	vector<T> v;
+	for (std::size_t i = 0; i < n; ++i)
+		v.push_back(value_of<T>(i));
+	return v;
+}
+
+template <typename I>
+static vector<I> random_indices(std::size_t n, std::size_t below,
+				unsigned seed)
+{
+	std::mt19937_64 rng(seed);
+	vector<I> v;
+	for (std::size_t i = 0; i < n; ++i)
+		v.push_back(I(rng() % below));
+	return v;
+}
+
+/// Bitwise, so NaN-free floats and integers compare the same way.
+template <typename T>
+static bool same(const T *a, const T *b, std::size_t n)
+{
+	return n == 0 || std::memcmp(a, b, n * sizeof(T)) == 0;
+}
+
+/// The scalar and AVX2 kernels, and gather() with and without sorted
+/// batches, all give src[indices[i]] for every count and distance.
+template <typename T, typename I> static void gather_matches_loop()
+{
+	const vector<T> src = table<T>(1000);
+	for (std::size_t n : counts) {
+		const vector<I> idx =
+			random_indices<I>(n, src.size(), unsigned(n));
+		vector<T> want;
+		for (std::size_t i = 0; i < n; ++i)
+			want.push_back(src[std::size_t(idx[i])]);
+
+		for (std::size_t distance : {0, 1, 8, 2000}) {
+			vector<T> got;
+			got.resize_for_overwrite(n);
+			detail::gather_scalar(src.data(), idx.data(), n,
+					      got.data(), distance);
+			assert(same(got.data(), want.data(), n));
+#if STEVEMAC_SIMD_X86
+			if constexpr (detail::simd_gatherable_v<T, I>)
+				if (simd_dispatch_level() == simd_level::avx2) {
+					for (T &x : got)
+						x = value_of<T>(99);
+					detail::gather_avx2(src.data(),
+							    idx.data(), n,
+							    got.data(),
+							    distance);
+					assert(same(got.data(), want.data(),
+						    n));
+				}
+#endif
+			for (bool sorted : {false, true})
+				for (std::size_t batch : {0, 1, 7, 4096}) {
+					gather_options o;
+					o.prefetch_distance = distance;
+					o.sort_batches = sorted;
+					o.batch = batch;
+					vector<T> out;
+					out.push_back(value_of<T>(99));
+					gather(src, idx, out, o);
+					assert(out.size() == n);
+					assert(same(out.data(), want.data(),
+						    n));
+				}
+		}
+	}
+}
+
+template <typename T> static void gather_all_index_types()
+{
+	gather_matches_loop<T, std::int32_t>();
+	gather_matches_loop<T, std::uint32_t>();
+	gather_matches_loop<T, std::int64_t>();
+	gather_matches_loop<T, std::uint64_t>();
+}
+
+/// 32-bit indices at and past 2^31 into a table too big for int32_t:
+/// the AVX2 gather would read them as negative, so gather_range has to
+/// send them to the scalar loop.  The table is reserved, not committed,
+/// and only the pages the indices land on are touched.
+template <typename T> static void int32_cutoff()
+{
+	const std::size_t size = (std::size_t(1) << 31) + (1 << 20);
+	void *p = ::mmap(nullptr, size * sizeof(T), PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (p == MAP_FAILED)
+		return; // no address space for it here
+	T *src = static_cast<T *>(p);
+
+	std::mt19937 rng(5);
+	vector<std::uint32_t> idx;
+	for (std::size_t i = 0; i < 37; ++i) {
+		const std::uint32_t at =
+			i % 3 == 0 ? std::uint32_t(rng() % 4096)
+				   : std::uint32_t((std::size_t(1) << 31)
+						   + rng() % (1 << 20));
+		idx.push_back(at);
+		src[at] = value_of<T>(at);
+	}
+	vector<T> out;
+	out.resize_for_overwrite(idx.size());
+	detail::gather_range(src, size, idx.data(), idx.size(), out.data(),
+			     std::size_t(4));
+	for (std::size_t i = 0; i < idx.size(); ++i)
+		assert(out[i] == value_of<T>(idx[i]));
+
+	// below the cutoff the same indices go through AVX2 if it is there
+	vector<std::uint32_t> low;
+	for (std::size_t i = 0; i < idx.size(); i += 3)
+		low.push_back(idx[i]);
+	out.resize_for_overwrite(low.size());
+	detail::gather_range(src, 4096, low.data(), low.size(), out.data(),
+			     std::size_t(0));
+	for (std::size_t i = 0; i < low.size(); ++i)
+		assert(out[i] == value_of<T>(low[i]));
+	::munmap(p, size * sizeof(T));
+}
+
+/// With repeated indices the last write wins, sorted or not, whatever
+/// the batch size and prefetch distance.
+template <typename T> static void scatter_last_write_wins()
+{
+	for (std::size_t n : counts) {
+		// few distinct targets, so most indices repeat
+		const vector<std::uint32_t> idx =
+			random_indices<std::uint32_t>(n, 13, unsigned(n) + 1);
+		const vector<T> src = table<T>(n);
+		vector<T> want = table<T>(13);
+		for (T &x : want)
+			x = value_of<T>(7777);
+		vector<T> before = want;
+		for (std::size_t i = 0; i < n; ++i)
+			want[idx[i]] = src[i];
+
+		for (std::size_t distance : {0, 1, 8})
+			for (bool sorted : {false, true})
+				for (std::size_t batch : {0, 1, 5, 4096}) {
+					gather_options o;
+					o.prefetch_distance = distance;
+					o.sort_batches = sorted;
+					o.batch = batch;
+					vector<T> dst = before;
+					scatter(dst, idx, src, o);
+					assert(same(dst.data(), want.data(),
+						    13));
+				}
+	}
+}
+
+/// Element types the AVX2 path does not take still gather and scatter.
+struct rgb {
+	unsigned char r, g, b;
+	bool operator==(const rgb &) const = default;
+};
+template <> rgb value_of<rgb>(std::size_t i)
+{
+	return rgb{static_cast<unsigned char>(i),
+		   static_cast<unsigned char>(i >> 8), 3};
+}
+
+int main()
+{
+	gather_all_index_types<std::int32_t>();
+	gather_all_index_types<std::uint32_t>();
+	gather_all_index_types<float>();
+	gather_all_index_types<std::int64_t>();
+	gather_all_index_types<double>();
+	gather_all_index_types<std::uint16_t>();
+	gather_all_index_types<rgb>();
+	int32_cutoff<std::uint32_t>();
+	int32_cutoff<std::uint64_t>();
+	scatter_last_write_wins<std::uint64_t>();
+	scatter_last_write_wins<rgb>();
+	return 0;
+}
@@ -0,0 +1,162 @@
+//===-- stevemac::test_io.cpp -------------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#undef NDEBUG
+#include "io.h"
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <csignal>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+using stevemac::read_into;
+using bytes = stevemac::vector<char>;
+
+static std::string text(const bytes &v)
+{
+	return std::string(v.data(), v.size());
+}
+
+/// spare_capacity(n) leaves the buffer alone when n slots are free and
+/// otherwise grows by the push_back policy; commit() adopts exactly what
+/// it is told, up to all of the spare capacity.
+static void spare_and_commit()
+{
+	bytes v;
+	assert(v.spare_capacity().empty());
+	auto s = v.spare_capacity(5);
+	assert(s.size() >= 5 && s.size() == v.capacity() && v.empty());
+	std::memcpy(s.data(), "hello", 5);
+	v.commit(5);
+	assert(text(v) == "hello");
+
+	v.commit(0);
+	assert(v.size() == 5);
+
+	// room already there: same buffer
+	const char *before = v.data();
+	const std::size_t free = v.capacity() - v.size();
+	s = v.spare_capacity(free);
+	assert(v.data() == before && s.size() == free);
+	assert(s.data() == v.data() + v.size());
+
+	// one more than free: grows, keeps the elements, at least doubles
+	s = v.spare_capacity(free + 1);
+	assert(s.size() >= free + 1 && v.capacity() >= 2 * v.size());
+	assert(text(v) == "hello");
+
+	// commit the whole spare capacity
+	const std::size_t all = s.size();
+	std::memset(s.data(), 'x', all);
+	v.commit(all);
+	assert(v.size() == v.capacity() && v.spare_capacity().empty());
+	assert(text(v) == "hello" + std::string(all, 'x'));
+
+	// shrinking with resize_for_overwrite keeps the front
+	v.resize_for_overwrite(3);
+	assert(text(v) == "hel");
+}
+
+/// Committing past the spare capacity trips commit's assertion.
+static void commit_past_capacity_asserts()
+{
+	std::fflush(nullptr);
+	const pid_t child = ::fork();
+	assert(child >= 0);
+	if (child == 0) {
+		// keep the expected assertion message out of the test log
+		std::freopen("/dev/null", "w", stderr);
+		bytes v;
+		v.spare_capacity(4);
+		v.commit(v.capacity() + 1);
+		::_exit(0);
+	}
+	int status = 0;
+	assert(::waitpid(child, &status, 0) == child);
+	assert(WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT);
+}
+
+/// Bytes already in a pipe come back in one call, which stops at the
+/// short read instead of blocking for more; max caps the read, and the
+/// rest comes on the next call.
+static void short_reads_and_max()
+{
+	int fds[2];
+	assert(::pipe(fds) == 0);
+
+	assert(::write(fds[1], "0123456789", 10) == 10);
+	bytes v;
+	v.push_back('>');
+	assert(read_into(fds[0], v, 1000) == 10);
+	assert(text(v) == ">0123456789");
+
+	assert(::write(fds[1], "abcdefgh", 8) == 8);
+	assert(read_into(fds[0], v, 3) == 3);
+	assert(text(v) == ">0123456789abc");
+	assert(read_into(fds[0], v, 0) == 0);
+	assert(read_into(fds[0], v, 100) == 5);
+	assert(text(v) == ">0123456789abcdefgh");
+
+	::close(fds[1]);
+	assert(read_into(fds[0], v, 100) == 0);
+	assert(text(v) == ">0123456789abcdefgh");
+	::close(fds[0]);
+
+	errno = 0;
+	assert(read_into(fds[0], v, 100) == -1 && errno == EBADF);
+	assert(v.size() == 19);
+}
+
+/// A writer thread sends more than a pipe holds in uneven pieces and
+/// closes; reading until end of file gets every byte in order, across
+/// several read_chunk sized reads and many growths.
+static void stream_until_eof()
+{
+	int fds[2];
+	assert(::pipe(fds) == 0);
+	std::string sent;
+	for (std::size_t i = 0; sent.size() < 3 * stevemac::read_chunk + 12345;
+	     ++i)
+		sent += std::to_string(i) + ',';
+
+	std::thread writer([&] {
+		std::size_t at = 0;
+		std::size_t piece = 1;
+		while (at < sent.size()) {
+			const std::size_t n = std::min(piece, sent.size() - at);
+			assert(::write(fds[1], sent.data() + at, n)
+			       == ::ssize_t(n));
+			at += n;
+			piece = piece * 3 % 70001 + 1;
+		}
+		::close(fds[1]);
+	});
+
+	bytes v;
+	::ssize_t got;
+	std::size_t calls = 0;
+	while ((got = read_into(fds[0], v, std::size_t(-1))) > 0)
+		++calls;
+	writer.join();
+	assert(got == 0 && calls >= 1);
+	assert(text(v) == sent);
+	::close(fds[0]);
+}
+
+int main()
+{
+	spare_and_commit();
+	commit_past_capacity_asserts();
+	short_reads_and_max();
+	stream_until_eof();
+	return 0;
+}
@@ -0,0 +1,130 @@
+//===-- stevemac::test_reclaim.cpp --------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#undef NDEBUG
+#include "vector.h"
+#include <cassert>
+#include <stdexcept>
+#include <string>
+
+using stevemac::reclaim_policy;
+using stevemac::vector;
+
+/// Copies throw on demand; the move may throw too, so reclaim copies.
+struct fragile {
+	static inline int copies_left = -1;
+	static inline int live = 0;
+
+	explicit fragile(int v) : value(v)
+	{
+		++live;
+	}
+	fragile(const fragile &o) : value(o.value)
+	{
+		if (copies_left == 0)
+			throw std::runtime_error("copy");
+		if (copies_left > 0)
+			--copies_left;
+		++live;
+	}
+	fragile(fragile &&o) noexcept(false) : value(o.value)
+	{
+		++live;
+	}
+	fragile &operator=(const fragile &) = default;
+	~fragile()
+	{
+		--live;
+	}
+	int value;
+};
+
+static reclaim_policy eager()
+{
+	reclaim_policy p;
+	p.patience = 1;
+	p.min_bytes = 0;
+	return p;
+}
+
+/// A zero divisor or headroom is rejected instead of dividing by zero or
+/// freeing live elements.
+static void invalid_policy()
+{
+	vector<int> v;
+	reclaim_policy p;
+	p.low_water_divisor = 0;
+	bool threw = false;
+	try {
+		v.set_reclaim_policy(p);
+	} catch (const std::invalid_argument &) {
+		threw = true;
+	}
+	assert(threw);
+
+	p = reclaim_policy();
+	p.headroom = 0;
+	threw = false;
+	try {
+		v.set_reclaim_policy(p);
+	} catch (const std::invalid_argument &) {
+		threw = true;
+	}
+	assert(threw);
+}
+
+/// Shrinking destroys the old elements; run under ASan this leaks if not.
+static void shrink_strings()
+{
+	vector<std::string> v;
+	v.set_reclaim_policy(eager());
+	for (int i = 0; i < 1000; ++i)
+		v.push_back(std::string(40, char('a' + i % 26)));
+	const std::size_t before = v.capacity();
+	while (v.size() > 10)
+		v.pop_back();
+	assert(v.capacity() < before);
+	assert(v.size() == 10);
+	for (int i = 0; i < 10; ++i)
+		assert(v[i] == std::string(40, char('a' + i % 26)));
+	v.clear();
+	assert(v.capacity() == 0);
+}
+
+/// A copy that throws mid shrink leaves the vector as it was.
+static void shrink_throws()
+{
+	{
+		vector<fragile> v;
+		v.reserve(1000);
+		for (int i = 0; i < 100; ++i)
+			v.emplace_back(i);
+		const std::size_t cap = v.capacity();
+		v.set_reclaim_policy(eager());
+		fragile::copies_left = 30;
+		v.pop_back();
+		assert(v.capacity() == cap && v.size() == 99);
+		assert(fragile::live == 99);
+		for (int i = 0; i < 99; ++i)
+			assert(v[i].value == i);
+
+		fragile::copies_left = -1;
+		v.pop_back();
+		assert(v.capacity() < cap && v.size() == 98);
+		assert(fragile::live == 98);
+		for (int i = 0; i < 98; ++i)
+			assert(v[i].value == i);
+	}
+	assert(fragile::live == 0);
+}
+
+int main()
+{
+	invalid_policy();
+	shrink_strings();
+	shrink_throws();
+	return 0;
+}
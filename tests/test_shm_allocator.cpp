@@ -0,0 +1,228 @@
+//===-- stevemac::test_shm_allocator.cpp --------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#undef NDEBUG
+#include "shm_allocator.h"
+#include "vector.h"
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace stevemac;
+
+using shm_ints = vector<int, shm_allocator<int>>;
+
+/// A name no other run of the test is using.
+static std::string segment_name(const char *what)
+{
+	return "/stevemac_test_" + std::string(what) + "_"
+	       + std::to_string(::getpid());
+}
+
+/// offset_ptr behaves as a random access pointer and, being relative to
+/// itself, still points into a block that was copied byte for byte.
+static void offset_ptr_arithmetic()
+{
+	int a[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+	offset_ptr<int> p(a);
+	offset_ptr<int> q = p + 5;
+	assert(*q == 5 && q[-2] == 3 && q - p == 5 && 2 + p == a + 2);
+	assert(p < q && q > p && p <= p && p != q && p == a);
+	++p;
+	p += 2;
+	assert(*p == 3 && *p-- == 3 && *p == 2 && *--q == 4);
+	offset_ptr<const int> c = q;
+	assert(c.get() == a + 4);
+	offset_ptr<void> v = q;
+	assert(static_cast<offset_ptr<int>>(v) == q);
+
+	offset_ptr<int> none;
+	assert(!none && none == nullptr && none.get() == nullptr);
+
+	struct node {
+		int value;
+		offset_ptr<int> self;
+	};
+	alignas(node) unsigned char from[sizeof(node)], to[sizeof(node)];
+	node *n = ::new (from) node{42, nullptr};
+	n->self = &n->value;
+	std::memcpy(to, from, sizeof(node));
+	node *m = reinterpret_cast<node *>(to);
+	assert(m->self.get() == &m->value && *m->self == 42);
+}
+
+/// Freeing leaves the heap able to hand out one block as big as it
+/// started with, which it can only do if every free block coalesced.
+static void assert_coalesced(shm_segment &seg, std::size_t start)
+{
+	assert(seg.free_bytes() == start);
+	void *all = seg.allocate(start - 16);
+	assert(seg.free_bytes() == 0);
+	seg.deallocate(all);
+	assert(seg.free_bytes() == start);
+}
+
+/// First fit splits a larger free block and reuses holes; frees merge
+/// with the previous block, the next one, or both.
+static void heap_split_and_coalesce()
+{
+	const std::string name = segment_name("heap");
+	shm_segment::remove(name.c_str());
+	shm_segment seg = shm_segment::create(name.c_str(), 1 << 16);
+	const std::size_t start = seg.free_bytes();
+
+	void *a = seg.allocate(100);
+	void *b = seg.allocate(200);
+	void *c = seg.allocate(300);
+	assert(a < b && b < c);
+	assert(seg.free_bytes() < start - 600);
+
+	// a hole, reused by a smaller block that splits it
+	seg.deallocate(b);
+	void *d = seg.allocate(50);
+	assert(d == b);
+	void *e = seg.allocate(50);
+	assert(e > d && e < c);
+
+	// next-only, prev-only and both-sides merges
+	seg.deallocate(d);
+	seg.deallocate(a);
+	seg.deallocate(c);
+	seg.deallocate(e);
+	assert_coalesced(seg, start);
+
+	// freed front to back, back to front, and outside in
+	void *p[16];
+	for (int order = 0; order < 3; ++order) {
+		for (int i = 0; i < 16; ++i)
+			p[i] = seg.allocate(std::size_t(24 + 40 * i));
+		for (int i = 0; i < 16; ++i) {
+			const int j = order == 0   ? i
+				      : order == 1 ? 15 - i
+				      : i % 2 == 0 ? i / 2
+						   : 15 - i / 2;
+			seg.deallocate(p[j]);
+		}
+		assert_coalesced(seg, start);
+	}
+
+	bool threw = false;
+	try {
+		seg.allocate(start);
+	} catch (const std::bad_alloc &) {
+		threw = true;
+	}
+	assert(threw && seg.free_bytes() == start);
+	shm_segment::remove(name.c_str());
+}
+
+/// construct registers a name once; find and destroy go through it.
+static void root_registry()
+{
+	const std::string name = segment_name("roots");
+	shm_segment::remove(name.c_str());
+	shm_segment seg = shm_segment::create(name.c_str(), 1 << 16);
+	const std::size_t start = seg.free_bytes();
+
+	int *x = seg.construct<int>("x", 7);
+	assert(seg.find<int>("x") == x && *x == 7);
+	assert(seg.find<int>("y") == nullptr);
+
+	bool threw = false;
+	try {
+		seg.construct<int>("x", 8);
+	} catch (const std::invalid_argument &) {
+		threw = true;
+	}
+	assert(threw && *seg.find<int>("x") == 7);
+
+	threw = false;
+	try {
+		seg.construct<int>(std::string(100, 'n').c_str(), 1);
+	} catch (const std::length_error &) {
+		threw = true;
+	}
+	assert(threw);
+
+	for (std::size_t i = 1; i < detail::shm_header::max_roots; ++i)
+		seg.construct<int>(("r" + std::to_string(i)).c_str(), int(i));
+	threw = false;
+	try {
+		seg.construct<int>("full", 0);
+	} catch (const std::invalid_argument &) {
+		threw = true;
+	}
+	assert(threw && seg.find<int>("full") == nullptr);
+
+	assert(seg.destroy<int>("x") && !seg.destroy<int>("x"));
+	assert(seg.find<int>("x") == nullptr);
+	seg.construct<int>("full", 0);
+	assert(seg.destroy<int>("full"));
+	for (std::size_t i = 1; i < detail::shm_header::max_roots; ++i)
+		assert(seg.destroy<int>(("r" + std::to_string(i)).c_str()));
+	assert(seg.free_bytes() == start);
+	shm_segment::remove(name.c_str());
+}
+
+/// A child process maps the segment at its own address, finds the
+/// parent's vector by name, checks it and grows it; the parent sees the
+/// child's elements.
+static void shared_between_processes()
+{
+	const std::string name = segment_name("fork");
+	shm_segment::remove(name.c_str());
+	shm_segment seg = shm_segment::create(name.c_str(), 1 << 20);
+	const std::size_t start = seg.free_bytes();
+
+	shm_ints *v = seg.construct<shm_ints>("ids", seg.get_allocator<int>());
+	for (int i = 0; i < 100; ++i)
+		v->push_back(i);
+
+	std::fflush(nullptr);
+	const pid_t child = ::fork();
+	assert(child >= 0);
+	if (child == 0) {
+		int status = 0;
+		try {
+			shm_segment other = shm_segment::open(name.c_str());
+			shm_ints *w = other.find<shm_ints>("ids");
+			if (w == nullptr || w->size() != 100)
+				::_exit(2);
+			for (int i = 0; i < 100; ++i)
+				if ((*w)[std::size_t(i)] != i)
+					::_exit(3);
+			for (int i = 100; i < 10000; ++i)
+				w->push_back(i);
+		} catch (...) {
+			status = 4;
+		}
+		::_exit(status);
+	}
+
+	int status = 0;
+	assert(::waitpid(child, &status, 0) == child);
+	assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	assert(v->size() == 10000);
+	for (int i = 0; i < 10000; ++i)
+		assert((*v)[std::size_t(i)] == i);
+
+	assert(seg.destroy<shm_ints>("ids"));
+	assert(seg.free_bytes() == start);
+	shm_segment::remove(name.c_str());
+}
+
+int main()
+{
+	offset_ptr_arithmetic();
+	heap_split_and_coalesce();
+	root_registry();
+	shared_between_processes();
+	return 0;
+}
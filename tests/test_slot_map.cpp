@@ -0,0 +1,163 @@
+//===-- stevemac::test_slot_map.cpp -------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#undef NDEBUG
+#include "slot_map.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using stevemac::slot_map;
+using stevemac::slot_map_key;
+/// id -> key and value
+using reference_map = std::map<int, std::pair<slot_map_key, std::string>>;
+
+/// Keys and values agree with the reference, and the dense values are
+/// exactly the live ones.
+static void assert_same(const slot_map<std::string> &m,
+			const reference_map &ref)
+{
+	assert(m.size() == ref.size() && m.empty() == ref.empty());
+	for (auto &[id, kv] : ref) {
+		assert(m.contains(kv.first) && m[kv.first] == kv.second);
+		assert(*m.find(kv.first) == kv.second);
+	}
+	std::size_t n = 0;
+	for (auto it = m.begin(); it != m.end(); ++it, ++n) {
+		const slot_map_key k = m.key_of(it);
+		assert(m.contains(k) && &m[k] == &*it);
+	}
+	assert(n == m.size() && m.values().size() == m.size());
+}
+
+/// Random inserts and erases against a std::map of key and value.
+static void against_map()
+{
+	std::mt19937 rng(41);
+	slot_map<std::string> m;
+	reference_map ref;
+	std::vector<slot_map_key> dead;
+	int next = 0;
+	for (int step = 0; step < 20000; ++step) {
+		if (ref.empty() || rng() % 3 != 0) {
+			std::string v = "v" + std::to_string(next);
+			const slot_map_key k = m.insert(v);
+			ref.emplace(next++, std::make_pair(k, v));
+		} else {
+			auto it = ref.begin();
+			std::advance(it, rng() % ref.size());
+			assert(m.erase(it->second.first));
+			dead.push_back(it->second.first);
+			ref.erase(it);
+		}
+		if (step % 211 == 0)
+			assert_same(m, ref);
+	}
+	assert_same(m, ref);
+	for (const slot_map_key &k : dead) {
+		assert(!m.contains(k) && m.find(k) == nullptr && !m.erase(k));
+		bool threw = false;
+		try {
+			m.at(k);
+		} catch (const std::out_of_range &) {
+			threw = true;
+		}
+		assert(threw);
+	}
+}
+
+/// A freed slot is reused for the next insert with a new generation, so
+/// the old key stays stale while the new one works.
+static void reuse_bumps_generation()
+{
+	slot_map<int> m;
+	const slot_map_key a = m.insert(1);
+	const slot_map_key b = m.insert(2);
+	assert(a != b && m[a] == 1 && m[b] == 2);
+
+	assert(m.erase(a));
+	const slot_map_key c = m.insert(3);
+	assert(c.index == a.index && c.generation == a.generation + 1);
+	assert(!m.contains(a) && m.find(a) == nullptr && m[c] == 3);
+	assert(m[b] == 2);
+
+	for (int i = 0; i < 5; ++i) {
+		const slot_map_key old = m.key_of(m.begin());
+		m.erase(old);
+		const slot_map_key now = m.insert(i);
+		assert(!m.contains(old) && m.contains(now));
+	}
+}
+
+/// clear() makes every key stale, and the slots are then reused.
+static void clear_invalidates()
+{
+	slot_map<int> m;
+	std::vector<slot_map_key> keys;
+	for (int i = 0; i < 100; ++i)
+		keys.push_back(m.insert(i));
+	m.clear();
+	assert(m.empty() && m.begin() == m.end());
+	for (const slot_map_key &k : keys)
+		assert(!m.contains(k) && m.find(k) == nullptr);
+
+	for (int i = 0; i < 100; ++i) {
+		const slot_map_key k = m.insert(i);
+		assert(std::none_of(keys.begin(), keys.end(),
+				    [&](const slot_map_key &o) { return o == k; }));
+		assert(m[k] == i);
+	}
+	const slot_map_key none{};
+	assert(!m.contains(none));
+}
+
+/// erase(const_iterator) returns where the moved-in value now is, so an
+/// erase loop visits every value once.
+static void erase_by_iterator()
+{
+	slot_map<int> m;
+	std::map<int, slot_map_key> keys;
+	for (int i = 0; i < 1000; ++i)
+		keys[i] = m.insert(i);
+
+	int visited = 0;
+	for (auto it = m.begin(); it != m.end();) {
+		++visited;
+		if (*it % 2 == 0) {
+			const int v = *it;
+			const auto pos = it - m.begin();
+			it = m.erase(it);
+			assert(it - m.begin() == pos);
+			assert(!m.contains(keys[v]));
+		} else {
+			++it;
+		}
+	}
+	assert(visited == 1000 && m.size() == 500);
+	for (int i = 1; i < 1000; i += 2)
+		assert(m[keys[i]] == i);
+	for (int x : m)
+		assert(x % 2 == 1);
+
+	// erasing the last value returns end()
+	auto last = m.end() - 1;
+	assert(m.erase(last) == m.end() && m.size() == 499);
+}
+
+int main()
+{
+	against_map();
+	reuse_bumps_generation();
+	clear_invalidates();
+	erase_by_iterator();
+	return 0;
+}
@@ -0,0 +1,79 @@
+//===-- stevemac::test_snapshot_vector.cpp ------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#undef NDEBUG
+#include "snapshot_vector.h"
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+using stevemac::snapshot_vector;
+
+/// A snapshot outlives later publishes; writers that lost a race retry.
+static void publish_and_pin()
+{
+	snapshot_vector<int> sv{1, 2, 3};
+	auto old = sv.load();
+	auto w = sv.write();
+	w.edit().push_back(4);
+	sv.publish(stevemac::vector<int>{9});
+	assert(!w.publish());
+	assert(old->size() == 3 && sv.load()->size() == 1);
+
+	sv.update([](stevemac::vector<int> &v) { v.push_back(10); });
+	assert(sv.version() == 2 && sv.load()->size() == 2);
+}
+
+/// Readers see whole versions, never older than one they already saw,
+/// while writers race through update().
+static void concurrent_readers()
+{
+	snapshot_vector<int> sv(stevemac::vector<int>(std::size_t(64), 0));
+	constexpr int writers = 2, readers = 4, rounds = 2000;
+	std::atomic<bool> stop{false};
+
+	std::vector<std::thread> threads;
+	for (int r = 0; r < readers; ++r)
+		threads.emplace_back([&] {
+			auto rd = sv.read();
+			int last = 0;
+			while (!stop.load(std::memory_order_relaxed)) {
+				const auto &v = rd.get();
+				assert(v.size() == 64);
+				for (int x : v)
+					assert(x == v[0]);
+				assert(v[0] >= last);
+				last = v[0];
+			}
+		});
+	std::vector<std::thread> ws;
+	for (int w = 0; w < writers; ++w)
+		ws.emplace_back([&] {
+			for (int i = 0; i < rounds; ++i)
+				sv.update([](stevemac::vector<int> &v) {
+					for (int &x : v)
+						++x;
+				});
+		});
+	for (auto &t : ws)
+		t.join();
+	stop = true;
+	for (auto &t : threads)
+		t.join();
+
+	assert((*sv.load())[0] == writers * rounds);
+	assert(sv.version() == std::uint64_t(writers * rounds));
+}
+
+int main()
+{
+	publish_and_pin();
+	concurrent_readers();
+	return 0;
+}
@@ -0,0 +1,185 @@
+//===-- stevemac::test_stream.cpp ---------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#undef NDEBUG
+#include "stream.h"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace stevemac;
+
+/// N bytes, aligned to 1, so any byte offset is a valid T address.
+template <std::size_t N> using bytes = std::array<unsigned char, N>;
+
+/// Byte counts around the register, four register and head boundaries.
+static const std::size_t lengths[] = {0,   1,   15,  16,  17,  31,  32,
+				      33,  63,  64,  65,  127, 128, 129,
+				      191, 200, 257, 1000, 4099};
+
+/// 64 bytes of guard on each side of every region, which must stay 0xa5.
+constexpr std::size_t guard = 64;
+
+static std::vector<unsigned char> random_bytes(std::size_t n, unsigned seed)
+{
+	std::mt19937 rng(seed);
+	std::vector<unsigned char> v(n);
+	for (auto &b : v)
+		b = static_cast<unsigned char>(rng());
+	return v;
+}
+
+/// guard + 64 + n + guard bytes of 0xa5 from a 64-byte aligned base.
+struct arena {
+	explicit arena(std::size_t n)
+	    : storage(n + 2 * guard + 128, 0xa5),
+	      base(storage.data()
+		   + (64 - reinterpret_cast<std::uintptr_t>(storage.data())
+				   % 64)
+			     % 64),
+	      size(n + 2 * guard + 64)
+	{
+	}
+
+	bool operator==(const arena &o) const
+	{
+		return size == o.size && std::memcmp(base, o.base, size) == 0;
+	}
+
+	std::vector<unsigned char> storage;
+	unsigned char *base;
+	std::size_t size;
+};
+
+#if STEVEMAC_SIMD_X86
+using copy_kernel = void (*)(unsigned char *, const unsigned char *,
+			     std::size_t);
+using fill_kernel = void (*)(unsigned char *, const unsigned char *,
+			     std::size_t, std::size_t);
+
+/// The kernels simd_dispatch_level() lets this machine run.
+static std::vector<copy_kernel> copy_kernels()
+{
+	std::vector<copy_kernel> k;
+	if (simd_dispatch_level() >= simd_level::sse41)
+		k.push_back(detail::stream_copy_sse2);
+	if (simd_dispatch_level() == simd_level::avx2)
+		k.push_back(detail::stream_copy_avx2);
+	return k;
+}
+static std::vector<fill_kernel> fill_kernels()
+{
+	std::vector<fill_kernel> k;
+	if (simd_dispatch_level() >= simd_level::sse41)
+		k.push_back(detail::stream_fill_sse2);
+	if (simd_dispatch_level() == simd_level::avx2)
+		k.push_back(detail::stream_fill_avx2);
+	return k;
+}
+
+/// Each copy kernel matches memcpy for every destination offset within
+/// a cache line, several source offsets, and lengths that leave a head,
+/// a tail, both or neither; nothing outside the destination is written.
+static void copy_kernels_match_memcpy()
+{
+	const std::size_t most = 4099;
+	const std::vector<unsigned char> src = random_bytes(most + 64, 43);
+	for (copy_kernel kernel : copy_kernels())
+		for (std::size_t off = 0; off < 64; ++off)
+			for (std::size_t src_off : {0, 1, 8, 31})
+				for (std::size_t n : lengths) {
+					const unsigned char *from =
+						src.data() + src_off;
+					arena got(most), want(most);
+					unsigned char *g = got.base + guard;
+					unsigned char *w = want.base + guard;
+					kernel(g + off, from, n);
+					std::memcpy(w + off, from, n);
+					assert(got == want);
+				}
+}
+
+/// Each fill kernel matches std::fill_n for every element size it takes,
+/// at every element-aligned offset within a cache line.  The value's
+/// bytes all differ, so a 32 byte T filled by the SSE2 kernel only comes
+/// out right if it alternates the two halves of the pattern.
+template <std::size_t N> static void fill_kernels_match_fill_n()
+{
+	using T = bytes<N>;
+	T value;
+	for (std::size_t i = 0; i < N; ++i)
+		value[i] = static_cast<unsigned char>(0x10 + i);
+	unsigned char pattern[32];
+	for (std::size_t i = 0; i < 32; i += N)
+		std::memcpy(pattern + i, &value, N);
+
+	for (fill_kernel kernel : fill_kernels())
+		for (std::size_t off = 0; off < 64; off += N)
+			for (std::size_t len : lengths) {
+				const std::size_t n = len / N;
+				arena got(len), want(len);
+				unsigned char *g = got.base + guard + off;
+				T *w = reinterpret_cast<T *>(want.base + guard
+							     + off);
+				kernel(g, pattern, N, n * N);
+				std::fill_n(w, n, value);
+				assert(got == want);
+			}
+}
+#endif
+
+/// stream_copy and stream_fill agree with memcpy and fill_n whatever the
+/// level, including destinations that are not aligned to sizeof(T), which
+/// fill hands to fill_n.
+template <std::size_t N> static void public_interface()
+{
+	using T = bytes<N>;
+	const std::vector<unsigned char> src = random_bytes(4099 * N, N);
+	T value;
+	for (std::size_t i = 0; i < N; ++i)
+		value[i] = static_cast<unsigned char>(0xc0 + i);
+
+	for (std::size_t off : {0, 1, 3, 8, 16, 33})
+		for (std::size_t n : lengths) {
+			arena got(n * N), want(n * N);
+			T *g = reinterpret_cast<T *>(got.base + guard + off);
+			T *w = reinterpret_cast<T *>(want.base + guard + off);
+			const T *s = reinterpret_cast<const T *>(src.data());
+
+			stream_copy(s, n, g);
+			std::memcpy(w, s, n * N);
+			assert(got == want);
+
+			stream_fill(g, n, value);
+			std::fill_n(w, n, value);
+			assert(got == want);
+		}
+}
+
+int main()
+{
+#if STEVEMAC_SIMD_X86
+	copy_kernels_match_memcpy();
+	fill_kernels_match_fill_n<1>();
+	fill_kernels_match_fill_n<2>();
+	fill_kernels_match_fill_n<4>();
+	fill_kernels_match_fill_n<8>();
+	fill_kernels_match_fill_n<16>();
+	fill_kernels_match_fill_n<32>();
+#endif
+	public_interface<1>();
+	public_interface<2>();
+	public_interface<4>();
+	public_interface<8>();
+	public_interface<16>();
+	public_interface<32>();
+	public_interface<24>();
+	return 0;
+}
@@ -0,0 +1,165 @@
+//===-- stevemac::test_vector_bool.cpp ----------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#undef NDEBUG
+#include "vector_bool.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+using bits = stevemac::vector<bool>;
+
+static void assert_same(const bits &v, const std::vector<bool> &ref)
+{
+	assert(v.size() == ref.size() && v.empty() == ref.empty());
+	assert(v.word_count() == (ref.size() + 63) / 64);
+	std::size_t set = 0;
+	for (std::size_t i = 0; i < ref.size(); ++i) {
+		assert(v[i] == ref[i]);
+		set += ref[i];
+	}
+	assert(v.count() == set);
+	assert(std::equal(v.begin(), v.end(), ref.begin(), ref.end()));
+	// the bits past size() stay zero
+	if (v.size() % 64 != 0)
+		assert((v.data()[v.word_count() - 1] >> (v.size() % 64)) == 0);
+}
+
+/// find_first/find_next visit exactly the set bits, in order.
+static void assert_finds(const bits &v, const std::vector<bool> &ref)
+{
+	std::size_t i = v.find_first();
+	for (std::size_t j = 0; j < ref.size(); ++j)
+		if (ref[j]) {
+			assert(i == j);
+			i = v.find_next(i);
+		}
+	assert(i == v.size());
+}
+
+/// Random push_back, pop_back, resize, writes, copies and moves against
+/// std::vector<bool>, across word boundaries.
+static void random_operations()
+{
+	std::mt19937_64 rng(31);
+	bits v;
+	std::vector<bool> ref;
+	for (int step = 0; step < 20000; ++step) {
+		switch (rng() % 8) {
+		case 0:
+		case 1:
+		case 2: {
+			const bool x = rng() & 1;
+			v.push_back(x);
+			ref.push_back(x);
+			break;
+		}
+		case 3:
+			if (!ref.empty()) {
+				assert(v.back() == ref.back());
+				v.pop_back();
+				ref.pop_back();
+			}
+			break;
+		case 4: {
+			const std::size_t n = rng() % 300;
+			const bool x = rng() & 1;
+			v.resize(n, x);
+			ref.resize(n, x);
+			break;
+		}
+		case 5:
+			if (!ref.empty()) {
+				const std::size_t i = rng() % ref.size();
+				v[i] = !v[i];
+				ref[i] = !ref[i];
+				v.at(i).flip();
+				ref[i].flip();
+			}
+			break;
+		case 6: {
+			bits copy(v);
+			bits moved(std::move(copy));
+			v = moved;
+			bits assigned;
+			assigned = std::move(moved);
+			assert(assigned == v);
+			break;
+		}
+		case 7:
+			if (rng() % 16 == 0) {
+				v.clear();
+				ref.clear();
+			}
+			break;
+		}
+		if (step % 97 == 0) {
+			assert_same(v, ref);
+			assert_finds(v, ref);
+		}
+	}
+	assert_same(v, ref);
+	v.shrink_to_fit();
+	assert_same(v, ref);
+}
+
+/// &=, |=, ^=, ~, flip() and the binary operators against the same
+/// operations done bit by bit, for sizes around the 4 word AVX2 step.
+static void word_operations()
+{
+	std::mt19937_64 rng(7);
+	for (std::size_t n : {0, 1, 63, 64, 65, 255, 256, 257, 1000, 4097}) {
+		bits a(n), b(n);
+		std::vector<bool> ra(n), rb(n);
+		for (std::size_t i = 0; i < n; ++i) {
+			ra[i] = a[i] = rng() & 1;
+			rb[i] = b[i] = rng() % 3 == 0;
+		}
+
+		auto both = [&](auto op) {
+			std::vector<bool> r(n);
+			for (std::size_t i = 0; i < n; ++i)
+				r[i] = op(bool(ra[i]), bool(rb[i]));
+			return r;
+		};
+		assert_same(a & b, both([](bool x, bool y) { return x && y; }));
+		assert_same(a | b, both([](bool x, bool y) { return x || y; }));
+		assert_same(a ^ b, both([](bool x, bool y) { return x != y; }));
+		const std::vector<bool> inv =
+			both([](bool x, bool) { return !x; });
+		assert_same(~a, inv);
+		assert_finds(~a, inv);
+
+		bits c(a);
+		c.flip();
+		assert(c == ~a);
+		c ^= c;
+		assert(c.count() == 0 && c.find_first() == n);
+		c |= b;
+		assert(c == b && (c != a || a == b));
+		c &= a;
+		assert_same(c, both([](bool x, bool y) { return x && y; }));
+	}
+
+	bits all(200, true);
+	assert(all.count() == 200 && all.find_first() == 0
+	       && all.find_next(199) == 200);
+	all.resize(130);
+	assert(all.count() == 130);
+	all.resize(200);
+	assert(all.count() == 130 && !all[130] && all.find_next(129) == 200);
+}
+
+int main()
+{
+	random_operations();
+	word_operations();
+	return 0;
+}
@@ -0,0 +1,170 @@
+//===-- stevemac::test_vector_builder.cpp -------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#undef NDEBUG
+#include "vector_builder.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using stevemac::parallel_policy;
+using stevemac::vector_builder;
+
+/// Thread number and the index within that thread.
+using tagged = std::pair<unsigned, std::size_t>;
+
+/// Runs work(t) on threads threads and waits for all of them.
+template <class Work> static void on_threads(unsigned threads, Work work)
+{
+	std::vector<std::thread> pool;
+	for (unsigned t = 0; t < threads; ++t)
+		pool.emplace_back(work, t);
+	for (auto &th : pool)
+		th.join();
+}
+
+/// Each thread's elements are one contiguous run in the order it
+/// appended them, and every element arrives exactly once.
+static void assert_runs(const stevemac::vector<tagged> &out, unsigned threads,
+			std::size_t per_thread)
+{
+	assert(out.size() == threads * per_thread);
+	std::vector<bool> seen(threads, false);
+	for (std::size_t i = 0; i < out.size(); i += per_thread) {
+		const unsigned t = out[i].first;
+		assert(t < threads && !seen[t]);
+		seen[t] = true;
+		for (std::size_t j = 0; j < per_thread; ++j)
+			assert(out[i + j] == tagged(t, j));
+	}
+}
+
+/// Threads append through push_back, emplace_back and local(); finish()
+/// on many threads, and on the calling one, returns all of it.
+static void many_threads()
+{
+	const unsigned threads = 8;
+	const std::size_t per_thread = 20000;
+	for (const parallel_policy policy :
+	     {parallel_policy{4, 0}, parallel_policy{1, 0},
+	      stevemac::par}) {
+		vector_builder<tagged> b;
+		on_threads(threads, [&](unsigned t) {
+			for (std::size_t j = 0; j < per_thread; ++j)
+				if (t % 3 == 0)
+					b.push_back(tagged(t, j));
+				else if (t % 3 == 1)
+					b.emplace_back(t, j);
+				else
+					b.local().push_back(tagged(t, j));
+		});
+		assert(b.size() == threads * per_thread);
+		assert_runs(b.finish(policy), threads, per_thread);
+		assert(b.size() == 0 && b.finish().empty());
+	}
+}
+
+/// local(slot) concatenates by slot number, whatever order the slots
+/// were filled in, and skips slots nobody used.
+static void fixed_slots()
+{
+	vector_builder<std::size_t> b;
+	const std::size_t slots[] = {9, 2, 5, 0};
+	on_threads(4, [&](unsigned t) {
+		auto &part = b.local(slots[t]);
+		for (std::size_t j = 0; j < 1000; ++j)
+			part.push_back(slots[t] * 1000 + j);
+	});
+	const auto out = b.finish(parallel_policy{3, 0});
+	assert(out.size() == 4000);
+	const std::size_t order[] = {0, 2, 5, 9};
+	for (std::size_t i = 0; i < out.size(); ++i)
+		assert(out[i] == order[i / 1000] * 1000 + i % 1000);
+}
+
+/// A move constructor that may throw takes the calling thread path and
+/// throws on the given move.
+struct fragile {
+	static int moves_left;
+
+	explicit fragile(int v) : value(v) {}
+	fragile(const fragile &) = default;
+	fragile(fragile &&o) : value(o.value)
+	{
+		if (moves_left >= 0 && moves_left-- == 0)
+			throw std::runtime_error("move");
+	}
+
+	int value;
+};
+int fragile::moves_left = -1;
+
+/// The serial fallback keeps slot order; when a move throws, the builder
+/// keeps every part and the next finish() succeeds.
+static void throwing_move()
+{
+	static_assert(!std::is_nothrow_move_constructible_v<fragile>);
+	vector_builder<fragile> b;
+	for (std::size_t slot = 0; slot < 3; ++slot) {
+		auto &part = b.local(slot);
+		part.reserve(100);
+		for (int j = 0; j < 100; ++j)
+			part.emplace_back(int(slot) * 100 + j);
+	}
+
+	fragile::moves_left = 150;
+	bool threw = false;
+	try {
+		b.finish();
+	} catch (const std::runtime_error &) {
+		threw = true;
+	}
+	assert(threw && b.size() == 300);
+
+	fragile::moves_left = -1;
+	const auto out = b.finish();
+	assert(out.size() == 300 && b.size() == 0);
+	// the first 150 were moved from, which for int is a copy
+	for (int i = 0; i < 300; ++i)
+		assert(out[std::size_t(i)].value == i);
+}
+
+/// clear() drops the parts and forgets the threads' cached part, so the
+/// next append starts a new one.
+static void clear_resets()
+{
+	vector_builder<std::string> b;
+	b.push_back("a");
+	b.local(3).push_back("b");
+	assert(b.size() == 2);
+	b.clear();
+	assert(b.size() == 0 && b.finish().empty());
+
+	b.push_back("c");
+	b.emplace_back(2, 'd');
+	const auto out = b.finish();
+	assert(out.size() == 2 && out[0] == "c" && out[1] == "dd");
+
+	// a thread's cached part belongs to one builder only
+	vector_builder<std::string> other;
+	other.push_back("e");
+	b.push_back("f");
+	assert(other.size() == 1 && b.size() == 1);
+}
+
+int main()
+{
+	many_threads();
+	fixed_slots();
+	throwing_move();
+	clear_resets();
+	return 0;
+}
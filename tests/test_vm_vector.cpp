@@ -0,0 +1,58 @@
+//===-- stevemac::test_vm_vector.cpp ------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#undef NDEBUG
+#include "vm_vector.h"
+#include <cassert>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using stevemac::vm_vector;
+
+/// A zero reservation is an empty, unmapped vector, not a failed mmap.
+static void zero_reservation()
+{
+	vm_vector<int> z(0);
+	assert(z.empty() && z.max_size() == 0 && z.data() == nullptr);
+	bool threw = false;
+	try {
+		z.push_back(1);
+	} catch (const std::length_error &) {
+		threw = true;
+	}
+	assert(threw && z.empty());
+	z.shrink_to_fit();
+
+	vm_vector<int> a(1000);
+	a.push_back(7);
+	vm_vector<int> b(std::move(a));
+	vm_vector<int> c(a); // copy of a moved-from vector
+	assert(c.empty() && c.max_size() == 0);
+	c = a;
+	assert(b.size() == 1 && b[0] == 7);
+}
+
+static void stable_addresses()
+{
+	vm_vector<std::string> v(1 << 20);
+	v.push_back("first");
+	const std::string *p = &v[0];
+	for (int i = 0; i < 100000; ++i)
+		v.push_back(std::to_string(i));
+	assert(p == &v[0] && *p == "first" && v.back() == "99999");
+	v.resize(10);
+	v.shrink_to_fit();
+	v.push_back("again");
+	assert(v.size() == 11 && p == v.data());
+}
+
+int main()
+{
+	zero_reservation();
+	stable_addresses();
+	return 0;
+}
@@ -0,0 +1,44 @@
+//===-- stevemac::vector.cppm -------------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+/// C++20 module interface: `import stevemac.vector;` instead of including
+/// vector.h.  The header is parsed once into the module's BMI.
+module;
+#include "execution.h"
+#include "vector.h"
+#include "vector_bool.h"
+export module stevemac.vector;
+
+export namespace stevemac
+{
+using stevemac::vector;
+using stevemac::vector_iterator;
+using stevemac::bit_iterator;
+using stevemac::bit_reference;
+using stevemac::operator==;
+using stevemac::operator!=;
+using stevemac::operator<;
+using stevemac::operator>;
+using stevemac::operator<=;
+using stevemac::operator>=;
+using stevemac::operator&;
+using stevemac::operator|;
+using stevemac::operator^;
+using stevemac::parallel_policy;
+using stevemac::par;
+using stevemac::for_each_chunk;
+using stevemac::reclaim_policy;
+using stevemac::reclaim_stats;
+using stevemac::reclaim_metrics;
+using stevemac::trim_all;
+using stevemac::capacity_hint_site;
+using stevemac::capacity_hint_stats;
+using stevemac::capacity_hint_metrics;
+using stevemac::stream_copy;
+using stevemac::stream_fill;
+using stevemac::stream_threshold;
+using stevemac::default_stream_threshold;
+} // namespace stevemac
@@ -5,24 +5,66 @@
 // Author: Stephen E. MacKenzie
 //===----------------------------------------------------------------------===//
 #pragma once
+#include "capacity_hint.h"
 #include "iterator.h"
+#include "reclaim.h"
+#include "stream.h"
 #include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <exception>
 #include <initializer_list>
-#include <iostream>
+#include <limits>
 #include <memory>
-#include <numeric>
-#include <numeric>
-#include <stdarg.h>
-#include <string>
+#include <new>
+#include <ranges>
+#include <span>
+#include <stdexcept>
 #include <type_traits>
 #include <utility>
-#include <utility>
 using std::swap;
 
 namespace stevemac
 {
+/// The parallel overloads below take a policy from execution.h, whose
+/// <thread> and <mutex> only their callers should pay for; they include
+/// it for par anyway.  vector.h declares just what those overloads use.
+struct parallel_policy;
+
+namespace detail
+{
+template <class Allocator, class Pointer, class... Args>
+void parallel_construct(const parallel_policy &policy, Allocator &a,
+			Pointer first, std::size_t n, const Args &... args);
+
+/// An allocator may round capacities up by providing a static
+/// pad_capacity(n); vector::reallocate applies it to every allocation.
+template <class Allocator, class = void>
+struct pads_capacity : std::false_type {
+};
+
+template <class Allocator>
+struct pads_capacity<Allocator,
+		     std::void_t<decltype(Allocator::pad_capacity(
+			     typename Allocator::size_type()))>>
+    : std::true_type {
+};
+
+/// Whether the allocator has its own construct(T *, const T &); if not,
+/// copying trivially copyable T may skip it and copy bytes.
+template <class Allocator, class T, class = void>
+struct customizes_construct : std::false_type {
+};
+
+template <class Allocator, class T>
+struct customizes_construct<
+	Allocator, T,
+	std::void_t<decltype(std::declval<Allocator &>().construct(
+		std::declval<T *>(), std::declval<const T &>()))>>
+    : std::true_type {
+};
+} // namespace detail
+
 ///===----------------------------------------------------------------------===//
 ///
 /// stevemac::vector
@@ -67,6 +109,15 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 		_begin = _end = nullptr;
 	}
 
+	/// Empty vector whose first allocation is sized by what earlier
+	/// vectors from site grew to, see capacity_hint.h.  It reports its
+	/// own size to site when destroyed.
+	explicit vector(capacity_hint_site &site,
+			const allocator_type &a = allocator_type()) noexcept
+	    : _allocator(a), _hint_site(&site)
+	{
+	}
+
 	/// Effects: Constructs a vector with default-inserted elements.
 	/// Requires: T shall be DefaultInsertible into *this.
 	explicit vector(size_type n,
@@ -79,7 +130,7 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 		_end = _begin;
 
 		for (size_type i = 0; i < _size; i++)
-			_allocator.construct(_end++, T());
+			alloc_traits::construct(_allocator, std::to_address(_end++), T());
 	}
 
 	/// Effects: Constructs a vector with n copies of value.
@@ -91,6 +142,25 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 		assign(n, value);
 	}
 
+	/// Parallel first-touch versions of the two constructors above: the
+	/// elements are constructed in one chunk per thread, each later chunk
+	/// starting on a page boundary of the buffer, see execution.h.  Strong
+	/// guarantee, nothing leaks if a constructor throws on any thread.
+	vector(const parallel_policy &policy, size_type n,
+	       const allocator_type &a = allocator_type())
+	    : _allocator(a)
+	{
+		parallel_init(policy, n);
+	}
+
+	vector(const parallel_policy &policy, size_type n,
+	       const_reference value,
+	       const allocator_type &a = allocator_type())
+	    : _allocator(a)
+	{
+		parallel_init(policy, n, value);
+	}
+
 	/// Effects: Constructs a vector equal to the range [first,last].
 	/// Complexity is conditional, pivots on Iter type, see 23.3.6.2.10
 	/// std::_RequireInputIterator takes is an enable_if shorthand that
@@ -113,20 +183,24 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 	}
 	// copy ctors
 	vector(const vector &other)
+	    : _allocator(alloc_traits::select_on_container_copy_construction(
+		      other._allocator))
 	{
 		if (this != &other)
 			*this = other;
 	}
 
-	vector(vector &&other) noexcept
+	vector(vector &&other) noexcept : _allocator(other._allocator)
 	{
 		if (this != &other) {
 			_begin = other._begin;
-			_end = other._begin;
+			_end = other._end;
 			_size = other._size;
 			_capacity = other._capacity;
 			_size_n_alloc = other._size_n_alloc;
 			_allocator = other._allocator;
+			_reclaim = std::move(other._reclaim);
+			_hint_site = std::exchange(other._hint_site, nullptr);
 			other._begin = nullptr;
 			other._end = nullptr;
 			other._size = 0;
@@ -145,11 +219,13 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 	{
 		if (this != &other) {
 			_begin = other._begin;
-			_end = other._begin;
+			_end = other._end;
 			_size = other._size;
 			_capacity = other._capacity;
 			_size_n_alloc = other._size_n_alloc;
 			_allocator = other._allocator;
+			_reclaim = std::move(other._reclaim);
+			_hint_site = std::exchange(other._hint_site, nullptr);
 			other._begin = nullptr;
 			other._end = nullptr;
 			other._size = 0;
@@ -173,6 +249,8 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 	/// the Authors")
 	~vector()
 	{
+		if (_hint_site != nullptr)
+			report_hint();
 		if (_begin != nullptr) {
 			range_destroy(_begin, _end);
 			_allocator.deallocate(_begin, _capacity);
@@ -186,8 +264,11 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 
 		/// If const vector& other is empty, just reset to default
 		/// constructed per 23.3.6.2.1 and 2
-		if (other.capacity() == 0 && _capacity > 0) {
-			_allocator.deallocate(_begin, _capacity);
+		if (other.capacity() == 0) {
+			if (_begin != nullptr) {
+				range_destroy(_begin, _end);
+				_allocator.deallocate(_begin, _capacity);
+			}
 
 			_size = _capacity = 0;
 			_begin = _end = nullptr;
@@ -204,13 +285,19 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 
 	vector &operator=(vector &&other)
 	{
-		if (other != this) {
+		if (&other != this) {
+			if (_begin != nullptr) {
+				range_destroy(_begin, _end);
+				_allocator.deallocate(_begin, _capacity);
+			}
 			_begin = other._begin;
-			_end = other._begin;
+			_end = other._end;
 			_size = other._size;
 			_capacity = other._capacity;
 			_size_n_alloc = other._size_n_alloc;
 			_allocator = other._allocator;
+			_reclaim = std::move(other._reclaim);
+			_hint_site = std::exchange(other._hint_site, nullptr);
 			other._begin = nullptr;
 			other._end = nullptr;
 			other._size = 0;
@@ -228,7 +315,7 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 		pointer tmp = reallocate(_capacity);
 
 		for (size_type i = 0; i < _size; i++)
-			_allocator.construct(&tmp[i], *(il.begin() + i));
+			alloc_traits::construct(_allocator, &tmp[i], *(il.begin() + i));
 
 		std::swap(_begin, tmp);
 		_allocator.deallocate(tmp, delcap);
@@ -251,7 +338,7 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 		_end = _begin;
 
 		while (first != last)
-			_allocator.construct(_end++, *(first++));
+			alloc_traits::construct(_allocator, std::to_address(_end++), *(first++));
 	}
 
 	void assign(iterator first, iterator last)
@@ -265,7 +352,7 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 		_end = _begin;
 
 		while (first != last)
-			_allocator.construct(_end++, *(first++));
+			alloc_traits::construct(_allocator, std::to_address(_end++), *(first++));
 	}
 
 	void assign(size_type n, const T &u)
@@ -277,8 +364,35 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 		_end = _begin;
 		_size = n;
 
+		if (stream_fill_construct(_begin, n, u)) {
+			_end = _begin + n;
+			return;
+		}
 		for (size_type i = 0; i < n; i++)
-			_allocator.construct(_end++, u);
+			alloc_traits::construct(_allocator, std::to_address(_end++), u);
+	}
+
+	/// Parallel first-touch assign, see execution.h.  If n exceeds the
+	/// capacity the old buffer is released first, so the new one is
+	/// touched only by the filling threads.
+	void assign(const parallel_policy &policy, size_type n, const T &u)
+	{
+		range_destroy(_begin, _end);
+		_size = 0;
+		_end = _begin;
+
+		if (n > _capacity) {
+			if (_begin != nullptr)
+				_allocator.deallocate(_begin, _capacity);
+			_begin = _end = nullptr;
+			_capacity = 0;
+			parallel_init(policy, n, u);
+			return;
+		}
+
+		parallel_construct(policy, _begin, n, u);
+		_size = n;
+		_end = _begin + _size;
 	}
 
 	void assign(const std::initializer_list<T> &il)
@@ -291,7 +405,7 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 		_end = _begin;
 
 		for (auto &i : il)
-			_allocator.construct(_end++, i);
+			alloc_traits::construct(_allocator, std::to_address(_end++), i);
 	}
 
 	allocator_type get_allocator() const noexcept
@@ -322,20 +436,20 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 
 	reverse_iterator rbegin() noexcept
 	{
-		return reverse_iterator(_begin);
+		return reverse_iterator(end());
 	}
 	const_reverse_iterator rbegin() const noexcept
 	{
-		return const_reverse_iterator(_begin);
+		return const_reverse_iterator(end());
 	}
 
 	reverse_iterator rend() noexcept
 	{
-		return reverse_iterator(_end);
+		return reverse_iterator(begin());
 	}
 	const_reverse_iterator rend() const noexcept
 	{
-		return const_reverse_iterator(_end);
+		return const_reverse_iterator(begin());
 	}
 
 	const_iterator cbegin() const noexcept
@@ -349,11 +463,11 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 
 	const_reverse_iterator crbegin() const noexcept
 	{
-		return const_reverse_iterator(_begin);
+		return const_reverse_iterator(end());
 	}
 	const_reverse_iterator crend() const noexcept
 	{
-		return const_reverse_iterator(_end);
+		return const_reverse_iterator(begin());
 	}
 
 	//===----------------------------------------------------------------------===//
@@ -386,7 +500,7 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 
 		if (n > _capacity) // otherwise do nothing, reserve nor for
 				   // reducing.
-			resize_helper(n, false, T());
+			grow_to(n, false);
 	}
 
 	/// T shall be MoveInsertable into this
@@ -396,8 +510,6 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 	{
 		if (_size < _capacity)
 			alloc_move_swap(_size, _capacity, _size, _begin);
-
-		_capacity = _size;
 	}
 
 	/// Effects: If sz <= size(), equivalent to calling pop_back()
@@ -415,6 +527,19 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 		resize_helper(sz, true, c);
 	}
 
+	/// Parallel first-touch resize: the new elements are constructed in
+	/// chunks across threads, see execution.h.  Existing elements are
+	/// relocated on the calling thread if the buffer has to grow.
+	void resize(const parallel_policy &policy, size_type sz)
+	{
+		parallel_resize(policy, sz);
+	}
+
+	void resize(const parallel_policy &policy, size_type sz, const T &c)
+	{
+		parallel_resize(policy, sz, c);
+	}
+
 	//===----------------------------------------------------------------------===//
 	/// element access
 	///
@@ -466,11 +591,143 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 	//===----------------------------------------------------------------------===//
 	T *data() noexcept
 	{
-		return _begin;
+		return std::to_address(_begin);
 	}
 	const T *data() const noexcept
 	{
-		return _begin;
+		return std::to_address(_begin);
+	}
+	//===----------------------------------------------------------------------===//
+	/// spare capacity
+	/// For filling the vector from read(2) and friends without a bounce
+	/// buffer: write into spare_capacity(), then commit() what was written.
+	//===----------------------------------------------------------------------===//
+	/// Like resize, but new elements are default-initialized, which for
+	/// trivial T means left as they are: nothing is zeroed.
+	void resize_for_overwrite(size_type n)
+	{
+		if (n <= _size) {
+			range_destroy(_begin + n, _end);
+		} else {
+			grow_to(n, false);
+			if constexpr (!std::is_trivially_default_constructible_v<T>) {
+				pointer p = _end;
+				try {
+					for (; p != _begin + n; ++p)
+						::new (static_cast<void *>(std::to_address(p))) T;
+				} catch (...) {
+					range_destroy(_end, p);
+					throw;
+				}
+			}
+		}
+		_size = n;
+		_end = _begin + _size;
+	}
+
+	/// The raw, unconstructed slots [size(), capacity()).
+	std::span<T> spare_capacity() noexcept
+	{
+		return std::span<T>(std::to_address(_end), _capacity - _size);
+	}
+
+	/// Same, first growing by the usual growth policy so that at least
+	/// n slots are free.
+	std::span<T> spare_capacity(size_type n)
+	{
+		if (_capacity - _size < n)
+			grow_to(_size + n, true);
+		return spare_capacity();
+	}
+
+	/// Adopts the first n slots of spare_capacity() as elements.
+	/// Requires: n <= capacity() - size() and those n objects have been
+	/// constructed (for trivial T: written).
+	void commit(size_type n) noexcept
+	{
+		assert(n <= _capacity - _size);
+		_size += n;
+		_end += n;
+	}
+	//===----------------------------------------------------------------------===//
+	/// bulk append
+	/// Appending k elements with insert(end(), ...) shifts nothing but
+	/// still goes through the insert offset arithmetic, and a push_back loop
+	/// checks capacity k times.  These grow at most once, by the push_back
+	/// growth policy, and construct straight into the tail; trivially
+	/// copyable T without a custom allocator construct is copied with
+	/// memcpy / filled with fill_n (memset for bytes), or streamed past
+	/// stream_threshold().
+	/// Strong guarantee: if constructing a new element throws, the vector
+	/// is left as it was.  When the buffer has to grow the new elements are
+	/// built in the new buffer before the old ones move, so the source may
+	/// alias *this.
+	//===----------------------------------------------------------------------===//
+	/// Appends the elements of r.  Ranges that are not sized or forward
+	/// are appended one push_back at a time, still strongly.
+	template <std::ranges::input_range R> void append_range(R &&r)
+	{
+		using ref = std::ranges::range_reference_t<R>;
+		if constexpr (std::ranges::forward_range<R>
+			      || std::ranges::sized_range<R>) {
+			const size_type n = size_type(std::ranges::distance(r));
+			if constexpr (std::ranges::contiguous_range<R>
+				      && std::is_same_v<std::remove_cvref_t<ref>, T>
+				      && detail::streamable_v<T>
+				      && !detail::customizes_construct<Allocator,
+								       T>::value) {
+				const T *src = std::ranges::data(r);
+				append_with(n, [&](pointer dst) {
+					if (detail::stream_worthwhile(n * sizeof(T)))
+						stream_copy(src, n, std::to_address(dst));
+					else
+						std::memcpy(
+							static_cast<void *>(
+								std::to_address(dst)),
+							src, n * sizeof(T));
+				});
+			} else {
+				append_with(n, [&](pointer dst) {
+					auto it = std::ranges::begin(r);
+					construct_n(dst, n,
+						    [&]() -> ref { return *it++; });
+				});
+			}
+		} else {
+			const size_type oldsize = _size;
+			try {
+				for (auto &&x : r)
+					emplace_back(std::forward<decltype(x)>(x));
+			} catch (...) {
+				range_destroy(_begin + oldsize, _end);
+				_size = oldsize;
+				_end = _begin + oldsize;
+				throw;
+			}
+		}
+	}
+
+	/// Appends n copies of value; value may be an element of *this.
+	void append_n(size_type n, const T &value)
+	{
+		append_with(n, [&](pointer dst) {
+			if constexpr (detail::streamable_v<T>
+				      && !detail::customizes_construct<Allocator,
+								       T>::value) {
+				if (!stream_fill_construct(dst, n, value))
+					std::uninitialized_fill_n(std::to_address(dst), n,
+								  value);
+			} else {
+				construct_n(dst, n,
+					    [&]() -> const T & { return value; });
+			}
+		});
+	}
+
+	/// Appends f(), f(), ... n times, in order.
+	template <class F> void generate_back_n(size_type n, F f)
+	{
+		append_with(n, [&](pointer dst) { construct_n(dst, n, f); });
 	}
 	//===----------------------------------------------------------------------===//
 	/// 23.3.6.5 modifiers
@@ -502,7 +759,7 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 			insert_resize(set_new_capacity(_size + n, true), offset,
 				      n, val);
 		else
-			insert_inplace(offset, 1, val);
+			insert_inplace(offset, n, val);
 
 		return position;
 	}
@@ -598,9 +855,11 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 			const size_type oldsize = _size;
 			set_new_capacity(1, true);
 			alloc_move_swap(_capacity, oldcap, oldsize, _begin);
+			if (_hint_site != nullptr)
+				++capacity_hint_metrics().growths;
 		}
 
-		_allocator.construct(_end++, val);
+		alloc_traits::construct(_allocator, std::to_address(_end++), val);
 		_size++;
 	}
 	/// Qualfied strong guarantee, if move ctor of a non-CopyInsertable T,
@@ -615,25 +874,27 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 			const size_type oldsize = _size;
 			set_new_capacity(1, true);
 			alloc_move_swap(_capacity, oldcap, oldsize, _begin);
+			if (_hint_site != nullptr)
+				++capacity_hint_metrics().growths;
 		}
 
-		_allocator.construct(_end++, std::move(val));
+		alloc_traits::construct(_allocator, std::to_address(_end++), std::move(val));
 		_size++;
 	}
 
 	void pop_back()
 	{
-		pointer del = _end;
 		_size--;
 		_end--;
-		_allocator.destroy(del);
+		alloc_traits::destroy(_allocator, std::to_address(_end));
+		maybe_reclaim();
 	}
 	/// erase
 	/// see 23.3.6.5.3,4,5
 	iterator erase(const_iterator position)
 	{
 		iterator p = position; // non-const iterator for +1 in move
-		_allocator.destroy(
+		alloc_traits::destroy(_allocator, 
 			&(*p)); // * op converts iterator to address of T&
 		std::move(p + 1, end(), p);
 		_end--;
@@ -657,13 +918,33 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 		return last;
 	}
 
-	/// capacity remains unchanged
+	/// capacity remains unchanged, unless a reclaim policy decides
+	/// otherwise, see set_reclaim_policy.
 	void clear() noexcept
 	{
-
+		range_destroy(_begin, _end);
 		_size = 0;
 		_size_n_alloc = 0;
 		_end = _begin;
+		maybe_reclaim();
+	}
+
+	/// Opt in to automatic capacity reclamation, see reclaim.h.  The
+	/// policy is not copied with the vector, it does follow moves.
+	/// Throws invalid_argument for a zero low_water_divisor or headroom.
+	void set_reclaim_policy(const reclaim_policy &policy = reclaim_policy())
+	{
+		if (policy.low_water_divisor == 0 || policy.headroom == 0)
+			throw std::invalid_argument("set_reclaim_policy: policy");
+		if (!_reclaim)
+			_reclaim = std::make_unique<detail::reclaim_state>();
+		_reclaim->policy = policy;
+		_reclaim->streak = 0;
+	}
+
+	void clear_reclaim_policy() noexcept
+	{
+		_reclaim.reset();
 	}
 	//===----------------------------------------------------------------------===//
 	/// 23.3.6.6 specialized algorithms
@@ -679,6 +960,8 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 			std::swap(_capacity, other._capacity);
 			std::swap(_allocator, other._allocator);
 			std::swap(_size_n_alloc, other._size_n_alloc);
+			std::swap(_reclaim, other._reclaim);
+			std::swap(_hint_site, other._hint_site);
 		}
 	}
 	//===----------------------------------------------------------------------===//
@@ -686,11 +969,13 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 	///
 	//===----------------------------------------------------------------------===//
       private:
+	using alloc_traits = std::allocator_traits<allocator_type>;
+
 	void range_destroy(pointer first, pointer last)
 	{
 		pointer p = first;
 		while (p != nullptr && p != last)
-			_allocator.destroy(p++);
+			alloc_traits::destroy(_allocator, std::to_address(p++));
 	}
 	/// This is used when size reaches capacity.
 	/// need to check a couple boundary cases
@@ -711,6 +996,64 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 		return _capacity;
 	}
 
+	/// Parallel construction support, see detail::parallel_construct.
+	template <class... Args>
+	void parallel_construct(const parallel_policy &policy, pointer first,
+				size_type n, const Args &... args)
+	{
+		detail::parallel_construct(policy, _allocator, first, n,
+					   args...);
+	}
+
+	/// Allocates n fresh, untouched slots and fills them in parallel.
+	/// Requires an empty vector without a buffer.
+	template <class... Args>
+	void parallel_init(const parallel_policy &policy, size_type n,
+			   const Args &... args)
+	{
+		pointer tmp = reallocate(n);
+		try {
+			parallel_construct(policy, tmp, n, args...);
+		} catch (...) {
+			_allocator.deallocate(tmp, _capacity);
+			_capacity = 0;
+			throw;
+		}
+		_begin = tmp;
+		_size = n;
+		_end = _begin + _size;
+	}
+
+	template <class... Args>
+	void parallel_resize(const parallel_policy &policy, size_type sz,
+			     const Args &... c)
+	{
+		if (sz <= _size) {
+			range_destroy(_begin + sz, _end);
+		} else {
+			grow_to(sz, false);
+			parallel_construct(policy, _end, sz - _size, c...);
+		}
+		_size = sz;
+		_end = _begin + _size;
+	}
+
+	/// Reallocates so that capacity() >= n, keeping the elements.  With
+	/// refactor the new capacity follows the push_back growth factor,
+	/// otherwise it is exactly n.
+	void grow_to(const size_type n, bool refactor)
+	{
+		if (n > max_size())
+			throw std::length_error("request larger than max");
+
+		if (n <= _capacity)
+			return;
+
+		const size_type oldcap = _capacity;
+		set_new_capacity(n, refactor);
+		alloc_move_swap(_capacity, oldcap, _size, _begin);
+	}
+
 	/// This function does the heavy lifting in copy, assign, resize, and
 	/// shrink push_back methods.
 	void alloc_copy_swap(const size_type newcap, const size_type oldcap,
@@ -718,10 +1061,12 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 	{
 		pointer tmp = reallocate(newcap);
 
-		for (size_type i = 0; i < _size; i++)
-			_allocator.construct(&tmp[i], srcBuf[i]);
+		if (!stream_construct(tmp, srcBuf, _size))
+			for (size_type i = 0; i < _size; i++)
+				alloc_traits::construct(_allocator, &tmp[i], srcBuf[i]);
 
 		std::swap(_begin, tmp);
+		range_destroy(tmp, tmp + oldsize);
 		_allocator.deallocate(tmp, oldcap);
 		_end = _begin + _size;
 	}
@@ -730,14 +1075,92 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 	{
 		pointer tmp = reallocate(newcap);
 
-		for (size_type i = 0; i < _size; i++)
-			_allocator.construct(&tmp[i], std::move(srcBuf[i]));
+		if (!stream_construct(tmp, srcBuf, _size))
+			for (size_type i = 0; i < _size; i++)
+				alloc_traits::construct(_allocator, &tmp[i], std::move(srcBuf[i]));
 
 		std::swap(_begin, tmp);
+		range_destroy(tmp, tmp + oldsize);
 		_allocator.deallocate(tmp, oldcap);
 		_end = _begin + _size;
 	}
 
+	/// Bulk append support.  fill(dst) constructs n elements at dst, or
+	/// throws having destroyed whatever it constructed.  Without room, the
+	/// new elements go into the new buffer first and the old ones follow,
+	/// moved if that cannot throw, otherwise copied.  A first allocation
+	/// takes the capacity hint into account like push_back's does, and is
+	/// not counted as a growth.
+	template <class Fill> void append_with(const size_type n, Fill fill)
+	{
+		if (n == 0)
+			return;
+		if (n > max_size() - _size)
+			throw std::length_error("request larger than max");
+
+		if (_capacity - _size >= n) {
+			fill(_end);
+		} else {
+			const size_type oldcap = _capacity;
+			pointer tmp = nullptr;
+			try {
+				set_new_capacity(_size + n, true);
+				if (oldcap == 0)
+					_capacity = hinted_capacity(_capacity);
+				tmp = reallocate(_capacity);
+				fill(tmp + _size);
+			} catch (...) {
+				if (tmp != nullptr)
+					_allocator.deallocate(tmp, _capacity);
+				_capacity = oldcap;
+				throw;
+			}
+
+			if (!stream_construct(tmp, _begin, _size)) {
+				size_type i = 0;
+				try {
+					for (; i < _size; ++i)
+						alloc_traits::construct(
+							_allocator,
+							std::to_address(tmp + i),
+							std::move_if_noexcept(_begin[i]));
+				} catch (...) {
+					range_destroy(tmp, tmp + i);
+					range_destroy(tmp + _size, tmp + _size + n);
+					_allocator.deallocate(tmp, _capacity);
+					_capacity = oldcap;
+					throw;
+				}
+			}
+			if (_begin != nullptr) {
+				range_destroy(_begin, _end);
+				_allocator.deallocate(_begin, oldcap);
+			}
+			_begin = tmp;
+			if (_hint_site != nullptr && oldcap != 0)
+				++capacity_hint_metrics().growths;
+		}
+		_size += n;
+		_end = _begin + _size;
+	}
+
+	/// Constructs dst[i] from make() for i in [0, n); on a throw the ones
+	/// already built are destroyed.
+	template <class Make>
+	void construct_n(const pointer &dst, const size_type n, Make &&make)
+	{
+		size_type i = 0;
+		try {
+			for (; i < n; ++i)
+				alloc_traits::construct(_allocator,
+							std::to_address(dst + i),
+							make());
+		} catch (...) {
+			range_destroy(dst, dst + i);
+			throw;
+		}
+	}
+
 	/// The two stage construct here prevents us from using alloc_move_swap.
 	///
 	void resize_alloc(const size_type n, const size_type numval,
@@ -750,10 +1173,10 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 		// if this is getting called, we should always have existing
 		// elements
 		for (size_type i = 0; i < _size; ++i)
-			_allocator.construct(&tmp[i], std::move(_begin[i]));
+			alloc_traits::construct(_allocator, &tmp[i], std::move(_begin[i]));
 
 		for (size_type i = _size; i < _size + numval; i++)
-			_allocator.construct(&tmp[i], val);
+			alloc_traits::construct(_allocator, &tmp[i], val);
 
 		// ok, if we get here we did not throw :-)
 		std::swap(_begin, tmp);
@@ -777,7 +1200,7 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 		pointer tmp = insert_resize_to_offset(sz, offset);
 		// insert new elements
 		for (size_type i = 0; i < n; i++)
-			_allocator.construct(&tmp[offset + i], val);
+			alloc_traits::construct(_allocator, &tmp[offset + i], val);
 		// relocate pre-exisiting elements that were after the insertion
 		// point
 		insert_resize_construct_end(tmp, offset, n);
@@ -790,7 +1213,7 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 		pointer tmp = insert_resize_to_offset(sz, offset);
 
 		for (size_type i = 0; i < n; i++)
-			_allocator.construct(&tmp[offset + i], val);
+			alloc_traits::construct(_allocator, &tmp[offset + i], val);
 
 		insert_resize_construct_end(tmp, offset, n);
 	}
@@ -805,7 +1228,7 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 		difference_type n = std::distance(first, last);
 
 		for (size_type i = 0; i < n; i++)
-			_allocator.construct(&tmp[offset + i], *(first++));
+			alloc_traits::construct(_allocator, &tmp[offset + i], *(first++));
 
 		insert_resize_construct_end(tmp, offset, n);
 	}
@@ -818,7 +1241,7 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 
 		size_type i = 0;
 		for (auto &val : il)
-			_allocator.construct(&tmp[offset + i++], val);
+			alloc_traits::construct(_allocator, &tmp[offset + i++], val);
 
 		insert_resize_construct_end(tmp, offset, il.size());
 	}
@@ -830,7 +1253,7 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 					 const size_type n)
 	{
 		for (size_type i = offset + n; i < _size; i++)
-			_allocator.construct(&buf[i], std::move(_begin[i - n]));
+			alloc_traits::construct(_allocator, &buf[i], std::move(_begin[i - n]));
 
 		insert_resize_swap(buf, offset);
 	}
@@ -842,7 +1265,7 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 		pointer tmp = reallocate(n);
 
 		for (size_type i = 0; i < offset; ++i)
-			_allocator.construct(&tmp[i], std::move(_begin[i]));
+			alloc_traits::construct(_allocator, &tmp[i], std::move(_begin[i]));
 
 		return tmp;
 	}
@@ -859,10 +1282,10 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 	void insert_inplace_end_to_offset(const difference_type &offset)
 	{
 		// construct _end with the last element
-		_allocator.construct(&_begin[_size], std::move(back()));
+		alloc_traits::construct(_allocator, &_begin[_size], std::move(back()));
 
 		for (int i = _size - 1; i > offset; i--)
-			_allocator.construct(&_begin[i],
+			alloc_traits::construct(_allocator, &_begin[i],
 					     std::move(_begin[i - 1]));
 	}
 	/// Four overloads for insert_inplace
@@ -952,20 +1375,157 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 		_size = sz;
 		_end = _begin + _size;
 	}
+	/// clear() and pop_back() support.
+	/// Shrinks to size() * headroom once the vector has stayed under the
+	/// low water mark for policy.patience calls, or right away if trim_all()
+	/// ran since we last looked.  Reclaiming is best effort: it is called
+	/// from noexcept clear(), so a failed reallocation just keeps the old
+	/// buffer.
+	void maybe_reclaim() noexcept
+	{
+		if (!_reclaim)
+			return;
+
+		detail::reclaim_state &r = *_reclaim;
+		const std::uint64_t epoch =
+			detail::reclaim_epoch().load(std::memory_order_relaxed);
+		const bool forced = r.epoch != epoch;
+
+		if (_size < _capacity / r.policy.low_water_divisor)
+			++r.streak;
+		else
+			r.streak = 0;
+
+		if (!forced && r.streak < r.policy.patience)
+			return;
+
+		r.epoch = epoch;
+		r.streak = 0;
+
+		const size_type target = _size * r.policy.headroom;
+		if (target >= _capacity
+		    || (_capacity - target) * sizeof(T) < r.policy.min_bytes)
+			return;
+
+		const size_type oldcap = _capacity;
+		if (target == 0) {
+			_allocator.deallocate(_begin, _capacity);
+			_begin = _end = nullptr;
+			_capacity = 0;
+		} else if (!shrink_buffer(target)) {
+			return;
+		}
+
+		reclaim_stats &stats = reclaim_metrics();
+		stats.bytes_reclaimed.fetch_add((oldcap - _capacity) * sizeof(T),
+						std::memory_order_relaxed);
+		stats.shrinks.fetch_add(1, std::memory_order_relaxed);
+	}
+	/// maybe_reclaim support.
+	/// Relocates the elements into a buffer of n, destroys the originals and
+	/// frees the old buffer.  Elements are moved if that cannot throw,
+	/// otherwise copied, so a throw leaves the vector untouched and only
+	/// the new buffer is freed.  Returns false in that case.
+	bool shrink_buffer(const size_type n) noexcept
+	{
+		const size_type oldcap = _capacity;
+		pointer tmp = nullptr;
+		size_type i = 0;
+		try {
+			tmp = reallocate(n);
+			if (!stream_construct(tmp, _begin, _size))
+				for (; i < _size; ++i)
+					alloc_traits::construct(
+						_allocator, std::to_address(tmp + i),
+						std::move_if_noexcept(_begin[i]));
+		} catch (...) {
+			if (tmp != nullptr) {
+				range_destroy(tmp, tmp + i);
+				_allocator.deallocate(tmp, _capacity);
+			}
+			_capacity = oldcap;
+			return false;
+		}
+
+		range_destroy(_begin, _end);
+		_allocator.deallocate(_begin, oldcap);
+		_begin = tmp;
+		_end = _begin + _size;
+		return true;
+	}
 	/// push_back support.
 	/// This has to support strong guarantee for push_back.
 	/// \todo REVIEW
 	void push_back_initial_alloc()
 	{
-		_capacity = _push_back_init_cap; // default starting value
-		_begin = _allocator.allocate(_capacity);
+		// default starting value, unless the site knows better
+		_begin = reallocate(hinted_capacity(_push_back_init_cap));
 		_end = _begin;
 	}
+	/// Capacity hint support.
+	/// The size of a first allocation of at least n elements: the site's
+	/// hint when there is one and it is larger.
+	size_type hinted_capacity(const size_type n) noexcept
+	{
+		if (_hint_site != nullptr) {
+			const size_type hint = _hint_site->hint();
+			if (hint > n) {
+				++capacity_hint_metrics().hinted_allocs;
+				return hint < _max ? hint : _max;
+			}
+		}
+		return n;
+	}
+	/// Capacity hint support, the destructor's report to the site.
+	void report_hint() noexcept
+	{
+		_hint_site->record(_size);
+		capacity_hint_stats &stats = capacity_hint_metrics();
+		++stats.vectors;
+		stats.baseline_growths += detail::growth_steps(
+			_push_back_init_cap, _size, _resize_factor);
+	}
+	/// Copy and relocation support.
+	/// Copies or relocates n trivially copyable elements with
+	/// non-temporal stores when the buffer is past stream_threshold(), so
+	/// multi-GB copies do not flush the LLC, see stream.h.  Returns false
+	/// when the caller has to construct the elements itself.
+	bool stream_construct(const pointer &dst, const pointer &src,
+			      size_type n) noexcept
+	{
+		if constexpr (detail::streamable_v<T>
+			      && !detail::customizes_construct<Allocator, T>::value) {
+			if (n != 0 && detail::stream_worthwhile(n * sizeof(T))) {
+				stream_copy(std::to_address(src), n,
+					    std::to_address(dst));
+				return true;
+			}
+		}
+		return false;
+	}
+	/// The same for n copies of u.
+	bool stream_fill_construct(const pointer &dst, size_type n,
+				   const T &u) noexcept
+	{
+		if constexpr (detail::streamable_v<T>
+			      && !detail::customizes_construct<Allocator, T>::value) {
+			if (n != 0 && detail::stream_worthwhile(n * sizeof(T))) {
+				stream_fill(std::to_address(dst), n, u);
+				return true;
+			}
+		}
+		return false;
+	}
 	/// For vector::reserve.  We have to check to see if the user has
 	/// reserved a buffer.  If so, we use it, otherwise, we do an
 	/// allocation.
-	pointer reallocate(const size_type n)
+	/// Every allocation funnels through here, so this is also where an
+	/// allocator that pads capacity (see aligned_allocator) gets its say.
+	pointer reallocate(size_type n)
 	{
+		if constexpr (detail::pads_capacity<Allocator>::value)
+			n = Allocator::pad_capacity(n);
+
 		_capacity = n;
 		return _allocator.allocate(n);
 	}
@@ -979,9 +1539,11 @@ template <typename T, class Allocator = std::allocator<T>> class vector
 	pointer _begin = nullptr;
 	pointer _end = nullptr;
 	size_type _size_n_alloc = 0;
-	const size_type _push_back_init_cap = 10;
-	const size_type _resize_factor = 2;
+	const size_type _push_back_init_cap = detail::push_back_init_cap;
+	const size_type _resize_factor = detail::resize_factor;
 	const size_type _max = std::numeric_limits<int>::max();
+	std::unique_ptr<detail::reclaim_state> _reclaim;
+	capacity_hint_site *_hint_site = nullptr;
 };
 //===----------------------------------------------------------------------===//
 /// non-member vector helpers
@@ -1022,4 +1584,13 @@ bool operator<=(const vector<T, Allocator> &x, const vector<T, Allocator> &y)
 {
 	return !(y < x);
 }
+
+/// The packed vector<bool> is in vector_bool.h, with the SIMD word kernels
+/// it needs; include that where it is used.  Declared here so that using
+/// vector<bool> without it fails to compile instead of quietly getting
+/// the one byte per element primary template.
+template <class Allocator> class vector<bool, Allocator>;
 } // namespace stevemac
+#ifdef STEVEMAC_VECTOR_EXTERN_TEMPLATES
+#include "vector_extern.h"
+#endif
@@ -0,0 +1,738 @@
+//===-- stevemac::vector_bool.h -----------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#pragma once
+#include "simd.h"
+#include "vector.h"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+
+namespace stevemac
+{
+namespace detail
+{
+using bit_word = std::uint64_t;
+constexpr std::size_t bits_per_word = 64;
+
+constexpr std::size_t words_for(std::size_t bits) noexcept
+{
+	return (bits + bits_per_word - 1) / bits_per_word;
+}
+
+//===----------------------------------------------------------------------===//
+/// word kernels for the bulk operations.
+/// The AVX2 versions do four words per step; the scalar loops are the
+/// fallback and handle the tails.
+//===----------------------------------------------------------------------===//
+inline void words_and_scalar(bit_word *d, const bit_word *s, std::size_t n)
+{
+	for (std::size_t i = 0; i < n; ++i)
+		d[i] &= s[i];
+}
+inline void words_or_scalar(bit_word *d, const bit_word *s, std::size_t n)
+{
+	for (std::size_t i = 0; i < n; ++i)
+		d[i] |= s[i];
+}
+inline void words_xor_scalar(bit_word *d, const bit_word *s, std::size_t n)
+{
+	for (std::size_t i = 0; i < n; ++i)
+		d[i] ^= s[i];
+}
+inline void words_not_scalar(bit_word *d, std::size_t n)
+{
+	for (std::size_t i = 0; i < n; ++i)
+		d[i] = ~d[i];
+}
+inline std::size_t words_count_scalar(const bit_word *s, std::size_t n)
+{
+	std::size_t c = 0;
+	for (std::size_t i = 0; i < n; ++i)
+		c += __builtin_popcountll(s[i]);
+	return c;
+}
+
+#if STEVEMAC_SIMD_X86
+enum class bit_op { and_op, or_op, xor_op };
+
+template <bit_op Op>
+STEVEMAC_TARGET("avx2")
+void words_binary_avx2(bit_word *d, const bit_word *s, std::size_t n)
+{
+	std::size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m256i *pd = reinterpret_cast<__m256i *>(d + i);
+		const __m256i a = _mm256_loadu_si256(pd);
+		const __m256i b = _mm256_loadu_si256(
+			reinterpret_cast<const __m256i *>(s + i));
+		if constexpr (Op == bit_op::and_op)
+			_mm256_storeu_si256(pd, _mm256_and_si256(a, b));
+		else if constexpr (Op == bit_op::or_op)
+			_mm256_storeu_si256(pd, _mm256_or_si256(a, b));
+		else
+			_mm256_storeu_si256(pd, _mm256_xor_si256(a, b));
+	}
+	if constexpr (Op == bit_op::and_op)
+		words_and_scalar(d + i, s + i, n - i);
+	else if constexpr (Op == bit_op::or_op)
+		words_or_scalar(d + i, s + i, n - i);
+	else
+		words_xor_scalar(d + i, s + i, n - i);
+}
+
+STEVEMAC_TARGET("avx2") inline void words_not_avx2(bit_word *d, std::size_t n)
+{
+	const __m256i ones = _mm256_set1_epi64x(-1);
+	std::size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m256i *pd = reinterpret_cast<__m256i *>(d + i);
+		_mm256_storeu_si256(pd,
+				    _mm256_xor_si256(_mm256_loadu_si256(pd), ones));
+	}
+	words_not_scalar(d + i, n - i);
+}
+
+/// Every AVX2 part has POPCNT, so the avx2 level gets the instruction
+/// instead of the generic __builtin_popcountll expansion.
+STEVEMAC_TARGET("avx2,popcnt")
+inline std::size_t words_count_popcnt(const bit_word *s, std::size_t n)
+{
+	std::size_t c0 = 0, c1 = 0, i = 0;
+	for (; i + 2 <= n; i += 2) {
+		c0 += _mm_popcnt_u64(s[i]);
+		c1 += _mm_popcnt_u64(s[i + 1]);
+	}
+	if (i < n)
+		c0 += _mm_popcnt_u64(s[i]);
+	return c0 + c1;
+}
+#endif // STEVEMAC_SIMD_X86
+
+inline void words_and(bit_word *d, const bit_word *s, std::size_t n)
+{
+#if STEVEMAC_SIMD_X86
+	if (simd_dispatch_level() == simd_level::avx2)
+		return words_binary_avx2<bit_op::and_op>(d, s, n);
+#endif
+	words_and_scalar(d, s, n);
+}
+inline void words_or(bit_word *d, const bit_word *s, std::size_t n)
+{
+#if STEVEMAC_SIMD_X86
+	if (simd_dispatch_level() == simd_level::avx2)
+		return words_binary_avx2<bit_op::or_op>(d, s, n);
+#endif
+	words_or_scalar(d, s, n);
+}
+inline void words_xor(bit_word *d, const bit_word *s, std::size_t n)
+{
+#if STEVEMAC_SIMD_X86
+	if (simd_dispatch_level() == simd_level::avx2)
+		return words_binary_avx2<bit_op::xor_op>(d, s, n);
+#endif
+	words_xor_scalar(d, s, n);
+}
+inline void words_not(bit_word *d, std::size_t n)
+{
+#if STEVEMAC_SIMD_X86
+	if (simd_dispatch_level() == simd_level::avx2)
+		return words_not_avx2(d, n);
+#endif
+	words_not_scalar(d, n);
+}
+inline std::size_t words_count(const bit_word *s, std::size_t n)
+{
+#if STEVEMAC_SIMD_X86
+	if (simd_dispatch_level() == simd_level::avx2)
+		return words_count_popcnt(s, n);
+#endif
+	return words_count_scalar(s, n);
+}
+} // namespace detail
+
+///===----------------------------------------------------------------------===//
+///
+/// \class stevemac::bit_reference
+/// \brief Proxy returned by vector<bool>::operator[] and iterator
+/// dereference; it names one bit inside a 64 bit word.
+///
+//===----------------------------------------------------------------------===//
+class bit_reference
+{
+      public:
+	bit_reference(detail::bit_word *word, unsigned bit) noexcept
+	    : _word(word), _mask(detail::bit_word(1) << bit)
+	{
+	}
+	bit_reference(const bit_reference &) = default;
+
+	operator bool() const noexcept
+	{
+		return (*_word & _mask) != 0;
+	}
+	bool operator~() const noexcept
+	{
+		return !bool(*this);
+	}
+	bit_reference &operator=(bool x) noexcept
+	{
+		if (x)
+			*_word |= _mask;
+		else
+			*_word &= ~_mask;
+		return *this;
+	}
+	bit_reference &operator=(const bit_reference &x) noexcept
+	{
+		return *this = bool(x);
+	}
+	void flip() noexcept
+	{
+		*_word ^= _mask;
+	}
+	/// proxies are prvalues, so std::swap cannot bind them.
+	friend void swap(bit_reference x, bit_reference y) noexcept
+	{
+		const bool tmp = x;
+		x = bool(y);
+		y = tmp;
+	}
+
+      private:
+	detail::bit_word *_word;
+	detail::bit_word _mask;
+};
+
+///===----------------------------------------------------------------------===//
+///
+/// \class stevemac::bit_iterator
+/// \brief Random access iterator over packed bits; word pointer plus bit
+/// index.  Const selects const_iterator, which yields plain bool.
+///
+//===----------------------------------------------------------------------===//
+template <bool Const> class bit_iterator
+{
+	using word_pointer = std::conditional_t<Const, const detail::bit_word *,
+						detail::bit_word *>;
+
+      public:
+	using iterator_category = std::random_access_iterator_tag;
+	using value_type = bool;
+	using difference_type = std::ptrdiff_t;
+	using reference = std::conditional_t<Const, bool, bit_reference>;
+	using pointer = void;
+
+	bit_iterator() noexcept : _words(nullptr), _i(0) {}
+	bit_iterator(word_pointer words, std::size_t i) noexcept
+	    : _words(words), _i(i)
+	{
+	}
+	/// iterator -> const_iterator
+	template <bool C = Const, typename = std::enable_if_t<C>>
+	bit_iterator(const bit_iterator<false> &other) noexcept
+	    : _words(other._words), _i(other._i)
+	{
+	}
+
+	reference operator*() const noexcept
+	{
+		if constexpr (Const)
+			return (_words[_i / detail::bits_per_word]
+				>> (_i % detail::bits_per_word))
+			       & 1;
+		else
+			return bit_reference(_words + _i / detail::bits_per_word,
+					     _i % detail::bits_per_word);
+	}
+	reference operator[](difference_type n) const noexcept
+	{
+		return *(*this + n);
+	}
+
+	bit_iterator &operator++() noexcept
+	{
+		++_i;
+		return *this;
+	}
+	bit_iterator operator++(int) noexcept
+	{
+		bit_iterator tmp = *this;
+		++_i;
+		return tmp;
+	}
+	bit_iterator &operator--() noexcept
+	{
+		--_i;
+		return *this;
+	}
+	bit_iterator operator--(int) noexcept
+	{
+		bit_iterator tmp = *this;
+		--_i;
+		return tmp;
+	}
+	bit_iterator &operator+=(difference_type n) noexcept
+	{
+		_i += n;
+		return *this;
+	}
+	bit_iterator &operator-=(difference_type n) noexcept
+	{
+		_i -= n;
+		return *this;
+	}
+	bit_iterator operator+(difference_type n) const noexcept
+	{
+		return bit_iterator(_words, _i + n);
+	}
+	friend bit_iterator operator+(difference_type n,
+				      const bit_iterator &it) noexcept
+	{
+		return it + n;
+	}
+	bit_iterator operator-(difference_type n) const noexcept
+	{
+		return bit_iterator(_words, _i - n);
+	}
+	difference_type operator-(const bit_iterator &other) const noexcept
+	{
+		return static_cast<difference_type>(_i)
+		       - static_cast<difference_type>(other._i);
+	}
+
+	bool operator==(const bit_iterator &other) const noexcept
+	{
+		return _i == other._i;
+	}
+	bool operator!=(const bit_iterator &other) const noexcept
+	{
+		return _i != other._i;
+	}
+	bool operator<(const bit_iterator &other) const noexcept
+	{
+		return _i < other._i;
+	}
+	bool operator>(const bit_iterator &other) const noexcept
+	{
+		return _i > other._i;
+	}
+	bool operator<=(const bit_iterator &other) const noexcept
+	{
+		return _i <= other._i;
+	}
+	bool operator>=(const bit_iterator &other) const noexcept
+	{
+		return _i >= other._i;
+	}
+
+      private:
+	friend class bit_iterator<true>;
+	word_pointer _words;
+	std::size_t _i;
+};
+
+///===----------------------------------------------------------------------===//
+///
+/// stevemac::vector<bool>
+/// Packed specialization, one bit per element in 64 bit words held by a
+/// stevemac::vector<uint64_t> (the allocator is rebound).  Like
+/// std::vector<bool> it hands out proxies, so &v[i] is not a bool*.
+/// On top of the vector interface it offers word at a time count(),
+/// find_first()/find_next() and in place &=, |=, ^=, flip(), which use the
+/// AVX2 kernels above when the CPU has them.
+/// Invariant: the bits past size() in the last word are always zero, so
+/// count() and operator== can work on whole words.
+//===----------------------------------------------------------------------===//
+template <class Allocator> class vector<bool, Allocator>
+{
+	using word_allocator = typename std::allocator_traits<
+		Allocator>::template rebind_alloc<detail::bit_word>;
+	using storage_type = vector<detail::bit_word, word_allocator>;
+
+      public:
+	using value_type = bool;
+	using allocator_type = Allocator;
+	using word_type = detail::bit_word;
+	using reference = bit_reference;
+	using const_reference = bool;
+	using iterator = bit_iterator<false>;
+	using const_iterator = bit_iterator<true>;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+
+	static constexpr size_type bits_per_word = detail::bits_per_word;
+
+	//===----------------------------------------------------------------------===//
+	/// construct/copy/destroy, storage_type does the work
+	//===----------------------------------------------------------------------===//
+	explicit vector(const allocator_type &a = allocator_type()) noexcept
+	    : _allocator(a), _words(word_allocator(a))
+	{
+	}
+
+	explicit vector(size_type n, bool value = false,
+			const allocator_type &a = allocator_type())
+	    : _allocator(a), _words(word_allocator(a))
+	{
+		resize(n, value);
+	}
+
+	vector(std::initializer_list<bool> il,
+	       const allocator_type &a = allocator_type())
+	    : _allocator(a), _words(word_allocator(a))
+	{
+		for (bool b : il)
+			push_back(b);
+	}
+
+	vector(const vector &other) = default;
+	vector(vector &&other) noexcept
+	    : _allocator(other._allocator), _words(std::move(other._words)),
+	      _size(other._size)
+	{
+		other._size = 0;
+	}
+
+	vector &operator=(const vector &other) = default;
+	vector &operator=(vector &&other) noexcept
+	{
+		if (this != &other) {
+			_words.swap(other._words);
+			std::swap(_size, other._size);
+		}
+		return *this;
+	}
+
+	allocator_type get_allocator() const noexcept
+	{
+		return _allocator;
+	}
+
+	//===----------------------------------------------------------------------===//
+	/// iterators
+	//===----------------------------------------------------------------------===//
+	iterator begin() noexcept
+	{
+		return iterator(_words.data(), 0);
+	}
+	const_iterator begin() const noexcept
+	{
+		return const_iterator(_words.data(), 0);
+	}
+	iterator end() noexcept
+	{
+		return iterator(_words.data(), _size);
+	}
+	const_iterator end() const noexcept
+	{
+		return const_iterator(_words.data(), _size);
+	}
+	const_iterator cbegin() const noexcept
+	{
+		return begin();
+	}
+	const_iterator cend() const noexcept
+	{
+		return end();
+	}
+	reverse_iterator rbegin() noexcept
+	{
+		return reverse_iterator(end());
+	}
+	const_reverse_iterator rbegin() const noexcept
+	{
+		return const_reverse_iterator(end());
+	}
+	reverse_iterator rend() noexcept
+	{
+		return reverse_iterator(begin());
+	}
+	const_reverse_iterator rend() const noexcept
+	{
+		return const_reverse_iterator(begin());
+	}
+
+	//===----------------------------------------------------------------------===//
+	/// capacity
+	//===----------------------------------------------------------------------===//
+	size_type size() const noexcept
+	{
+		return _size;
+	}
+	size_type capacity() const noexcept
+	{
+		return _words.capacity() * bits_per_word;
+	}
+	size_type max_size() const noexcept
+	{
+		return _words.max_size() * bits_per_word;
+	}
+	[[nodiscard]] bool empty() const noexcept
+	{
+		return _size == 0;
+	}
+	void shrink_to_fit()
+	{
+		_words.shrink_to_fit();
+	}
+
+	void resize(size_type sz, bool value = false)
+	{
+		const size_type nwords = detail::words_for(sz);
+		if (sz > _size) {
+			// finish the partial word, then whole words
+			const size_type head = _size % bits_per_word;
+			if (value && head != 0)
+				_words.back() |= ~word_type(0) << head;
+
+			const size_type oldwords = _words.size();
+			if (nwords > oldwords) {
+				_words.resize(nwords);
+				if (value)
+					for (size_type i = oldwords; i < nwords;
+					     ++i)
+						_words[i] = ~word_type(0);
+			}
+		} else if (nwords < _words.size()) {
+			_words.resize(nwords);
+		}
+		_size = sz;
+		clear_tail();
+	}
+
+	//===----------------------------------------------------------------------===//
+	/// element access
+	//===----------------------------------------------------------------------===//
+	reference operator[](size_type n)
+	{
+		return reference(&_words[n / bits_per_word], n % bits_per_word);
+	}
+	const_reference operator[](size_type n) const
+	{
+		return (_words[n / bits_per_word] >> (n % bits_per_word)) & 1;
+	}
+	reference at(size_type n)
+	{
+		if (n >= _size)
+			throw std::out_of_range("vector<bool>::at");
+		return (*this)[n];
+	}
+	const_reference at(size_type n) const
+	{
+		if (n >= _size)
+			throw std::out_of_range("vector<bool>::at");
+		return (*this)[n];
+	}
+	reference front()
+	{
+		return (*this)[0];
+	}
+	const_reference front() const
+	{
+		return (*this)[0];
+	}
+	reference back()
+	{
+		return (*this)[_size - 1];
+	}
+	const_reference back() const
+	{
+		return (*this)[_size - 1];
+	}
+
+	/// The packed words, word_count() of them; bit i lives in word
+	/// i / 64 at position i % 64.
+	word_type *data() noexcept
+	{
+		return _words.data();
+	}
+	const word_type *data() const noexcept
+	{
+		return _words.data();
+	}
+	size_type word_count() const noexcept
+	{
+		return _words.size();
+	}
+
+	//===----------------------------------------------------------------------===//
+	/// modifiers
+	//===----------------------------------------------------------------------===//
+	void push_back(bool x)
+	{
+		if (_size % bits_per_word == 0)
+			_words.push_back(0);
+		if (x)
+			_words.back() |= word_type(1) << (_size % bits_per_word);
+		++_size;
+	}
+
+	void pop_back()
+	{
+		--_size;
+		if (_size % bits_per_word == 0)
+			_words.pop_back();
+		else
+			clear_tail();
+	}
+
+	void clear() noexcept
+	{
+		_words.clear();
+		_size = 0;
+	}
+
+	void swap(vector &other) noexcept
+	{
+		_words.swap(other._words);
+		std::swap(_size, other._size);
+	}
+
+	//===----------------------------------------------------------------------===//
+	/// word level operations
+	//===----------------------------------------------------------------------===//
+	/// Number of set bits.
+	size_type count() const noexcept
+	{
+		return detail::words_count(_words.data(), _words.size());
+	}
+
+	/// Index of the first set bit, or size() if there is none.
+	size_type find_first() const noexcept
+	{
+		return scan_from(0);
+	}
+
+	/// Index of the first set bit after pos, or size() if there is none.
+	size_type find_next(size_type pos) const noexcept
+	{
+		++pos;
+		if (pos >= _size)
+			return _size;
+
+		const size_type w = pos / bits_per_word;
+		const word_type bits =
+			_words[w] & (~word_type(0) << (pos % bits_per_word));
+		if (bits != 0)
+			return w * bits_per_word + __builtin_ctzll(bits);
+		return scan_from(w + 1);
+	}
+
+	/// Flips every bit.
+	vector &flip() noexcept
+	{
+		detail::words_not(_words.data(), _words.size());
+		clear_tail();
+		return *this;
+	}
+
+	/// Requires: other.size() == size().
+	vector &operator&=(const vector &other) noexcept
+	{
+		assert(other._size == _size);
+		detail::words_and(_words.data(), other._words.data(),
+				  _words.size());
+		return *this;
+	}
+	vector &operator|=(const vector &other) noexcept
+	{
+		assert(other._size == _size);
+		detail::words_or(_words.data(), other._words.data(),
+				 _words.size());
+		return *this;
+	}
+	vector &operator^=(const vector &other) noexcept
+	{
+		assert(other._size == _size);
+		detail::words_xor(_words.data(), other._words.data(),
+				  _words.size());
+		return *this;
+	}
+	vector operator~() const
+	{
+		vector tmp(*this);
+		tmp.flip();
+		return tmp;
+	}
+
+	friend bool operator==(const vector &x, const vector &y) noexcept
+	{
+		return x._size == y._size
+		       && std::equal(x._words.data(),
+				     x._words.data() + x._words.size(),
+				     y._words.data());
+	}
+	friend bool operator!=(const vector &x, const vector &y) noexcept
+	{
+		return !(x == y);
+	}
+
+	//===----------------------------------------------------------------------===//
+	/// vector<bool> private implementation
+	//===----------------------------------------------------------------------===//
+      private:
+	/// Keeps the invariant that the bits past _size are zero.
+	void clear_tail() noexcept
+	{
+		const size_type tail = _size % bits_per_word;
+		if (tail != 0)
+			_words.back() &= ~(~word_type(0) << tail);
+	}
+
+	size_type scan_from(size_type w) const noexcept
+	{
+		for (; w < _words.size(); ++w)
+			if (_words[w] != 0)
+				return w * bits_per_word
+				       + __builtin_ctzll(_words[w]);
+		return _size;
+	}
+
+	//===----------------------------------------------------------------------===//
+	/// vector<bool> private data members
+	//===----------------------------------------------------------------------===//
+      private:
+	allocator_type _allocator;
+	storage_type _words;
+	size_type _size = 0;
+};
+
+template <class Allocator>
+vector<bool, Allocator> operator&(vector<bool, Allocator> x,
+				  const vector<bool, Allocator> &y)
+{
+	x &= y;
+	return x;
+}
+template <class Allocator>
+vector<bool, Allocator> operator|(vector<bool, Allocator> x,
+				  const vector<bool, Allocator> &y)
+{
+	x |= y;
+	return x;
+}
+template <class Allocator>
+vector<bool, Allocator> operator^(vector<bool, Allocator> x,
+				  const vector<bool, Allocator> &y)
+{
+	x ^= y;
+	return x;
+}
+} // namespace stevemac
+#ifdef STEVEMAC_VECTOR_EXTERN_TEMPLATES
+namespace stevemac
+{
+STEVEMAC_VECTOR_EXTERN template class vector<bool>;
+} // namespace stevemac
+#endif
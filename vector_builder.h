@@ -0,0 +1,220 @@
+//===-- stevemac::vector_builder.h --------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#pragma once
+#include "execution.h"
+#include "vector.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace stevemac
+{
+namespace detail
+{
+/// Never reused, so a thread_local cache entry cannot be mistaken for a
+/// later builder at the same address.
+inline std::uint64_t next_builder_id() noexcept
+{
+	static std::atomic<std::uint64_t> id{1};
+	return id.fetch_add(1, std::memory_order_relaxed);
+}
+} // namespace detail
+
+///===----------------------------------------------------------------------===//
+///
+/// \class stevemac::vector_builder
+/// \brief Collects elements from many threads into one stevemac::vector
+/// without a lock around every append.
+/// Each thread appends to a part of its own, a stevemac::vector on its own
+/// cache line, through local() or the push_back/emplace_back shortcuts.
+/// finish() sums the part sizes, allocates the result once and moves the
+/// parts into it in parallel: the output is split as in execution.h, so
+/// each thread writes, and first touches, one contiguous range of it.
+/// Parts are concatenated in slot order.  local() gives a thread the next
+/// free slot the first time it calls it, so that order follows which thread
+/// appended first; workers that already have an index can pass it to
+/// local(slot) for a fixed order.  Either way each thread's elements stay
+/// in the order it appended them.  Use one form or the other per build.
+/// Requires: nothing appends while finish() or clear() runs.
+///
+//===----------------------------------------------------------------------===//
+template <typename T, class Allocator = std::allocator<T>> class vector_builder
+{
+	struct alignas(64) part {
+		explicit part(const Allocator &a) : items(a) {}
+
+		vector<T, Allocator> items;
+		std::thread::id owner;
+	};
+
+      public:
+	using value_type = T;
+	using size_type = std::size_t;
+	using allocator_type = Allocator;
+	using result_type = vector<T, Allocator>;
+
+	explicit vector_builder(const allocator_type &a = allocator_type())
+	    : _allocator(a)
+	{
+	}
+	vector_builder(const vector_builder &) = delete;
+	vector_builder &operator=(const vector_builder &) = delete;
+
+	/// The calling thread's part, valid until finish() or clear().  The
+	/// thread remembers its last part, so only its first call takes the
+	/// lock, or the first after it used a different builder.
+	result_type &local()
+	{
+		struct cache {
+			std::uint64_t builder = 0;
+			part *p = nullptr;
+		};
+		static thread_local cache c;
+		const std::uint64_t id = _id.load(std::memory_order_relaxed);
+		if (c.builder == id)
+			return c.p->items;
+
+		const std::thread::id self = std::this_thread::get_id();
+		std::lock_guard<std::mutex> g(_lock);
+		part *p = nullptr;
+		for (auto &q : _parts)
+			if (q && q->owner == self)
+				p = q.get();
+		if (p == nullptr) {
+			_parts.push_back(std::make_unique<part>(_allocator));
+			p = _parts.back().get();
+			p->owner = self;
+		}
+		c = cache{id, p};
+		return p->items;
+	}
+
+	/// Part number slot, for callers that index their own workers.
+	/// Requires: one thread per slot at a time.
+	result_type &local(size_type slot)
+	{
+		std::lock_guard<std::mutex> g(_lock);
+		while (_parts.size() <= slot)
+			_parts.push_back(nullptr);
+		if (!_parts[slot])
+			_parts[slot] = std::make_unique<part>(_allocator);
+		return _parts[slot]->items;
+	}
+
+	void push_back(const T &value)
+	{
+		local().push_back(value);
+	}
+	void push_back(T &&value)
+	{
+		local().push_back(std::move(value));
+	}
+	template <class... Args> void emplace_back(Args &&... args)
+	{
+		local().emplace_back(std::forward<Args>(args)...);
+	}
+
+	/// Elements appended so far, over all parts.
+	size_type size() const
+	{
+		std::lock_guard<std::mutex> g(_lock);
+		size_type n = 0;
+		for (auto &p : _parts)
+			if (p)
+				n += p->items.size();
+		return n;
+	}
+
+	/// Moves every part into one vector and leaves the builder empty,
+	/// with every part and every reference from local() gone.
+	/// T whose move constructor may throw is moved on the calling thread
+	/// instead; if that throws, the builder keeps its parts, with the
+	/// elements already moved left in a moved-from state.
+	result_type finish(const parallel_policy &policy = par)
+	{
+		std::lock_guard<std::mutex> g(_lock);
+
+		vector<size_type> offsets;
+		offsets.reserve(_parts.size() + 1);
+		offsets.push_back(0);
+		for (auto &p : _parts)
+			offsets.push_back(offsets.back()
+					  + (p ? p->items.size() : 0));
+		const size_type total = offsets.back();
+
+		result_type out(_allocator);
+		out.reserve(total);
+		if constexpr (std::is_nothrow_move_constructible_v<T>) {
+			T *dst = out.spare_capacity().data();
+			detail::run_chunks(
+				detail::chunk_plan(total, sizeof(T), policy,
+						   dst),
+				[&](std::size_t, size_type b, size_type e) {
+					move_range(offsets, dst, b, e);
+				});
+			out.commit(total);
+		} else {
+			for (auto &p : _parts)
+				if (p)
+					for (auto &x : p->items)
+						out.push_back(std::move(x));
+		}
+
+		reset();
+		return out;
+	}
+
+	/// Drops everything appended so far.
+	void clear()
+	{
+		std::lock_guard<std::mutex> g(_lock);
+		reset();
+	}
+
+      private:
+	/// Move constructs output elements [b, e) from the parts that hold
+	/// them; offsets[i] is where part i starts in the output.
+	void move_range(const vector<size_type> &offsets, T *dst, size_type b,
+			size_type e)
+	{
+		size_type i = std::size_t(std::upper_bound(offsets.data(),
+							   offsets.data()
+								   + offsets.size(),
+							   b)
+					  - offsets.data())
+			      - 1;
+		while (b < e) {
+			const size_type stop = std::min(e, offsets[i + 1]);
+			if (stop > b) {
+				T *src = _parts[i]->items.data()
+					 + (b - offsets[i]);
+				std::uninitialized_move(src, src + (stop - b),
+							dst + b);
+				b = stop;
+			}
+			++i;
+		}
+	}
+
+	void reset()
+	{
+		_parts.clear();
+		_id.store(detail::next_builder_id(), std::memory_order_relaxed);
+	}
+
+	Allocator _allocator;
+	mutable std::mutex _lock;
+	vector<std::unique_ptr<part>> _parts;
+	std::atomic<std::uint64_t> _id{detail::next_builder_id()};
+};
+} // namespace stevemac
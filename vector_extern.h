@@ -0,0 +1,43 @@
+//===-- stevemac::vector_extern.h ---------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#pragma once
+#include "vector.h"
+#include <string>
+
+///===----------------------------------------------------------------------===//
+///
+/// Explicit instantiations of stevemac::vector for the common element
+/// types.  Consumers see extern template declarations, so these are not
+/// instantiated again in every translation unit; the definitions are
+/// compiled once into the stevemac_vector library by vector_instances.cpp,
+/// which includes this file with STEVEMAC_VECTOR_EXTERN defined empty.
+/// vector.h pulls this in when STEVEMAC_VECTOR_EXTERN_TEMPLATES is defined,
+/// which linking the stevemac_vector CMake target does.  vector<bool> has
+/// its own line at the end of vector_bool.h, so that only files using it
+/// pay for that header.
+//===----------------------------------------------------------------------===//
+#ifndef STEVEMAC_VECTOR_EXTERN
+#define STEVEMAC_VECTOR_EXTERN extern
+#endif
+
+namespace stevemac
+{
+STEVEMAC_VECTOR_EXTERN template class vector<char>;
+STEVEMAC_VECTOR_EXTERN template class vector<signed char>;
+STEVEMAC_VECTOR_EXTERN template class vector<unsigned char>;
+STEVEMAC_VECTOR_EXTERN template class vector<short>;
+STEVEMAC_VECTOR_EXTERN template class vector<unsigned short>;
+STEVEMAC_VECTOR_EXTERN template class vector<int>;
+STEVEMAC_VECTOR_EXTERN template class vector<unsigned int>;
+STEVEMAC_VECTOR_EXTERN template class vector<long>;
+STEVEMAC_VECTOR_EXTERN template class vector<unsigned long>;
+STEVEMAC_VECTOR_EXTERN template class vector<long long>;
+STEVEMAC_VECTOR_EXTERN template class vector<unsigned long long>;
+STEVEMAC_VECTOR_EXTERN template class vector<float>;
+STEVEMAC_VECTOR_EXTERN template class vector<double>;
+STEVEMAC_VECTOR_EXTERN template class vector<std::string>;
+} // namespace stevemac
@@ -0,0 +1,14 @@
+//===-- stevemac::vector_instances.cpp ----------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+/// Turns the extern template list in vector_extern.h, and the vector<bool>
+/// line at the end of vector_bool.h, into the explicit instantiation
+/// definitions of the stevemac_vector library.  execution.h supplies the
+/// parallel overloads' body, which vector.h only declares.
+#define STEVEMAC_VECTOR_EXTERN
+#include "execution.h"
+#include "vector_extern.h"
+#include "vector_bool.h"
@@ -0,0 +1,402 @@
+//===-- stevemac::vm_vector.h -------------------------------------*- C -*-===//
+//
+// This file is distributed under the GNU General Public License, version 2
+// (GPLv2). See https://www.gnu.org/licenses/old-licenses/gpl-2.0.en.html
+// Author: Stephen E. MacKenzie
+//===----------------------------------------------------------------------===//
+#pragma once
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace stevemac
+{
+///===----------------------------------------------------------------------===//
+///
+/// stevemac::vm_vector
+/// Append-mostly vector that never relocates.  The constructor reserves
+/// max_reserve elements worth of address space (PROT_NONE, MAP_NORESERVE)
+/// and growth only commits more of that range with mprotect, so data(),
+/// iterators and references stay valid for the life of the object and no
+/// element is ever copied or moved by growth.  Untouched committed pages
+/// cost nothing; resident memory follows size().
+/// shrink_to_fit() hands the pages past size() back to the kernel.
+/// POSIX only.  Exceeding max_reserve throws std::length_error.
+//===----------------------------------------------------------------------===//
+template <typename T> class vm_vector
+{
+      public:
+	using value_type = T;
+	using reference = value_type &;
+	using const_reference = const value_type &;
+	using pointer = T *;
+	using const_pointer = const T *;
+	using iterator = T *;
+	using const_iterator = const T *;
+	using reverse_iterator = std::reverse_iterator<iterator>;
+	using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+	using size_type = std::size_t;
+	using difference_type = std::ptrdiff_t;
+
+	/// 64 GiB of address space, only reserved, never charged.
+	static constexpr size_type default_max_reserve =
+		(size_type(1) << 36) / sizeof(T);
+
+	//===----------------------------------------------------------------------===//
+	/// construct/copy/destroy
+	//===----------------------------------------------------------------------===//
+	/// max_reserve 0 (also what a moved-from vm_vector copies) maps
+	/// nothing: the vector is empty and every push_back throws
+	/// length_error.
+	explicit vm_vector(size_type max_reserve = default_max_reserve)
+	    : _reserved(round_to_page(max_reserve * sizeof(T)))
+	{
+		if (max_reserve > max_size_limit())
+			throw std::length_error("request larger than max");
+		if (_reserved == 0)
+			return;
+
+		void *p = ::mmap(nullptr, _reserved, PROT_NONE,
+				 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+				 -1, 0);
+		if (p == MAP_FAILED)
+			throw std::bad_alloc();
+		_begin = static_cast<pointer>(p);
+	}
+
+	vm_vector(std::initializer_list<T> il,
+		  size_type max_reserve = default_max_reserve)
+	    : vm_vector(max_reserve)
+	{
+		reserve(il.size());
+		for (auto &v : il)
+			push_back(v);
+	}
+
+	/// The copy gets its own reservation of the same size.
+	vm_vector(const vm_vector &other) : vm_vector(other.max_size())
+	{
+		reserve(other._size);
+		for (size_type i = 0; i < other._size; ++i)
+			push_back(other[i]);
+	}
+
+	vm_vector(vm_vector &&other) noexcept
+	    : _begin(other._begin), _size(other._size),
+	      _committed(other._committed), _reserved(other._reserved)
+	{
+		other._begin = nullptr;
+		other._size = other._committed = other._reserved = 0;
+	}
+
+	~vm_vector()
+	{
+		if (_begin != nullptr) {
+			clear();
+			::munmap(_begin, _reserved);
+		}
+	}
+
+	vm_vector &operator=(const vm_vector &other)
+	{
+		if (this != &other) {
+			vm_vector tmp(other);
+			swap(tmp);
+		}
+		return *this;
+	}
+
+	vm_vector &operator=(vm_vector &&other) noexcept
+	{
+		if (this != &other) {
+			vm_vector tmp(std::move(other));
+			swap(tmp);
+		}
+		return *this;
+	}
+
+	//===----------------------------------------------------------------------===//
+	/// iterators
+	//===----------------------------------------------------------------------===//
+	iterator begin() noexcept
+	{
+		return _begin;
+	}
+	const_iterator begin() const noexcept
+	{
+		return _begin;
+	}
+	iterator end() noexcept
+	{
+		return _begin + _size;
+	}
+	const_iterator end() const noexcept
+	{
+		return _begin + _size;
+	}
+	const_iterator cbegin() const noexcept
+	{
+		return begin();
+	}
+	const_iterator cend() const noexcept
+	{
+		return end();
+	}
+	reverse_iterator rbegin() noexcept
+	{
+		return reverse_iterator(end());
+	}
+	const_reverse_iterator rbegin() const noexcept
+	{
+		return const_reverse_iterator(end());
+	}
+	reverse_iterator rend() noexcept
+	{
+		return reverse_iterator(begin());
+	}
+	const_reverse_iterator rend() const noexcept
+	{
+		return const_reverse_iterator(begin());
+	}
+
+	//===----------------------------------------------------------------------===//
+	/// capacity
+	/// capacity() is what is committed, max_size() what is reserved.
+	//===----------------------------------------------------------------------===//
+	size_type size() const noexcept
+	{
+		return _size;
+	}
+	size_type capacity() const noexcept
+	{
+		return _committed / sizeof(T);
+	}
+	size_type max_size() const noexcept
+	{
+		return _reserved / sizeof(T);
+	}
+	[[nodiscard]] bool empty() const noexcept
+	{
+		return _size == 0;
+	}
+
+	/// Commits at least n elements; never moves anything.
+	/// can throw length_error if n > max_size().
+	void reserve(size_type n)
+	{
+		if (n > max_size())
+			throw std::length_error("request larger than max");
+
+		if (n > capacity())
+			commit_bytes(round_to_page(n * sizeof(T)));
+	}
+
+	/// Decommits the whole pages past size().  The address range stays
+	/// reserved, so a later push_back commits it again in place.
+	void shrink_to_fit()
+	{
+		const size_type keep = round_to_page(_size * sizeof(T));
+		if (keep < _committed) {
+			char *p = reinterpret_cast<char *>(_begin) + keep;
+			::madvise(p, _committed - keep, MADV_DONTNEED);
+			::mprotect(p, _committed - keep, PROT_NONE);
+			_committed = keep;
+		}
+	}
+
+	void resize(size_type sz)
+	{
+		resize_helper(sz);
+	}
+	void resize(size_type sz, const T &c)
+	{
+		resize_helper(sz, c);
+	}
+
+	//===----------------------------------------------------------------------===//
+	/// element access
+	//===----------------------------------------------------------------------===//
+	reference operator[](size_type n)
+	{
+		return _begin[n];
+	}
+	const_reference operator[](size_type n) const
+	{
+		return _begin[n];
+	}
+	reference at(size_type n)
+	{
+		if (n >= _size)
+			throw std::out_of_range("vm_vector::at");
+		return _begin[n];
+	}
+	const_reference at(size_type n) const
+	{
+		if (n >= _size)
+			throw std::out_of_range("vm_vector::at");
+		return _begin[n];
+	}
+	reference front()
+	{
+		return _begin[0];
+	}
+	const_reference front() const
+	{
+		return _begin[0];
+	}
+	reference back()
+	{
+		return _begin[_size - 1];
+	}
+	const_reference back() const
+	{
+		return _begin[_size - 1];
+	}
+	/// Stable for the lifetime of the vm_vector.
+	T *data() noexcept
+	{
+		return _begin;
+	}
+	const T *data() const noexcept
+	{
+		return _begin;
+	}
+
+	//===----------------------------------------------------------------------===//
+	/// modifiers
+	/// Strong guarantee: growth cannot relocate, so a throw from commit or
+	/// from T's constructor leaves the contents as they were.
+	//===----------------------------------------------------------------------===//
+	void push_back(const T &val)
+	{
+		emplace_back(val);
+	}
+	void push_back(T &&val)
+	{
+		emplace_back(std::move(val));
+	}
+
+	template <class... Args> reference emplace_back(Args &&... args)
+	{
+		if (_size * sizeof(T) + sizeof(T) > _committed)
+			grow(_size + 1);
+
+		pointer p = ::new (static_cast<void *>(_begin + _size))
+			T(std::forward<Args>(args)...);
+		++_size;
+		return *p;
+	}
+
+	void pop_back()
+	{
+		--_size;
+		std::destroy_at(_begin + _size);
+	}
+
+	/// capacity remains unchanged
+	void clear() noexcept
+	{
+		std::destroy(_begin, _begin + _size);
+		_size = 0;
+	}
+
+	void swap(vm_vector &other) noexcept
+	{
+		std::swap(_begin, other._begin);
+		std::swap(_size, other._size);
+		std::swap(_committed, other._committed);
+		std::swap(_reserved, other._reserved);
+	}
+
+	//===----------------------------------------------------------------------===//
+	/// vm_vector private implementation
+	//===----------------------------------------------------------------------===//
+      private:
+	static size_type page_size() noexcept
+	{
+		static const size_type sz = ::sysconf(_SC_PAGESIZE);
+		return sz;
+	}
+
+	static size_type round_to_page(size_type bytes) noexcept
+	{
+		const size_type pg = page_size();
+		return (bytes + pg - 1) / pg * pg;
+	}
+
+	static constexpr size_type max_size_limit() noexcept
+	{
+		return (size_type(-1) / 2) / sizeof(T);
+	}
+
+	/// Commits geometrically, like vector's _resize_factor, so a long run
+	/// of push_back costs O(log n) mprotect calls.  Committed but untouched
+	/// pages are not resident, so over-committing here is free.
+	void grow(size_type n)
+	{
+		if (n > max_size())
+			throw std::length_error("vm_vector reservation exhausted");
+
+		size_type want = _committed * _resize_factor;
+		if (want < n * sizeof(T))
+			want = n * sizeof(T);
+		want = round_to_page(want);
+		commit_bytes(want < _reserved ? want : _reserved);
+	}
+
+	void commit_bytes(size_type bytes)
+	{
+		char *p = reinterpret_cast<char *>(_begin) + _committed;
+		if (::mprotect(p, bytes - _committed, PROT_READ | PROT_WRITE)
+		    != 0)
+			throw std::bad_alloc();
+		_committed = bytes;
+	}
+
+	template <class... Args> void resize_helper(size_type sz, Args &&... c)
+	{
+		if (sz <= _size) {
+			std::destroy(_begin + sz, _begin + _size);
+			_size = sz;
+			return;
+		}
+
+		reserve(sz);
+		size_type i = _size;
+		try {
+			for (; i < sz; ++i) {
+				if constexpr (sizeof...(Args) == 0)
+					::new (static_cast<void *>(_begin + i)) T();
+				else
+					::new (static_cast<void *>(_begin + i))
+						T(c...);
+			}
+		} catch (...) {
+			std::destroy(_begin + _size, _begin + i);
+			throw;
+		}
+		_size = sz;
+	}
+
+	//===----------------------------------------------------------------------===//
+	/// vm_vector private data members
+	//===----------------------------------------------------------------------===//
+      private:
+	pointer _begin = nullptr;
+	size_type _size = 0;
+	size_type _committed = 0; // bytes, page multiple
+	size_type _reserved = 0;  // bytes, page multiple
+	static constexpr size_type _resize_factor = 2;
+};
+
+template <class T> void swap(vm_vector<T> &x, vm_vector<T> &y) noexcept
+{
+	x.swap(y);
+}
+} // namespace stevemac